@@ -0,0 +1,55 @@
+#ifndef ADDRESSINDEX_H
+#define ADDRESSINDEX_H
+
+#include "Arena.h"
+#include "Prefetch.h"
+#include <cstdint>
+
+// Open-addressing hash map from a branch address to a non-negative int (a BTB slot,
+// a stack level...). Linear probing with backward-shift deletion, sized up front so
+// it never rehashes and stays at most half full. The buckets live in an arena.
+class AddressIndex {
+private:
+    ArenaArray<int> keys;
+    ArenaArray<int> values; // -1 = empty bucket
+    uint32_t mask;
+
+    static uint32_t hash(int key) {
+        uint32_t h = static_cast<uint32_t>(key) * 0x9E3779B1u;
+        return h ^ (h >> 16);
+    }
+
+public:
+    // No buckets, a placeholder to move a sized index into before any other use
+    AddressIndex() : mask(0) {}
+    AddressIndex(int maxEntries, Arena& arena);
+
+    // Value stored for key, or -1 if absent
+    int find(int key) const {
+        uint32_t i = hash(key) & mask;
+        while (values[i] != -1) {
+            if (keys[i] == key) {
+                return values[i];
+            }
+            i = (i + 1) & mask;
+        }
+        return -1;
+    }
+
+    // Start loading the bucket a find of key begins at
+    void prefetch(int key) const {
+        uint32_t i = hash(key) & mask;
+        prefetchRead(&keys[i]);
+        prefetchRead(&values[i]);
+    }
+
+    // Insert key or overwrite its value
+    void set(int key, int value);
+
+    void erase(int key);
+
+    // Remove every key
+    void clear() { values.fill(-1); }
+};
+
+#endif //ADDRESSINDEX_H
@@ -0,0 +1,112 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Every arena allocation starts on a cache line of its own
+const size_t CACHE_LINE_SIZE = 64;
+
+// Monotonic allocator for the tables of BTBs and predictors. Tables are carved one after another
+// out of large cache-line aligned blocks and never freed on their own: the arena releases all its
+// blocks at once when it goes, and nothing in it is destroyed, so it only holds trivially
+// destructible types. A sweep builds every configuration from one arena, so hundreds of them
+// cost a handful of allocations. Not thread safe, each thread needs its own.
+class Arena {
+private:
+    struct BlockDeleter {
+        void operator()(unsigned char* block) const;
+    };
+
+    std::vector<std::unique_ptr<unsigned char, BlockDeleter>> blocks;
+    unsigned char* cursor; // Free space of the current block
+    size_t remaining;
+    size_t blockSize;
+    size_t bytesUsed;
+
+    // A new block for bytes that do not fit the current one
+    void* allocateSlow(size_t bytes);
+
+public:
+    static const size_t DEFAULT_BLOCK_SIZE = 256 * 1024;
+
+    // Tables larger than a quarter of blockSize get a block of their own
+    explicit Arena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+    // Tables point into the blocks, an arena stays where it was made
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    // bytes of uninitialized memory, aligned to CACHE_LINE_SIZE
+    void* allocate(size_t bytes) {
+        bytes = (bytes + CACHE_LINE_SIZE - 1) & ~(CACHE_LINE_SIZE - 1);
+        if (bytes > remaining) {
+            return allocateSlow(bytes);
+        }
+        void* result = cursor;
+        cursor += bytes;
+        remaining -= bytes;
+        bytesUsed += bytes;
+        return result;
+    }
+
+    size_t getBlocks() const { return blocks.size(); }
+    size_t getBytesUsed() const { return bytesUsed; }
+};
+
+// Fixed-size table of count T in an arena. It does not own its memory, so it cannot be copied
+// (the copy would share the table); moving hands the table over and leaves the source empty.
+template <typename T>
+class ArenaArray {
+    static_assert(std::is_trivially_destructible<T>::value, "Arena contents are never destroyed");
+
+private:
+    T* items;
+    size_t count;
+
+public:
+    ArenaArray() : items(nullptr), count(0) {}
+
+    ArenaArray(Arena& arena, size_t count, const T& value = T())
+        : items(static_cast<T*>(arena.allocate(count * sizeof(T)))), count(count) {
+        std::uninitialized_fill_n(items, count, value);
+    }
+
+    ArenaArray(const ArenaArray&) = delete;
+    ArenaArray& operator=(const ArenaArray&) = delete;
+
+    ArenaArray(ArenaArray&& other) noexcept : items(other.items), count(other.count) {
+        other.items = nullptr;
+        other.count = 0;
+    }
+
+    ArenaArray& operator=(ArenaArray&& other) noexcept {
+        items = other.items;
+        count = other.count;
+        other.items = nullptr;
+        other.count = 0;
+        return *this;
+    }
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+
+    T* data() { return items; }
+    const T* data() const { return items; }
+
+    T& operator[](size_t i) { return items[i]; }
+    const T& operator[](size_t i) const { return items[i]; }
+
+    T* begin() { return items; }
+    T* end() { return items + count; }
+    const T* begin() const { return items; }
+    const T* end() const { return items + count; }
+
+    void fill(const T& value) { std::fill_n(items, count, value); }
+};
+
+#endif //ARENA_H
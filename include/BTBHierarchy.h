@@ -0,0 +1,83 @@
+#ifndef BTBHIERARCHY_H
+#define BTBHIERARCHY_H
+
+#include "BranchTargetBuffer.h"
+#include "StatsRegistry.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointReader;
+class CheckpointWriter;
+
+// One probe of a BTB hierarchy: the level that supplied the target (-1 if none had the branch)
+// and the probe of every level searched, which is every level up to and including that one.
+struct BTBProbe {
+    int level;
+    int target;
+    BTBSlot slots[BTB_MAX_LEVELS];
+};
+
+// The faster BTB levels (L0, L1...) in front of a main BTB. The main BTB stays with its owner
+// and is passed in as the last level, so a run without faster levels uses it directly.
+// A lookup searches the levels fastest first and stops at the first hit; a taken branch then
+// fills the levels it missed or promotes its entry into faster ones, as the BTBConfig says.
+class BTBHierarchy {
+private:
+    std::vector<BranchTargetBuffer> levels; // The faster levels, fastest first
+    std::vector<int> latencies; // Every level's latency, the main BTB's last
+    BTBFillPolicy fill;
+    BTBPromotion promotion;
+
+    std::vector<uint64_t> levelHits; // Lookups each level supplied, the main BTB's last
+    uint64_t promotions; // Entries copied into a faster level on a hit
+
+public:
+    // The faster levels' tables come from the arena
+    BTBHierarchy(const BTBConfig& config, Arena& arena);
+
+    // Levels counting the main BTB
+    int getLevels() const { return static_cast<int>(latencies.size()); }
+    int getLatency(int level) const { return latencies[level]; }
+    uint64_t getLevelHits(int level) const { return levelHits[level]; }
+    uint64_t getPromotions() const { return promotions; }
+
+    BTBProbe lookup(BranchTargetBuffer& last, int sourceAddr) {
+        BTBProbe probe;
+        probe.level = -1;
+        probe.target = -1;
+        int faster = static_cast<int>(levels.size());
+        for (int level = 0; level <= faster; level++) {
+            BranchTargetBuffer& btb = level < faster ? levels[level] : last;
+            BTBSlot slot = btb.lookup(sourceAddr);
+            probe.slots[level] = slot;
+            if (slot.hit()) {
+                probe.level = level;
+                probe.target = btb.getTarget(slot);
+                levelHits[level]++;
+                break;
+            }
+        }
+        return probe;
+    }
+
+    // Record a taken branch through its probe. Returns the source address the main BTB evicted,
+    // -1 if none; entries leaving a faster level are still in the levels behind it.
+    int update(BranchTargetBuffer& last, const BTBProbe& probe, int sourceAddr, int targetAddr);
+
+    // "btb.l<N>.hits" for every level, the faster levels' allocations and evictions under
+    // "btb.l<N>." and "btb.promotions"
+    void registerStats(StatsRegistry& stats) const;
+    void resetStatistics();
+
+    // The faster levels only, the main BTB is saved by its owner
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in);
+};
+
+// Frontend timing estimates for branches trace records and lostCycles cycles lost to bubbles,
+// redirects and flushes, from the FrontendTiming assumptions
+double estimatedIPC(const FrontendTiming& timing, long long branches, long long lostCycles);
+double ipcLossPercent(const FrontendTiming& timing, long long branches, long long lostCycles);
+
+#endif //BTBHIERARCHY_H
@@ -0,0 +1,53 @@
+#ifndef BATCHRUNNER_H
+#define BATCHRUNNER_H
+
+#include "BranchTargetBuffer.h"
+#include "PredictorConfig.h"
+#include "SweepRunner.h"
+#include <string>
+#include <vector>
+
+// One line of a batch manifest: "<trace_file> <btb_spec> <predictor_spec>"
+struct BatchJob {
+    std::string trace;
+    BTBConfig btb;
+    PredictorConfig predictor;
+    int line; // Manifest line, for error messages
+};
+
+struct BatchResult {
+    SweepResult result;
+    double seconds; // Simulation time of this job alone
+    bool ok;
+};
+
+// Read a manifest. Blank lines and lines starting with '#' are ignored. Returns false and
+// prints the offending line if any job is malformed.
+bool readBatchManifest(const std::string& filename, std::vector<BatchJob>& jobs);
+
+// Runs every job of a manifest on a work-stealing pool. Each distinct trace is parsed once into
+// memory by one task, which then queues that trace's jobs; they share the instructions read-only
+// and the trace is freed when its last job finishes.
+class BatchRunner {
+private:
+    std::vector<BatchJob> jobs;
+    std::vector<BatchResult> results;
+    int threads;
+    double wallSeconds;
+
+public:
+    BatchRunner(const std::vector<BatchJob>& jobs, int threads);
+
+    // Run everything, returns false if any trace could not be read
+    bool run();
+
+    const std::vector<BatchResult>& getResults() const { return results; }
+
+    // One row per job in manifest order, then the totals
+    void printReport() const;
+};
+
+// Handle "--batch <manifest> [threads]"
+int runBatchCommand(int argc, char* argv[], const StatsOutput& statsOutput);
+
+#endif //BATCHRUNNER_H
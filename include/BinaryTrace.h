@@ -0,0 +1,87 @@
+#ifndef BINARYTRACE_H
+#define BINARYTRACE_H
+
+#include "MappedFile.h"
+#include "TraceReader.h"
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+/*
+* Packed binary trace format, version 1. All integers are little-endian.
+*
+*   header (32 bytes): magic "BPTRACE\0", u16 version, u16 header size,
+*                      u32 records per block, u64 record count, u64 reserved
+*   blocks:            u32 records, u32 payload bytes, then the payload:
+*                      one flag byte per record followed by the varint address stream
+*
+* Flag byte: bits 0-2 type code, bit 3 taken, bits 4-5 direction ('?', 'F', 'B'), bit 6 has target.
+* Type code 7 means the type character follows as a raw byte in the address stream.
+* Source addresses are zigzag varint deltas from the previous record's source, targets are
+* zigzag varint deltas from their own source, so hot loops shrink to a few bytes per record.
+*/
+
+const uint16_t BINARY_TRACE_VERSION = 1;
+const uint32_t BINARY_TRACE_DEFAULT_BLOCK = 65536;
+
+// True if the buffer starts with the binary trace magic
+bool isBinaryTrace(const char* data, size_t size);
+
+class BinaryTraceWriter {
+private:
+    std::ofstream out;
+    uint32_t blockRecords;
+    uint64_t recordCount;
+    int previousSource;
+    std::vector<uint8_t> flags; // Current block
+    std::vector<uint8_t> addresses;
+
+    void flushBlock();
+
+public:
+    BinaryTraceWriter(const std::string& filename, uint32_t blockRecords = BINARY_TRACE_DEFAULT_BLOCK);
+    ~BinaryTraceWriter();
+
+    BinaryTraceWriter(const BinaryTraceWriter&) = delete;
+    BinaryTraceWriter& operator=(const BinaryTraceWriter&) = delete;
+
+    bool isOpen() const { return out.is_open(); }
+
+    void write(const Instruction& instr);
+
+    // Flush the last block and patch the record count into the header, returns false on I/O error
+    bool close();
+
+    uint64_t getRecordCount() const { return recordCount; }
+};
+
+class BinaryTraceReader {
+private:
+    std::unique_ptr<MappedFile> file;
+    bool valid;
+    uint32_t blockRecords;
+    uint64_t recordCount;
+    size_t offset; // Next block
+    int previousSource;
+
+public:
+    BinaryTraceReader(const std::string& filename);
+
+    // Decode a file already opened, e.g. one TraceReader has read from a pipe that cannot be reopened
+    explicit BinaryTraceReader(std::unique_ptr<MappedFile> mappedFile);
+
+    // False if the file could not be opened or is not a supported binary trace
+    bool isOpen() const { return valid; }
+
+    uint64_t getRecordCount() const { return recordCount; }
+    uint32_t getBlockRecords() const { return blockRecords; }
+    size_t getFileSize() const { return file->size(); }
+    size_t getBytesRead() const { return offset; }
+
+    // Decode the next block into out (replacing its contents), false once the trace is exhausted
+    bool readBlock(std::vector<Instruction>& out);
+};
+
+#endif //BINARYTRACE_H
@@ -3,39 +3,30 @@
 #define BRANCH_PREDICTOR_H
 
 #include "BranchTargetBuffer.h"
-#include "TraceReader.h"
-#include <vector>
-
-class BranchPredictor {
-private:
-    BranchTargetBuffer* btb;
-    int btbHits;
-    int btbMisses;
-    int predictionHits;
-    int predictionMisses;
-    int btbHitButMispredicted;
-
+#include "SimulationDriver.h"
 
+// Static prediction: a branch is predicted taken if it is in the BTB.
+// Only taken branches are ever inserted, so presence means "was taken last time it was seen".
+class StaticPredictor {
 public:
-    BranchPredictor(int btbSize);
-    ~BranchPredictor();
+    StaticPredictor(const BTBConfig&, const PredictorConfig&, Arena&) {}
 
-    // Predict if a branch will be taken using static prediction:
-    // - Backward branches (target < source) are predicted taken
-    // - Forward branches (target > source) are predicted not taken
-    bool predictTaken(int sourceAddr);
+    bool predict(int, bool inBTB) const { return inBTB; }
 
-    // Get predicted target address from BTB
-    int predictTargetAddress(int sourceAddr);
+    void update(int, bool) {}
 
-    // Update BTB based on actual outcome
-    void update(Instruction instr);
+    void prefetch(int) const {}
 
-    // Run simulation on a trace file
-    void simulateTrace(const std::string& traceFilename);
+    void registerStats(StatsRegistry&) const {}
 
-    // Print statistics
-    void printStats() const;
+    // Stateless, the BTB is the whole predictor
+    void saveState(CheckpointWriter&) const {}
+    bool loadState(CheckpointReader&) { return true; }
+
+    static const char* name() { return "static"; }
+    static const char* displayName() { return "Static"; }
 };
 
-#endif // BRANCH_PREDICTOR_H
\ No newline at end of file
+using BranchPredictor = SimulationDriver<StaticPredictor>;
+
+#endif // BRANCH_PREDICTOR_H
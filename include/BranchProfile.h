@@ -0,0 +1,88 @@
+#ifndef BRANCHPROFILE_H
+#define BRANCHPROFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+const uint32_t BRANCH_PROFILE_EMPTY = 0xFFFFFFFFu; // Free hash bucket
+
+// Everything counted for one static branch
+struct BranchRecord {
+    int sourceAddr;
+    uint64_t executions;
+    uint64_t taken;
+    uint64_t mispredicts; // Wrong direction
+    uint64_t btbMisses;
+    uint64_t hitButMispredicted; // Fetched from the BTB and then flushed
+    uint64_t redirects; // Wrong direction, or taken with no BTB entry to fetch the target from
+    uint64_t evicted; // Times this branch's BTB entry was replaced by another branch
+};
+
+// Per-branch profile of a simulation, keyed by source address. The hash table only holds keys
+// and an index into the dense record array, linear probing over 8-byte buckets, and doubles
+// whenever it gets half full, so it adapts to any number of static branches.
+class BranchProfile {
+private:
+    std::vector<int> keys;
+    std::vector<uint32_t> slots; // Record index, BRANCH_PROFILE_EMPTY if the bucket is free
+    uint32_t mask;
+    std::vector<BranchRecord> records;
+
+    static uint32_t hash(int key) {
+        uint32_t h = static_cast<uint32_t>(key) * 0x9E3779B1u;
+        return h ^ (h >> 16);
+    }
+
+    void grow();
+
+public:
+    explicit BranchProfile(size_t expectedBranches = 4096);
+
+    // The record of a branch, created on first use
+    BranchRecord& at(int sourceAddr) {
+        uint32_t i = hash(sourceAddr) & mask;
+        while (slots[i] != BRANCH_PROFILE_EMPTY) {
+            if (keys[i] == sourceAddr) {
+                return records[slots[i]];
+            }
+            i = (i + 1) & mask;
+        }
+        keys[i] = sourceAddr;
+        slots[i] = static_cast<uint32_t>(records.size());
+        records.push_back(BranchRecord{sourceAddr, 0, 0, 0, 0, 0, 0, 0});
+        if (records.size() * 2 > slots.size()) {
+            grow();
+        }
+        return records.back();
+    }
+
+    // lookedUp is false for a return or indirect branch whose target came from its own predictor,
+    // which is never a BTB miss
+    void record(int sourceAddr, bool taken, bool inBTB, bool lookedUp, bool correct) {
+        BranchRecord& branch = at(sourceAddr);
+        branch.executions++;
+        branch.taken += taken;
+        branch.mispredicts += !correct;
+        branch.btbMisses += lookedUp && !inBTB;
+        branch.hitButMispredicted += lookedUp && inBTB && !correct;
+        branch.redirects += !correct || (taken && !inBTB);
+    }
+
+    void recordEviction(int sourceAddr) { at(sourceAddr).evicted++; }
+
+    const std::vector<BranchRecord>& getRecords() const { return records; }
+
+    // The n branches causing the most redirects, most first
+    std::vector<BranchRecord> top(size_t n) const;
+
+    // Top-n table with each branch's share of all redirects
+    void printReport(std::ostream& out, size_t n) const;
+};
+
+// Remove "--profile <N>" from the arguments, wherever it is, setting top to N.
+// Returns false if N is missing or not a positive number.
+bool extractProfileOption(int& argc, char* argv[], size_t& top);
+
+#endif //BRANCHPROFILE_H
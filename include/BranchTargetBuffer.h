@@ -5,43 +5,196 @@
 #ifndef BRANCHTARGETBUFFER_H
 #define BRANCHTARGETBUFFER_H
 
-// Node for the doubly linked list
-struct BTBEntry {
-    int sourceAddr_tag; // Tag (source address of the branch)
-    int targetAddr_data; // Data (target address of the branch)
-    BTBEntry* prev; // Pointer to the previous node
-    BTBEntry* next; // Pointer to the next node
+#include "AddressIndex.h"
+#include "Arena.h"
+#include "StatsRegistry.h"
+#include "TagSearch.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class CheckpointReader;
+class CheckpointWriter;
+
+// Policy used to pick the victim way when a set is full
+enum class ReplacementPolicy {
+    LRU,    // True LRU, a linked list of slot indices per set
+    PLRU,   // Tree pseudo-LRU, one bit per internal node of the set
+    RANDOM  // Uniformly random way from a xorshift generator
+};
+
+// How entries move between the levels of a BTB hierarchy
+enum class BTBFillPolicy {
+    ALL,  // A taken branch missing every level is written into every level
+    LAST  // Only into the last level, the faster ones get it through promotion
+};
+
+enum class BTBPromotion {
+    ALL,  // A taken branch found in a slower level is copied into every faster level
+    NEXT, // Only into the level just above the one that supplied it
+    NONE  // Levels are only filled on a miss
+};
+
+// Faster BTB levels in front of the main BTB, counting the main BTB
+const int BTB_MAX_LEVELS = 4;
+
+// One of the faster levels in front of the main BTB
+struct BTBLevelConfig {
+    int entries = 0;
+    int associativity = 0;
+    ReplacementPolicy policy = ReplacementPolicy::LRU;
+    int latency = 0;
+};
+
+// Frontend cost model, in cycles. A taken branch whose target comes from a BTB level costs that
+// level's latency in fetch bubbles; one predicted taken without a target is redirected at
+// decode, and a wrong direction or a wrong target flushes the pipeline. Trace records are only
+// the branches, so the IPC estimate assumes instructionsPerBranch instructions per record,
+// fetched fetchWidth per cycle when nothing stalls.
+struct FrontendTiming {
+    int redirectPenalty = 3;
+    int flushPenalty = 14;
+    int instructionsPerBranch = 5;
+    int fetchWidth = 4;
+};
 
-    BTBEntry(int src, int tgt);
+// BTB geometry. associativity 0 (or >= entries) is fully associative,
+// 1 is direct-mapped and anything else is N-way set-associative.
+// A return address stack and an indirect target cache are off unless given a size; when on,
+// returns and indirect branches take their targets from them instead of the BTB.
+// fasterLevels puts smaller BTBs (L0, L1...) in front of this one, which is then the last level.
+struct BTBConfig {
+    int entries = 0;
+    int associativity = 0;
+    ReplacementPolicy policy = ReplacementPolicy::LRU;
+    int rasDepth = 0;
+    int indirectEntries = 0;
+    int latency = 0; // Fetch bubbles of a taken branch whose target comes from this level
+    std::vector<BTBLevelConfig> fasterLevels; // Fastest first
+    BTBFillPolicy fill = BTBFillPolicy::ALL;
+    BTBPromotion promotion = BTBPromotion::ALL;
+    FrontendTiming timing;
+};
+
+// A single BTB of the given geometry, with every other option left at its default
+inline BTBConfig makeBTBConfig(int entries, int associativity, ReplacementPolicy policy) {
+    BTBConfig config;
+    config.entries = entries;
+    config.associativity = associativity;
+    config.policy = policy;
+    return config;
+}
+
+// Result of one BTB probe: the set a branch maps to and its slot there, -1 on a miss. Lets the
+// update of a branch reuse its lookup instead of searching the set again.
+struct BTBSlot {
+    int set;
+    int slot;
+
+    bool hit() const { return slot != -1; }
 };
 
 class BranchTargetBuffer {
 private:
-    // Variables goes here
-    int capacity; // Maximum number of entries in the cache
-    BTBEntry* head; // Dummy head (most recently used)
-    BTBEntry* tail; // Dummy tail (least recently used)
-    BTBEntry** entries; // Fixed-size array to store cache entries
+    int capacity; // Total number of entries (sets * ways)
+    int ways; // Entries per set
+    int numSets;
+    ReplacementPolicy policy;
+    bool fullyAssociative;
+
+    // Entry storage, slot = set * ways + way
+    ArenaArray<int> tags;
+    ArenaArray<int> targets;
+    ArenaArray<int> fillCount; // Ways used so far in each set, filled in order
+
+    // LRU: doubly linked list of slots per set, MRU at the head
+    ArenaArray<int> lruPrev;
+    ArenaArray<int> lruNext;
+    ArenaArray<int> mruSlot;
+    ArenaArray<int> lruSlot;
 
-    // Helper functions for managing the doubly linked list
-    void addToFront(BTBEntry* entry) const;
+    // PLRU: binary tree bits per set, 0 = victim on the left, 1 = victim on the right
+    ArenaArray<uint8_t> plruBits;
+    int plruLeaves; // Ways rounded up to a power of two
 
-    static void removeNode(const BTBEntry* entry);
+    uint32_t randomState;
 
-    void moveToFront(BTBEntry* entry) const;
+    // Fully associative mode: tag -> slot
+    AddressIndex index;
+
+    // Vector tag compare for sets wide enough to gain from it, nullptr scans the ways inline
+    TagSearchFunction tagSearch;
+
+    uint64_t allocations; // Branches written into a way
+    uint64_t evictions; // Allocations that replaced a valid entry
+
+    int setIndex(int sourceAddr) const;
+    int findSlot(int set, int sourceAddr) const;
+    int chooseVictim(int set);
+    void touch(int set, int slot);
+    int allocate(int set, int sourceAddr, int targetAddr);
+
+    // Helper functions for managing the LRU list
+    void addToFront(int set, int slot);
+    void removeNode(int set, int slot);
 
 public:
 
-    BranchTargetBuffer(int cap);
+    // Every table comes from the arena, which must outlive the BTB. A BTB can be moved but not
+    // copied, a copy would share the tables.
+    BranchTargetBuffer(const BTBConfig& config, Arena& arena);
+
+    int getTargetAddress(int sourceAddr);
+
+    // Returns the source address of the entry it replaced, or -1 if nothing was evicted
+    int insert(int sourceAddr, int targetAddr);
+
+    // Single-probe access for the simulation loop: lookup searches the set once and promotes a
+    // hit in the replacement order, update then records the branch as taken through the same
+    // probe, rewriting a hit's target or allocating on a miss without searching or promoting
+    // again. Returns the evicted source address like insert. No other access may come between.
+    BTBSlot lookup(int sourceAddr);
+    int getTarget(const BTBSlot& entry) const { return entry.slot != -1 ? targets[entry.slot] : -1; }
+    int update(const BTBSlot& entry, int sourceAddr, int targetAddr);
 
-    ~BranchTargetBuffer();
+    // Start loading what a lookup of sourceAddr reads first: the tags and targets of its set,
+    // or its hash bucket when fully associative
+    void prefetch(int sourceAddr) const;
 
-    int getTargetAddress(int sourceAddr) const;
+    int getCapacity() const { return capacity; }
 
-    void insert(int sourceAddr, int targetAddr) const;
+    int getAssociativity() const { return ways; }
+
+    ReplacementPolicy getPolicy() const { return policy; }
+
+    // "<prefix>.allocations" and "<prefix>.evictions", counted since construction or the last reset
+    void registerStats(StatsRegistry& stats, const std::string& prefix = "btb") const;
+    void resetStatistics();
+
+    // Checkpointing of the entries and the replacement state. loadState fails, with the
+    // difference printed, if the checkpoint was taken with another geometry or policy.
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in);
 
 };
 
+// Short name used in reports ("lru", "plru", "random")
+const char* replacementPolicyName(ReplacementPolicy policy);
+
+// Parse a policy name as printed by replacementPolicyName, returns false if unknown
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy);
+
+// Parse a BTB spec "entries[:associativity[:policy[:ras<depth>][:ind<entries>]]]",
+// e.g. "1024:4:plru" or "1024:4:plru:ras16:ind512". Faster levels go in front, joined by '+',
+// each "entries[:associativity[:policy[:lat<cycles>]]]": "64:0:lru:lat0+4096:4:plru:lat2".
+// The last level also takes lat<cycles>, fill-last, promote-next, promote-none and the timing
+// fields redirect<cycles>, flush<cycles>, ipb<instructions per branch> and width<instructions>.
+// A level without lat<cycles> has its position as latency, L0 0 cycles, L1 1 and so on.
+bool parseBTBConfig(const std::string& spec, BTBConfig& config);
+
+// Short names of the policies, as in the spec ("all", "last"; "all", "next", "none")
+const char* fillPolicyName(BTBFillPolicy fill);
+const char* promotionName(BTBPromotion promotion);
 
 
 #endif //BRANCHTARGETBUFFER_H
@@ -0,0 +1,148 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <cstdint>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+/*
+* Checkpoint format, version 2. All integers are little-endian.
+*
+*   header:   magic "BPCKPT\0\0", u16 version, u16 reserved, u32 reserved,
+*             u64 trace offset (instructions simulated before the snapshot),
+*             u32 length and the bytes of the direction predictor's name
+*   sections: whether the run has a return address stack and an indirect target cache, the
+*             number of BTB levels, the main BTB, the faster BTB levels fastest first, return
+*             address stack, indirect target cache, direction predictor, each written by the
+*             component's saveState and starting with its geometry.
+*             A vector is a u64 element count followed by the elements.
+*
+* Version 2 added the BTB level count and the faster levels.
+*
+* Only state that changes the predictions is saved, the statistics are not: a restored run
+* counts from zero, from the instruction after the checkpoint on.
+*/
+
+const uint16_t CHECKPOINT_VERSION = 2;
+
+// Accumulates a snapshot in memory, written out in one go
+class CheckpointWriter {
+private:
+    std::vector<uint8_t> data;
+
+public:
+    CheckpointWriter(const std::string& predictorName, uint64_t traceOffset);
+
+    // Integers, enums and bools, in sizeof(T) little-endian bytes
+    template <typename T>
+    void put(T value) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "put takes integers and enums");
+        uint64_t bits = static_cast<uint64_t>(value);
+        for (size_t i = 0; i < sizeof(T); i++) {
+            data.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+        }
+    }
+
+    // A std::vector or ArenaArray of integers or enums
+    template <typename Values>
+    void putVector(const Values& values) {
+        put<uint64_t>(values.size());
+        for (const auto& value : values) {
+            put(value);
+        }
+    }
+
+    // Returns false, with the error printed, if the file cannot be written
+    bool writeFile(const std::string& filename) const;
+};
+
+// Reads a whole snapshot file. Every get fails once the data runs out or a check has failed,
+// so a component can read all its fields and test ok() at the end.
+class CheckpointReader {
+private:
+    std::vector<uint8_t> data;
+    size_t position;
+    bool failed;
+    uint64_t traceOffset;
+    std::string predictorName;
+
+public:
+    // Reads and checks the header, errors are printed
+    explicit CheckpointReader(const std::string& filename);
+
+    bool ok() const { return !failed; }
+
+    // Mark the checkpoint unusable, printing "Error: <message>" for the first failure only
+    void fail(const std::string& message);
+    uint64_t getTraceOffset() const { return traceOffset; }
+    const std::string& getPredictorName() const { return predictorName; }
+
+    template <typename T>
+    bool get(T& value) {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "get takes integers and enums");
+        if (failed) {
+            return false;
+        }
+        if (data.size() - position < sizeof(T)) {
+            fail("Checkpoint is truncated");
+            return false;
+        }
+        uint64_t bits = 0;
+        for (size_t i = 0; i < sizeof(T); i++) {
+            bits |= static_cast<uint64_t>(data[position++]) << (8 * i);
+        }
+        value = static_cast<T>(bits);
+        return true;
+    }
+
+    // The stored vector must have exactly as many elements as values already holds, the
+    // size the component was constructed with
+    template <typename Values>
+    bool getVector(Values& values) {
+        uint64_t count = 0;
+        if (!get(count)) {
+            return false;
+        }
+        if (count != values.size()) {
+            fail("Checkpoint table of " + std::to_string(count) + " entries does not match this run's " +
+                 std::to_string(values.size()));
+            return false;
+        }
+        for (auto& value : values) {
+            get(value);
+        }
+        return !failed;
+    }
+
+    // Read a geometry field and compare it with the expected value, printing what differs
+    template <typename T>
+    bool expect(T expected, const char* what) {
+        T stored;
+        if (get(stored) && stored != expected) {
+            fail("Checkpoint " + std::string(what) + " is " + std::to_string(static_cast<long long>(stored)) + ", this run has " +
+                 std::to_string(static_cast<long long>(expected)));
+        }
+        return !failed;
+    }
+
+    // Fails if anything is left after the last section
+    bool finish();
+};
+
+// Checkpointing of a single run: "--checkpoint <N> <file>" simulates the first N instructions,
+// writes the predictor state and stops; "--restore <file>" loads it and simulates the rest of
+// the trace from instruction N on. Both may be given to advance a checkpoint.
+struct CheckpointOptions {
+    uint64_t saveAt = 0;
+    std::string saveFile;
+    std::string restoreFile;
+
+    bool requested() const { return saveAt > 0 || !restoreFile.empty(); }
+};
+
+// Remove "--checkpoint <N> <file>" and "--restore <file>" from the arguments, wherever they are.
+// Returns false if a value is missing or N is not a positive number.
+bool extractCheckpointOptions(int& argc, char* argv[], CheckpointOptions& options);
+
+#endif //CHECKPOINT_H
@@ -0,0 +1,29 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+#include "BranchTargetBuffer.h"
+#include "PredictorRegistry.h"
+#include "StatsRegistry.h"
+#include <string>
+
+// The command line of a single run, "<trace_file> <btb_size> [associativity] [lru|plru|random]"
+// plus the options that may appear anywhere
+struct SingleRun {
+    std::string traceFile;
+    BTBConfig btb; // Geometry and policy, with the --ras and --indirect target predictors
+    RunOptions options; // --profile, --intervals, --checkpoint and --restore
+    StatsOutput statsOutput; // --stats-json and --stats-csv
+};
+
+// Front end shared by the simulator binaries. Extracts the options every mode takes, then runs
+// --sweep, --batch, --parallel or --sample if argv[1] names one, or else parses a single run.
+// Returns true if the caller should simulate that run, whose arguments from argv[5] on are its
+// own; otherwise the program is done and status is its exit code. With predictorArgument the
+// usage also lists the [predictor] argument and the predictor specs.
+bool dispatchCommandLine(int& argc, char* argv[], bool predictorArgument, SingleRun& run, int& status);
+
+// Optional count argument argv[i], left unchanged when absent. False, with the allowed range
+// printed, if it is not a whole number from minimum to maximum.
+bool parseCountArgument(int argc, char* argv[], int i, const char* name, long minimum, long maximum, long& value);
+
+#endif //COMMANDLINE_H
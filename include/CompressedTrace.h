@@ -0,0 +1,49 @@
+#ifndef COMPRESSEDTRACE_H
+#define COMPRESSEDTRACE_H
+
+#include "MappedFile.h"
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+enum class TraceCompression {
+    NONE,
+    GZIP,
+    ZSTD,
+    LZ4
+};
+
+// Compression format from the file's magic bytes
+TraceCompression detectCompression(const char* data, size_t size);
+
+// Short name used in messages ("gzip", "zstd", "lz4")
+const char* compressionName(TraceCompression compression);
+
+// True if this build links the library for the format (BRANCHSIM_HAVE_ZLIB/ZSTD/LZ4)
+bool isCompressionSupported(TraceCompression compression);
+
+// Streams the decompressed contents of a compressed trace in file order, a block at a time.
+// Files made of independently compressed blocks are decompressed on worker threads, a bounded
+// number of blocks ahead of the reader: BGZF gzip (as written by bgzip) and zstd files of
+// several frames (pzstd, or concatenated zstd files). Anything else, including plain gzip and
+// lz4 frames, streams on the calling thread.
+class TraceDecompressor {
+protected:
+    bool error = false;
+
+public:
+    virtual ~TraceDecompressor() = default;
+
+    // Append the next decompressed block to out. Returns false at the end of the data, or on a
+    // corrupt or truncated stream, in which case the error has been printed and hasError is set.
+    virtual bool readBlock(std::vector<char>& out) = 0;
+
+    bool hasError() const { return error; }
+};
+
+// Decompressor over a whole compressed file. threads <= 0 uses one worker per hardware thread
+// for block-parallel files. Returns nullptr, with an error printed, if the build lacks the format.
+std::unique_ptr<TraceDecompressor> openDecompressor(std::unique_ptr<MappedFile> file, TraceCompression compression,
+                                                    int threads = 0);
+
+#endif //COMPRESSEDTRACE_H
@@ -0,0 +1,64 @@
+#ifndef GSHAREPREDICTOR_H
+#define GSHAREPREDICTOR_H
+
+#include "BranchTargetBuffer.h"
+#include "PackedCounterTable.h"
+#include "PredictorConfig.h"
+#include "StatsRegistry.h"
+#include <cstdint>
+
+// McFarling's gshare: global branch history XORed with the branch address indexes one table
+// of 2-bit counters. Spec "gshare[:tableBits[:historyBits]]", default 2^14 counters (4KB)
+// and as many history bits as index bits. Longer histories are folded into the index.
+class GsharePredictor {
+private:
+    PackedCounterTable table;
+    int tableBits;
+    int historyBits;
+    uint64_t history; // Most recent outcome in bit 0
+    uint64_t historyMask;
+
+    uint32_t index(int sourceAddr) const {
+        uint32_t folded = static_cast<uint32_t>(history);
+        for (int shift = tableBits; shift < historyBits; shift += tableBits) {
+            folded ^= static_cast<uint32_t>(history >> shift);
+        }
+        // Instructions are word aligned, the low address bits carry no information
+        return (static_cast<uint32_t>(sourceAddr) >> 2) ^ folded;
+    }
+
+public:
+    GsharePredictor(const BTBConfig& btb, const PredictorConfig& config, Arena& arena);
+
+    bool predict(int sourceAddr, bool) const { return table.predict(index(sourceAddr)); }
+
+    // The history a later branch is looked up with is not known yet
+    void prefetch(int) const {}
+
+    void update(int sourceAddr, bool taken) {
+        table.update(index(sourceAddr), taken);
+        history = ((history << 1) | static_cast<uint64_t>(taken)) & historyMask;
+    }
+
+    size_t getTableBytes() const { return table.bytes(); }
+
+    void registerStats(StatsRegistry& stats) const {
+        stats.label("gshare.counters", static_cast<uint64_t>(table.getMask()) + 1);
+        stats.label("gshare.history_bits", static_cast<uint64_t>(historyBits));
+    }
+
+    void saveState(CheckpointWriter& out) const {
+        out.put<int32_t>(historyBits);
+        table.saveState(out);
+        out.put(history);
+    }
+
+    bool loadState(CheckpointReader& in) {
+        return in.expect<int32_t>(historyBits, "gshare history bits") && table.loadState(in) && in.get(history);
+    }
+
+    static const char* name() { return "gshare"; }
+    static const char* displayName() { return "Gshare"; }
+};
+
+#endif //GSHAREPREDICTOR_H
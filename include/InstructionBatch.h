@@ -0,0 +1,114 @@
+#ifndef INSTRUCTIONBATCH_H
+#define INSTRUCTIONBATCH_H
+
+#include "TargetPredictor.h"
+#include "TraceReader.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Instructions in a block, one bit of each flag mask
+const size_t INSTRUCTION_BLOCK_SIZE = 64;
+
+inline int countBits(uint64_t value) {
+#ifdef _MSC_VER
+    return static_cast<int>(__popcnt64(value));
+#else
+    return __builtin_popcountll(value);
+#endif
+}
+
+// Up to 64 consecutive instructions as the simulation loop reads them: pointers into the address
+// columns and instruction i's flags in bit i of each mask. Bits past count are zero.
+struct InstructionBlock {
+    const int* sourceAddrs;
+    const int* targetAddrs;
+    size_t count;
+    size_t lookahead; // Source addresses readable past count, for prefetching
+    uint64_t taken;
+    uint64_t backward;
+    uint64_t classLow; // Bit 0 of each instruction's BranchClass
+    uint64_t classHigh; // Bit 1
+
+    uint64_t valid() const { return count >= INSTRUCTION_BLOCK_SIZE ? ~uint64_t(0) : (uint64_t(1) << count) - 1; }
+
+    bool isTaken(size_t i) const { return (taken >> i) & 1; }
+
+    BranchClass branchClass(size_t i) const {
+        return static_cast<BranchClass>((((classHigh >> i) & 1) << 1) | ((classLow >> i) & 1));
+    }
+
+    // The instructions of one class
+    uint64_t classMask(BranchClass branchClass) const {
+        int code = static_cast<int>(branchClass);
+        return ((code & 1) ? classLow : ~classLow) & ((code & 2) ? classHigh : ~classHigh) & valid();
+    }
+};
+
+// Instructions stored by column for simulation: the source and target addresses as int arrays and
+// the taken, backward and branch class flags packed 64 to a word, about 8.5 bytes a branch
+// against 12 for an Instruction. Only what the simulation reads is kept, so record types other
+// than B, C, R and I become direct branches as classifyBranch makes them.
+class InstructionBatch {
+private:
+    std::vector<int> sourceAddrs;
+    std::vector<int> targetAddrs;
+    std::vector<uint64_t> takenBits;
+    std::vector<uint64_t> backwardBits;
+    std::vector<uint64_t> classLowBits;
+    std::vector<uint64_t> classHighBits;
+
+    // The 64 bits from bit begin on, zero past the last word
+    static uint64_t bitsAt(const std::vector<uint64_t>& words, size_t begin) {
+        size_t word = begin / 64;
+        unsigned shift = static_cast<unsigned>(begin % 64);
+        uint64_t bits = words[word] >> shift;
+        if (shift != 0 && word + 1 < words.size()) {
+            bits |= words[word + 1] << (64 - shift);
+        }
+        return bits;
+    }
+
+    static bool bitAt(const std::vector<uint64_t>& words, size_t i) { return (words[i / 64] >> (i % 64)) & 1; }
+
+public:
+    InstructionBatch() {}
+    explicit InstructionBatch(const std::vector<Instruction>& instructions);
+
+    size_t size() const { return sourceAddrs.size(); }
+    bool empty() const { return sourceAddrs.empty(); }
+
+    void clear();
+    void reserve(size_t count);
+    void push_back(const Instruction& instr);
+    void append(const Instruction* instructions, size_t count);
+
+    int sourceAddr(size_t i) const { return sourceAddrs[i]; }
+    int targetAddr(size_t i) const { return targetAddrs[i]; }
+    bool taken(size_t i) const { return bitAt(takenBits, i); }
+    bool backward(size_t i) const { return bitAt(backwardBits, i); }
+    BranchClass branchClass(size_t i) const {
+        return static_cast<BranchClass>((bitAt(classHighBits, i) << 1) | bitAt(classLowBits, i));
+    }
+
+    // The count instructions from begin, 1 to INSTRUCTION_BLOCK_SIZE of them
+    InstructionBlock block(size_t begin, size_t count) const {
+        InstructionBlock result;
+        result.sourceAddrs = sourceAddrs.data() + begin;
+        result.targetAddrs = targetAddrs.data() + begin;
+        result.count = count;
+        result.lookahead = size() - begin - count;
+        uint64_t valid = result.valid();
+        result.taken = bitsAt(takenBits, begin) & valid;
+        result.backward = bitsAt(backwardBits, begin) & valid;
+        result.classLow = bitsAt(classLowBits, begin) & valid;
+        result.classHigh = bitsAt(classHighBits, begin) & valid;
+        return result;
+    }
+};
+
+#endif //INSTRUCTIONBATCH_H
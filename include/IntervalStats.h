@@ -0,0 +1,110 @@
+#ifndef INTERVALSTATS_H
+#define INTERVALSTATS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Time series of a simulation: the statistics of every window of `length` instructions,
+// streamed to a file as each window closes. A file name ending in ".csv" gets a CSV table,
+// anything else the packed binary layout (all integers little-endian):
+//
+//   header (24 bytes): magic "BPIVAL\0\0", u32 version, u32 fields per record, u64 window length
+//   records:           u64 first instruction, instructions, prediction hits, static hits,
+//                      BTB hits, BTB misses, BTB evictions, distinct PCs
+//
+// The last window may be shorter than the others. Returns and indirect branches that take their
+// targets from the return address stack or indirect target cache are neither BTB hits nor
+// misses, so the BTB hit rate is hits over hits and misses.
+//
+// Version 2 added the BTB misses.
+const uint32_t INTERVAL_STATS_VERSION = 2;
+
+class IntervalStats {
+private:
+    size_t length;
+    bool csv;
+    std::ofstream out;
+    std::vector<uint8_t> buffer; // Binary records not written yet
+
+    // Counters of the open window
+    uint32_t window; // Current window, from 1
+    uint64_t start;
+    uint64_t instructions;
+    uint64_t predictionHits;
+    uint64_t staticHits;
+    uint64_t btbHits;
+    uint64_t btbMisses;
+    uint64_t evictions;
+    uint64_t uniquePCs;
+
+    // Source addresses seen so far, stamped with the last window (from 1) each was seen in,
+    // so a window's distinct PCs are counted without clearing anything
+    std::vector<int> keys;
+    std::vector<uint32_t> stamps; // 0 = free bucket
+    uint32_t mask;
+    size_t distinct;
+    bool closedCleanly;
+
+    static uint32_t hash(int key) {
+        uint32_t h = static_cast<uint32_t>(key) * 0x9E3779B1u;
+        return h ^ (h >> 16);
+    }
+
+    void markSeen(int sourceAddr) {
+        uint32_t i = hash(sourceAddr) & mask;
+        while (stamps[i] != 0 && keys[i] != sourceAddr) {
+            i = (i + 1) & mask;
+        }
+        if (stamps[i] == window) {
+            return; // Already counted in this window
+        }
+        uniquePCs++;
+        if (stamps[i] == 0) {
+            keys[i] = sourceAddr;
+            distinct++;
+        }
+        stamps[i] = window;
+        if (distinct * 2 > stamps.size()) {
+            grow();
+        }
+    }
+
+    void grow();
+    void closeWindow();
+
+public:
+    IntervalStats(size_t length, const std::string& filename);
+    ~IntervalStats();
+
+    IntervalStats(const IntervalStats&) = delete;
+    IntervalStats& operator=(const IntervalStats&) = delete;
+
+    bool isOpen() const { return out.is_open(); }
+
+    // lookedUp is false for a branch that bypassed the BTB
+    void record(int sourceAddr, bool taken, bool inBTB, bool lookedUp, bool correct, bool evicted) {
+        instructions++;
+        predictionHits += correct;
+        staticHits += inBTB == taken;
+        btbHits += lookedUp && inBTB;
+        btbMisses += lookedUp && !inBTB;
+        evictions += evicted;
+        markSeen(sourceAddr);
+        if (instructions == length) {
+            closeWindow();
+        }
+    }
+
+    // Write the partial last window and close the file, returns false on I/O error.
+    // Later calls return the same result.
+    bool finish();
+};
+
+// Remove "--intervals <N> <file>" from the arguments, wherever it is.
+// Returns false if the length or file name is missing.
+bool extractIntervalOption(int& argc, char* argv[], size_t& length, std::string& filename);
+
+#endif //INTERVALSTATS_H
@@ -0,0 +1,38 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+// Read-only view of a whole file. Uses mmap where available so the trace is parsed in place
+// straight out of the page cache, and falls back to reading the file into a buffer elsewhere.
+class MappedFile {
+private:
+    const char* mapped;
+    size_t length;
+    bool opened;
+    bool memoryMapped; // True if mapped must be munmap'd
+    std::vector<char> buffer; // Fallback storage when the file could not be mapped
+    size_t released; // Bytes already handed back to the kernel
+
+    // Read a descriptor that cannot be mapped to its end into buffer, false on a read error
+    bool readAll(int fd);
+
+public:
+    MappedFile(const std::string& filename);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return mapped; }
+    size_t size() const { return length; }
+
+    // Drop the pages of [0, upTo) that are no longer needed, so streaming through a
+    // large trace keeps a constant resident size. No-op when the file is buffered.
+    void release(size_t upTo);
+};
+
+#endif //MAPPEDFILE_H
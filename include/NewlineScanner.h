@@ -0,0 +1,78 @@
+#ifndef NEWLINESCANNER_H
+#define NEWLINESCANNER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Hands out the positions of '\n' in a buffer in order. Each 64 byte block is turned into a
+// bitmask of newlines with four SSE2 compares, then line ends are popped off the mask one bit
+// at a time, so finding a line end costs a couple of instructions instead of a byte loop.
+class NewlineScanner {
+private:
+    const char* block;
+    const char* end;
+    uint64_t mask;
+
+    static int countTrailingZeros(uint64_t value) {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, value);
+        return static_cast<int>(index);
+#else
+        return __builtin_ctzll(value);
+#endif
+    }
+
+    uint64_t blockMask(const char* p) const {
+        uint64_t result = 0;
+#ifdef __SSE2__
+        if (end - p >= 64) {
+            const __m128i newline = _mm_set1_epi8('\n');
+            for (int i = 0; i < 4; i++) {
+                __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 16 * i));
+                uint64_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline)));
+                result |= bits << (16 * i);
+            }
+            return result;
+        }
+#endif
+        ptrdiff_t count = end - p < 64 ? end - p : 64;
+        for (ptrdiff_t i = 0; i < count; i++) {
+            result |= static_cast<uint64_t>(p[i] == '\n') << i;
+        }
+        return result;
+    }
+
+public:
+    NewlineScanner() : block(nullptr), end(nullptr), mask(0) {}
+
+    NewlineScanner(const char* begin, const char* end) : block(begin), end(end), mask(0) {
+        if (begin < end) {
+            mask = blockMask(begin);
+        }
+    }
+
+    // Position of the next newline, or end if there are none left
+    const char* next() {
+        while (mask == 0) {
+            if (end - block <= 64) {
+                block = end;
+                return end;
+            }
+            block += 64;
+            mask = blockMask(block);
+        }
+        const char* found = block + countTrailingZeros(mask);
+        mask &= mask - 1;
+        return found;
+    }
+};
+
+#endif //NEWLINESCANNER_H
@@ -0,0 +1,59 @@
+#ifndef PACKEDCOUNTERTABLE_H
+#define PACKEDCOUNTERTABLE_H
+
+#include "Arena.h"
+#include "Checkpoint.h"
+#include "Prefetch.h"
+#include <cstdint>
+
+// Power-of-two table of 2-bit saturating counters packed 32 to a 64-bit word, so a 16K-entry
+// pattern history table is 4KB and stays in L1. Indices are masked, never reduced with a modulo.
+class PackedCounterTable {
+private:
+    ArenaArray<uint64_t> words;
+    uint32_t mask;
+
+public:
+    // No counters, a placeholder to move a sized table into
+    PackedCounterTable() : mask(0) {}
+
+    // 2^log2Entries counters from the arena, all starting at initial (0..3, default weakly taken)
+    PackedCounterTable(int log2Entries, Arena& arena, int initial = 2)
+        : words(arena, ((size_t(1) << log2Entries) + 31) / 32, 0x5555555555555555ull * static_cast<uint64_t>(initial & 3)),
+          mask(static_cast<uint32_t>((size_t(1) << log2Entries) - 1)) {}
+
+    uint32_t getMask() const { return mask; }
+    size_t size() const { return size_t(mask) + 1; }
+    size_t bytes() const { return words.size() * sizeof(uint64_t); }
+
+    int get(uint32_t index) const {
+        index &= mask;
+        return static_cast<int>((words[index >> 5] >> ((index & 31) * 2)) & 3);
+    }
+
+    void prefetch(uint32_t index) const { prefetchRead(&words[(index & mask) >> 5]); }
+
+    // Counter in the upper half means taken
+    bool predict(uint32_t index) const { return get(index) >= 2; }
+
+    void update(uint32_t index, bool taken) {
+        index &= mask;
+        uint64_t& word = words[index >> 5];
+        unsigned shift = (index & 31) * 2;
+        uint64_t counter = (word >> shift) & 3;
+        uint64_t next = taken ? counter + (counter < 3) : counter - (counter > 0);
+        word ^= (counter ^ next) << shift;
+    }
+
+    // Checkpointing of the counters, loadState fails if the table size differs
+    void saveState(CheckpointWriter& out) const {
+        out.put<uint32_t>(mask);
+        out.putVector(words);
+    }
+
+    bool loadState(CheckpointReader& in) {
+        return in.expect<uint32_t>(mask, "counter table size") && in.getVector(words);
+    }
+};
+
+#endif //PACKEDCOUNTERTABLE_H
@@ -0,0 +1,37 @@
+#ifndef PARALLELRUNNER_H
+#define PARALLELRUNNER_H
+
+#include "BranchTargetBuffer.h"
+#include "InstructionBatch.h"
+#include "PredictorConfig.h"
+#include "SweepRunner.h"
+#include "TraceReader.h"
+#include <cstddef>
+#include <vector>
+
+// Approximate parallel simulation of one trace. The trace is split into equal chunks that are
+// simulated concurrently, each by its own BTB and predictor. Before measuring, a chunk replays
+// the last warmup instructions of the chunk before it with statistics off, so its BTB and
+// counters start close to the state a serial run would have; the chunk statistics are summed.
+// The first chunk starts cold, exactly as the serial run does.
+class ParallelRunner {
+private:
+    SweepConfig config;
+    size_t chunks;
+    size_t warmup;
+    int threads;
+
+public:
+    ParallelRunner(const SweepConfig& config, size_t chunks, size_t warmup, int threads);
+
+    // Simulate the instructions in parallel chunks and merge the chunk statistics
+    SweepResult simulate(const InstructionBatch& instructions) const;
+
+    // Simulate serially, the exact reference
+    SweepResult simulateExact(const InstructionBatch& instructions) const;
+};
+
+// Handle "--parallel <trace_file> <btb_spec> <predictor_spec> [chunks [warmup [threads]]] [--no-exact]"
+int runParallelCommand(int argc, char* argv[], const StatsOutput& statsOutput);
+
+#endif //PARALLELRUNNER_H
@@ -0,0 +1,24 @@
+#ifndef PREDICTORCONFIG_H
+#define PREDICTORCONFIG_H
+
+#include <string>
+#include <vector>
+
+// Direction predictor selection, "name[:param[:param...]]", e.g. "gshare:14:12".
+// The meaning of the parameters belongs to each predictor, missing ones take its defaults,
+// and they are independent of the BTB geometry.
+struct PredictorConfig {
+    std::string name = "twobit";
+    std::vector<int> params;
+
+    // Parameter i, or fallback if it was not given
+    int param(size_t i, int fallback) const { return i < params.size() ? params[i] : fallback; }
+};
+
+// Parse a predictor spec, returns false if it is malformed (unknown names are checked by the registry)
+bool parsePredictorConfig(const std::string& spec, PredictorConfig& config);
+
+// The spec again, as printed in reports
+std::string predictorConfigName(const PredictorConfig& config);
+
+#endif //PREDICTORCONFIG_H
@@ -0,0 +1,36 @@
+#ifndef PREDICTORREGISTRY_H
+#define PREDICTORREGISTRY_H
+
+#include "BranchTargetBuffer.h"
+#include "Checkpoint.h"
+#include "PredictorConfig.h"
+#include "SweepRunner.h"
+#include <memory>
+#include <string>
+
+// Every direction predictor by spec name. Adding a predictor means writing its policy class
+// and adding it to forEachPredictorType in PredictorRegistry.cpp.
+
+// Check the name and parameter ranges, printing the reason to std::cerr if the spec is rejected
+bool validatePredictorConfig(const PredictorConfig& config);
+
+// One line per predictor with its spec syntax, for usage messages
+const char* predictorUsage();
+
+// Create the simulated configuration for a validated spec, its tables in arena
+std::unique_ptr<SweepTarget> makeSweepTarget(const PredictorConfig& predictor, const BTBConfig& btb, Arena& arena);
+
+// Optional extras of a single run
+struct RunOptions {
+    size_t profileTop = 0; // Profile every branch and print this many of the costliest
+    size_t intervalLength = 0; // Stream the statistics of every window this long...
+    std::string intervalFile; // ...to this file
+    CheckpointOptions checkpoint; // Resume from and/or stop at a checkpoint
+};
+
+// Simulate a whole trace with one predictor, print its statistics and register them in stats.
+// Returns false if an output file could not be written or a checkpoint could not be restored.
+bool runPredictorSimulation(const PredictorConfig& predictor, const BTBConfig& btb, const std::string& traceFile,
+                            StatsRegistry& stats, const RunOptions& options = RunOptions());
+
+#endif //PREDICTORREGISTRY_H
@@ -0,0 +1,20 @@
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+// Ask for the cache line holding address ahead of a read. Only a hint: it never faults and
+// does nothing where the compiler has no prefetch instruction.
+inline void prefetchRead(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    (void)address;
+#endif
+}
+
+#endif //PREFETCH_H
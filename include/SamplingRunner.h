@@ -0,0 +1,90 @@
+#ifndef SAMPLINGRUNNER_H
+#define SAMPLINGRUNNER_H
+
+#include "BranchTargetBuffer.h"
+#include "InstructionBatch.h"
+#include "PredictorConfig.h"
+#include "SweepRunner.h"
+#include "TraceReader.h"
+#include <cstddef>
+#include <string>
+#include <vector>
+
+enum class SamplingMethod {
+    PERIODIC, // SMARTS: one sample every trace length / samples instructions
+    SIMPOINT  // Cluster fixed intervals by branch-address profile, sample within each cluster
+};
+
+// What the simulator does with the instructions between samples
+enum class WarmingMode {
+    NONE, // Skip them, state goes stale
+    BTB,  // Functional warming: keep the BTB up to date, no predictor or statistics
+    FULL  // Functional warming of the direction predictor too, still no statistics
+};
+
+// Sampling spec:
+//   periodic[:samples[:unit[:warmup]]]                 default periodic:100:1000:5000
+//   simpoint[:clusters[:perCluster[:interval[:warmup]]]] default simpoint:10:3:10000:5000
+// unit/interval is the number of measured instructions per sample, warmup the number of
+// detailed instructions simulated with statistics off right before it.
+struct SamplingConfig {
+    SamplingMethod method = SamplingMethod::PERIODIC;
+    size_t samples = 100;   // Periodic: samples, SimPoint: clusters
+    size_t perCluster = 3;  // SimPoint only
+    size_t unit = 1000;
+    size_t warmup = 5000;
+    WarmingMode warming = WarmingMode::BTB;
+};
+
+bool parseSamplingConfig(const std::string& spec, SamplingConfig& config);
+bool parseWarmingMode(const std::string& name, WarmingMode& mode);
+const char* warmingModeName(WarmingMode mode);
+
+// A rate in percent with the half-width of its 95% confidence interval
+struct SampledMetric {
+    double estimate;
+    double halfWidth;
+};
+
+struct SamplingResult {
+    size_t samples;
+    size_t strata;
+    long long totalInstructions;
+    long long measuredInstructions;
+    long long detailedInstructions; // Measured plus detailed warm-up
+    long long warmedInstructions;   // Functionally warmed or fully simulated between samples
+    SampledMetric accuracy;
+    SampledMetric btbHitRate;
+    SampledMetric staticAccuracy;
+    double accuracyStdDev; // Of the per-sample accuracy, in percentage points
+};
+
+// Sampled simulation of one trace. Only short units of the trace are measured in detail; the
+// full-trace rates are estimated from them with a stratified estimator (periodic sampling is the
+// single-stratum case, SimPoint clusters are the strata), so every estimate comes with a
+// confidence interval derived from the spread between samples.
+class SamplingRunner {
+private:
+    struct Sample {
+        size_t begin;
+        size_t end;
+        int stratum;
+    };
+
+    SweepConfig config;
+    SamplingConfig sampling;
+
+    // Samples in trace order, plus how many units of the trace each stratum holds
+    std::vector<Sample> choosePeriodic(size_t count, std::vector<size_t>& strataUnits) const;
+    std::vector<Sample> chooseSimPoints(const InstructionBatch& instructions, std::vector<size_t>& strataUnits) const;
+
+public:
+    SamplingRunner(const SweepConfig& config, const SamplingConfig& sampling);
+
+    SamplingResult simulate(const InstructionBatch& instructions) const;
+};
+
+// Handle "--sample <trace_file> <btb_spec> <predictor_spec> [sampling_spec [none|btb|full]] [--no-exact]"
+int runSampleCommand(int argc, char* argv[]);
+
+#endif //SAMPLINGRUNNER_H
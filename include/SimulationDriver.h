@@ -0,0 +1,647 @@
+#ifndef SIMULATIONDRIVER_H
+#define SIMULATIONDRIVER_H
+
+#include "Arena.h"
+#include "BTBHierarchy.h"
+#include "BranchProfile.h"
+#include "BranchTargetBuffer.h"
+#include "Checkpoint.h"
+#include "IntervalStats.h"
+#include "InstructionBatch.h"
+#include "PredictorConfig.h"
+#include "StatsRegistry.h"
+#include "TargetPredictor.h"
+#include "TraceReader.h"
+#include "TraceStream.h"
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A direction predictor is any type with:
+//
+//     Predictor(const BTBConfig& btb, const PredictorConfig& config, Arena& arena);
+//                                                      // Sizes from the spec, tables from arena
+//     bool predict(int sourceAddr, bool inBTB);        // Predicted direction of this branch
+//     void update(int sourceAddr, bool taken);         // Train on the actual outcome
+//     void prefetch(int sourceAddr) const;             // A few branches ahead, may do nothing
+//     static const char* name();                       // Spec name, e.g. "twobit"
+//     static const char* displayName();                // Report heading, e.g. "Two-Bit"
+//     void registerStats(StatsRegistry& stats) const;  // Table sizes etc. under "<name>.", may add nothing
+//     void saveState(CheckpointWriter& out) const;     // Geometry, then every table and history
+//     bool loadState(CheckpointReader& in);            // The same, false if the geometry differs
+//
+// update is always called right after predict for the same branch, so a predictor may keep
+// whatever it computed in predict for the update.
+//
+// SimulationDriver owns the BTB, the statistics and the trace loop, and takes the predictor as a
+// template parameter so predict/update inline into the per-instruction loop. Every predictor is
+// also scored against the static "taken iff in the BTB" baseline, which costs nothing extra.
+// Targets are scored per branch class; when the BTBConfig sizes a return address stack or an
+// indirect target cache, returns or indirect branches take their targets from it and never
+// look up or allocate BTB entries (the BTB hit and miss counts only cover real lookups).
+// With faster BTB levels configured the lookups go through a BTBHierarchy in front of the BTB.
+// Every run also keeps the frontend timing counters: fetch bubbles from the latency of the level
+// that supplied each taken branch's target, decode redirects and pipeline flushes.
+//
+// The loop reads InstructionBatch columns 64 instructions at a time. Each branch only sets its
+// outcome bits, and the statistics of a block are counted from the bit masks when it is done.
+// With a BTB too large for the caches, the BTB set and predictor entry of the branch
+// PREFETCH_DISTANCE ahead are prefetched.
+//
+// The tables of the BTB, the predictor and the target predictors all come from one arena, the
+// caller's or the driver's own, so building a driver costs a few large allocations at most and
+// freeing it none beyond the arena's blocks.
+template <typename Predictor>
+class SimulationDriver {
+private:
+    Arena ownArena; // Holds the tables when no arena is passed in, first so it outlives them
+    BranchTargetBuffer btb;
+    std::unique_ptr<BTBHierarchy> hierarchy; // Faster levels in front of btb, only when configured
+    Predictor predictor;
+    ReturnAddressStack ras;
+    IndirectTargetCache indirect;
+    bool useRAS;
+    bool useIndirect;
+    FrontendTiming timing;
+    int btbLatency; // Bubbles of a target from btb without faster levels
+    int sideLatency; // Bubbles of a target from the return address stack or indirect target cache
+
+    // Statistics
+    long long btbHits;
+    long long btbMisses;
+    long long predictionHits;
+    long long predictionMisses;
+    long long staticPredictionHits;
+    long long btbHitButMispredicted;
+    TargetCounters targetCounters[BRANCH_CLASS_COUNT];
+
+    // Frontend timing: correctly predicted taken branches by where their right target came from
+    // (each BTB level, then the side predictors), without one (decode redirects) and with a
+    // wrong one (flushes, like the direction mispredictions)
+    long long suppliedTargets[BTB_MAX_LEVELS + 1];
+    long long redirects;
+    long long wrongTargets;
+
+    static constexpr int SIDE_LEVEL = BTB_MAX_LEVELS;
+
+    // Outcome bits of one block, instruction i in bit i
+    struct BlockOutcomes {
+        uint64_t inBTB = 0;
+        uint64_t correct = 0;
+        uint64_t targetHit = 0;
+        uint64_t noTarget = 0; // Nothing supplied a target
+    };
+
+    // Branches between a prefetch and the lookup it is for
+    static constexpr size_t PREFETCH_DISTANCE = 8;
+
+    // BTB entries from which on the tags and targets (8 bytes an entry) outgrow a typical L2 and
+    // prefetching pays; smaller tables stay cached and the prefetches would only add work
+    static constexpr int PREFETCH_MIN_ENTRIES = 1 << 17;
+    bool prefetching;
+
+    // Whole records transposed for the loop, a slice at a time
+    static constexpr size_t TRANSPOSE_SLICE = 4096;
+    InstructionBatch transposed;
+
+    // Per-branch counters and the interval time series, only allocated when asked for
+    std::unique_ptr<BranchProfile> profile;
+    std::unique_ptr<IntervalStats> intervals;
+
+    bool observed() const { return profile || intervals; }
+    bool sideTargets() const { return useRAS || useIndirect; }
+
+    // Returns and indirect branches with their own target predictor bypass the BTB
+    bool bypassesBTB(BranchClass branchClass) const {
+        return (branchClass == BranchClass::RETURN && useRAS) || (branchClass == BranchClass::INDIRECT && useIndirect);
+    }
+
+    // Calls push their return address, taken branches extend the indirect path history
+    void trainTargets(int sourceAddr, int targetAddr, bool taken, BranchClass branchClass) {
+        if (useRAS && branchClass == BranchClass::CALL && taken) {
+            ras.push(sourceAddr + CALL_RETURN_OFFSET);
+        }
+        if (useIndirect && taken) {
+            indirect.recordTaken(targetAddr);
+        }
+    }
+
+    // The warming loop, Direction also predicts and trains the direction predictor
+    template <bool Direction>
+    void warm(const InstructionBatch& instructions, size_t begin, size_t count) {
+        for (size_t i = begin; i < begin + count; i++) {
+            int sourceAddr = instructions.sourceAddr(i);
+            int targetAddr = instructions.targetAddr(i);
+            bool taken = instructions.taken(i);
+            BranchClass branchClass = instructions.branchClass(i);
+            if (bypassesBTB(branchClass)) {
+                if (Direction) {
+                    predictor.predict(sourceAddr, true);
+                }
+                if (branchClass == BranchClass::RETURN) {
+                    if (taken) {
+                        ras.pop();
+                    }
+                } else if (targetAddr != 0) {
+                    indirect.update(sourceAddr, targetAddr);
+                }
+            } else if (hierarchy) {
+                BTBProbe probe = hierarchy->lookup(btb, sourceAddr);
+                if (Direction) {
+                    predictor.predict(sourceAddr, probe.level != -1);
+                }
+                if (taken) {
+                    hierarchy->update(btb, probe, sourceAddr, targetAddr);
+                }
+            } else {
+                BTBSlot entry = btb.lookup(sourceAddr);
+                if (Direction) {
+                    predictor.predict(sourceAddr, entry.hit());
+                }
+                if (taken) {
+                    btb.update(entry, sourceAddr, targetAddr);
+                }
+            }
+            trainTargets(sourceAddr, targetAddr, taken, branchClass);
+            if (Direction) {
+                predictor.update(sourceAddr, taken);
+            }
+        }
+    }
+
+    void prefetch(int sourceAddr) const {
+        btb.prefetch(sourceAddr);
+        predictor.prefetch(sourceAddr);
+    }
+
+    // One instruction: look it up, predict, record its outcome bits and update. The observed
+    // variant feeds the profile and the time series, the SideTargets one drives the return address
+    // stack and indirect target cache and the Levels one goes through the BTB hierarchy; each is a
+    // separate instantiation, so that work costs nothing when it is not enabled.
+    template <bool Observed, bool SideTargets, bool Levels>
+    void step(const InstructionBlock& block, size_t i, BlockOutcomes& outcomes) {
+        int sourceAddr = block.sourceAddrs[i];
+        int targetAddr = block.targetAddrs[i];
+        bool taken = block.isTaken(i);
+        BranchClass branchClass = block.branchClass(i);
+        bool bypass = SideTargets && bypassesBTB(branchClass);
+        int predictedTarget;
+        bool inBTB;
+        int level = 0; // Where the target came from
+        BTBSlot entry = {-1, -1};
+        BTBProbe probe;
+        if (bypass) {
+            // Predecode recognises the branch, its target comes from the side predictor
+            predictedTarget = branchClass == BranchClass::RETURN ? ras.peek() : indirect.predict(sourceAddr);
+            inBTB = true;
+            level = SIDE_LEVEL;
+        } else if (Levels) {
+            probe = hierarchy->lookup(btb, sourceAddr);
+            predictedTarget = probe.target;
+            inBTB = probe.level != -1;
+            level = inBTB ? probe.level : 0;
+        } else {
+            entry = btb.lookup(sourceAddr);
+            predictedTarget = btb.getTarget(entry);
+            inBTB = entry.hit();
+        }
+
+        bool correct = predictor.predict(sourceAddr, inBTB) == taken;
+        bool targetHit = taken && predictedTarget != -1 && (targetAddr == 0 || predictedTarget == targetAddr);
+        outcomes.inBTB |= static_cast<uint64_t>(inBTB) << i;
+        outcomes.correct |= static_cast<uint64_t>(correct) << i;
+        outcomes.targetHit |= static_cast<uint64_t>(targetHit) << i;
+        outcomes.noTarget |= static_cast<uint64_t>(predictedTarget == -1) << i;
+        if (Levels) {
+            // The supplying level is the one thing the bits of a block do not say
+            suppliedTargets[level] += correct & targetHit;
+        }
+
+        // Only taken branches are allocated in the BTB, through the lookup's probe
+        int evicted = -1;
+        if (bypass) {
+            if (branchClass == BranchClass::RETURN && taken) {
+                ras.pop();
+            } else if (branchClass == BranchClass::INDIRECT && targetAddr != 0) {
+                indirect.update(sourceAddr, targetAddr);
+            }
+        } else if (taken) {
+            evicted = Levels ? hierarchy->update(btb, probe, sourceAddr, targetAddr)
+                             : btb.update(entry, sourceAddr, targetAddr);
+        }
+        if (SideTargets) {
+            trainTargets(sourceAddr, targetAddr, taken, branchClass);
+        }
+        predictor.update(sourceAddr, taken);
+
+        if (Observed) {
+            // A bypassing branch counts as in the BTB for the predictions, but it was not looked up
+            if (profile) {
+                profile->record(sourceAddr, taken, inBTB, !bypass, correct);
+                if (evicted != -1) {
+                    profile->recordEviction(evicted);
+                }
+            }
+            if (intervals) {
+                intervals->record(sourceAddr, taken, inBTB, !bypass, correct, evicted != -1);
+            }
+        }
+    }
+
+    // Add one block's outcomes to the statistics, a few popcounts over its masks
+    template <bool SideTargets, bool Levels>
+    void countBlock(const InstructionBlock& block, const BlockOutcomes& outcomes) {
+        uint64_t valid = block.valid();
+        uint64_t bypass = 0;
+        if (SideTargets) {
+            bypass = (useRAS ? block.classMask(BranchClass::RETURN) : 0) |
+                     (useIndirect ? block.classMask(BranchClass::INDIRECT) : 0);
+        }
+        uint64_t lookedUp = valid & ~bypass;
+        btbHits += countBits(outcomes.inBTB & lookedUp);
+        btbMisses += countBits(~outcomes.inBTB & lookedUp);
+        staticPredictionHits += countBits(~(outcomes.inBTB ^ block.taken) & valid);
+        int correct = countBits(outcomes.correct);
+        predictionHits += correct;
+        predictionMisses += static_cast<long long>(block.count) - correct;
+        btbHitButMispredicted += countBits(outcomes.inBTB & ~outcomes.correct & lookedUp); // Fetched from the BTB and then flushed
+
+        for (int branchClass = 0; branchClass < BRANCH_CLASS_COUNT; branchClass++) {
+            uint64_t members = block.classMask(static_cast<BranchClass>(branchClass));
+            TargetCounters& target = targetCounters[branchClass];
+            target.executions += countBits(members);
+            target.taken += countBits(members & block.taken);
+            target.hits += countBits(members & outcomes.targetHit);
+        }
+
+        // A correctly predicted taken branch costs its level's latency if the target was right,
+        // a decode redirect if there was none and a flush if it was wrong
+        uint64_t correctTaken = outcomes.correct & block.taken;
+        uint64_t supplied = correctTaken & outcomes.targetHit;
+        if (!Levels) {
+            suppliedTargets[0] += countBits(supplied & ~bypass);
+            suppliedTargets[SIDE_LEVEL] += countBits(supplied & bypass);
+        }
+        redirects += countBits(correctTaken & outcomes.noTarget);
+        wrongTargets += countBits(correctTaken & ~outcomes.targetHit & ~outcomes.noTarget);
+    }
+
+    template <bool Observed, bool SideTargets, bool Levels>
+    void run(const InstructionBatch& instructions, size_t begin, size_t count) {
+        for (size_t done = 0; done < count; done += INSTRUCTION_BLOCK_SIZE) {
+            InstructionBlock block = instructions.block(begin + done, std::min(INSTRUCTION_BLOCK_SIZE, count - done));
+            size_t prefetchable = prefetching ? block.count + block.lookahead : 0;
+            BlockOutcomes outcomes;
+            for (size_t i = 0; i < block.count; i++) {
+                if (i + PREFETCH_DISTANCE < prefetchable) {
+                    prefetch(block.sourceAddrs[i + PREFETCH_DISTANCE]);
+                }
+                step<Observed, SideTargets, Levels>(block, i, outcomes);
+            }
+            countBlock<SideTargets, Levels>(block, outcomes);
+        }
+    }
+
+    template <bool Observed, bool SideTargets>
+    void runLevels(const InstructionBatch& instructions, size_t begin, size_t count) {
+        hierarchy ? run<Observed, SideTargets, true>(instructions, begin, count)
+                  : run<Observed, SideTargets, false>(instructions, begin, count);
+    }
+
+    // Fetch bubbles: each correctly supplied target costs the latency of where it came from
+    long long bubbleCycles() const {
+        long long cycles = suppliedTargets[SIDE_LEVEL] * sideLatency;
+        if (!hierarchy) {
+            return cycles + suppliedTargets[0] * btbLatency;
+        }
+        for (int level = 0; level < hierarchy->getLevels(); level++) {
+            cycles += suppliedTargets[level] * hierarchy->getLatency(level);
+        }
+        return cycles;
+    }
+
+    Arena& tableArena(Arena* arena) { return arena != nullptr ? *arena : ownArena; }
+
+public:
+    // Tables come from arena, which must outlive the driver, or the driver's own arena if null
+    explicit SimulationDriver(const BTBConfig& btbConfig, const PredictorConfig& predictorConfig = PredictorConfig(),
+                              Arena* arena = nullptr)
+        : btb(btbConfig, tableArena(arena)), predictor(btbConfig, predictorConfig, tableArena(arena)),
+          ras(btbConfig.rasDepth, tableArena(arena)), indirect(btbConfig.indirectEntries, tableArena(arena)), useRAS(btbConfig.rasDepth > 0), useIndirect(btbConfig.indirectEntries > 0),
+          timing(btbConfig.timing), btbLatency(btbConfig.latency),
+          sideLatency(btbConfig.fasterLevels.empty() ? btbConfig.latency : btbConfig.fasterLevels[0].latency),
+          btbHits(0), btbMisses(0), predictionHits(0), predictionMisses(0), staticPredictionHits(0),
+          btbHitButMispredicted(0), suppliedTargets(), redirects(0), wrongTargets(0),
+          prefetching(btbConfig.entries >= PREFETCH_MIN_ENTRIES) {
+        if (!btbConfig.fasterLevels.empty()) {
+            hierarchy.reset(new BTBHierarchy(btbConfig, tableArena(arena)));
+        }
+    }
+
+    // A copy would share the tables
+    SimulationDriver(const SimulationDriver&) = delete;
+    SimulationDriver& operator=(const SimulationDriver&) = delete;
+
+    explicit SimulationDriver(int btbSize) : SimulationDriver(makeBTBConfig(btbSize, 0, ReplacementPolicy::LRU)) {}
+
+    // Simulate one instruction: look it up, predict, record statistics and update
+    void simulateInstruction(const Instruction& instr) {
+        simulateBatch(&instr, 1);
+    }
+
+    // The count instructions of the batch from begin on. The profiling and side predictor
+    // checks are made once per call, not once per instruction.
+    void simulateBatch(const InstructionBatch& instructions, size_t begin, size_t count) {
+        if (observed()) {
+            sideTargets() ? runLevels<true, true>(instructions, begin, count) : runLevels<true, false>(instructions, begin, count);
+        } else {
+            sideTargets() ? runLevels<false, true>(instructions, begin, count) : runLevels<false, false>(instructions, begin, count);
+        }
+    }
+
+    void simulateBatch(const InstructionBatch& instructions) {
+        simulateBatch(instructions, 0, instructions.size());
+    }
+
+    // Whole records go through the same loop, transposed into columns a slice at a time
+    void simulateBatch(const Instruction* instructions, size_t count) {
+        for (size_t done = 0; done < count; done += TRANSPOSE_SLICE) {
+            size_t slice = std::min(TRANSPOSE_SLICE, count - done);
+            transposed.clear();
+            transposed.append(instructions + done, slice);
+            simulateBatch(transposed, 0, slice);
+        }
+    }
+
+    void simulateBatch(const std::vector<Instruction>& instructions) {
+        simulateBatch(instructions.data(), instructions.size());
+    }
+
+    // Functional warming: leave the BTB contents and recency exactly as simulateBatch would, but
+    // skip the direction predictor and the statistics. The side target predictors are warmed too.
+    void warmBTB(const InstructionBatch& instructions, size_t begin, size_t count) {
+        warm<false>(instructions, begin, count);
+    }
+
+    // Functional warming of the direction predictor as well: every branch is predicted and the
+    // predictor updated as in simulateBatch, only the statistics are left untouched
+    void warmAll(const InstructionBatch& instructions, size_t begin, size_t count) {
+        warm<true>(instructions, begin, count);
+    }
+
+    // Run simulation on a trace file. The first skip instructions are read but not simulated,
+    // as when resuming from a checkpoint taken there, and simulation stops after limit
+    // instructions. Returns the number of instructions simulated.
+    uint64_t simulateTrace(const std::string& traceFilename, uint64_t skip = 0, uint64_t limit = UINT64_MAX) {
+        // Stream the trace in batches, parsing overlaps simulation and memory use stays constant
+        TraceStream stream(traceFilename);
+        if (!stream.isOpen()) {
+            return 0;
+        }
+
+        std::cout << "Simulating trace in batches of " << TRACE_STREAM_DEFAULT_BATCH << " instructions..." << std::endl;
+
+        uint64_t position = 0;
+        uint64_t simulated = 0;
+        while (simulated < limit) {
+            const InstructionBatch* batch = stream.next();
+            if (batch == nullptr) {
+                break;
+            }
+            size_t begin = position < skip ? static_cast<size_t>(std::min<uint64_t>(batch->size(), skip - position)) : 0;
+            size_t count = static_cast<size_t>(std::min<uint64_t>(batch->size() - begin, limit - simulated));
+            simulateBatch(*batch, begin, count);
+            position += batch->size();
+            simulated += count;
+        }
+
+        stream.printParseStats();
+        if (skip > 0) {
+            std::cout << "Skipped: " << std::min(skip, position) << " instructions before the checkpoint" << std::endl;
+            if (position < skip) {
+                std::cerr << "Warning: The trace ends before the checkpoint offset " << skip << std::endl;
+            }
+        }
+        std::cout << "Simulated: " << simulated << " instructions" << std::endl;
+        finishIntervals();
+        return simulated;
+    }
+
+    // Run simulation on a trace file, resuming from checkpoint.restoreFile if given, and stopping
+    // after instruction checkpoint.saveAt to write checkpoint.saveFile if given. Returns false if
+    // a checkpoint cannot be read, does not fit this configuration or cannot be written.
+    bool simulateTrace(const std::string& traceFilename, const CheckpointOptions& checkpoint) {
+        uint64_t offset = 0;
+        if (!checkpoint.restoreFile.empty()) {
+            if (!restoreCheckpoint(checkpoint.restoreFile, offset)) {
+                return false;
+            }
+            std::cout << "Restored " << checkpoint.restoreFile << ", taken after " << offset << " instructions" << std::endl;
+        }
+        if (checkpoint.saveAt == 0) {
+            simulateTrace(traceFilename, offset);
+            return true;
+        }
+        if (checkpoint.saveAt <= offset) {
+            std::cerr << "Error: --checkpoint " << checkpoint.saveAt << " is not after the restored checkpoint" << std::endl;
+            return false;
+        }
+        offset += simulateTrace(traceFilename, offset, checkpoint.saveAt - offset);
+        if (!saveCheckpoint(checkpoint.saveFile, offset)) {
+            return false;
+        }
+        std::cout << "Checkpoint after " << offset << " instructions written to " << checkpoint.saveFile << std::endl;
+        return true;
+    }
+
+    // Write the BTB, side target predictor and direction predictor state to filename, tagged
+    // with the number of trace instructions it has seen. Returns false on I/O error.
+    bool saveCheckpoint(const std::string& filename, uint64_t traceOffset) const {
+        CheckpointWriter out(Predictor::name(), traceOffset);
+        out.put(useRAS);
+        out.put(useIndirect);
+        out.put<int32_t>(hierarchy ? hierarchy->getLevels() : 1);
+        btb.saveState(out);
+        if (hierarchy) {
+            hierarchy->saveState(out);
+        }
+        ras.saveState(out);
+        indirect.saveState(out);
+        predictor.saveState(out);
+        return out.writeFile(filename);
+    }
+
+    // Load a checkpoint taken with the same predictor and geometry and set traceOffset to the
+    // instructions it had seen. Returns false, with the reason printed, if it does not fit.
+    bool restoreCheckpoint(const std::string& filename, uint64_t& traceOffset) {
+        CheckpointReader in(filename);
+        if (!in.ok()) {
+            return false;
+        }
+        if (in.getPredictorName() != Predictor::name()) {
+            std::cerr << "Error: Checkpoint is of a " << in.getPredictorName() << " predictor, this run uses "
+                      << Predictor::name() << std::endl;
+            return false;
+        }
+        bool storedRAS = false;
+        bool storedIndirect = false;
+        if (in.get(storedRAS) && storedRAS != useRAS) {
+            in.fail(std::string("Checkpoint was taken ") + (storedRAS ? "with" : "without") + " a return address stack");
+        }
+        if (in.get(storedIndirect) && storedIndirect != useIndirect) {
+            in.fail(std::string("Checkpoint was taken ") + (storedIndirect ? "with" : "without") + " an indirect target cache");
+        }
+        in.expect<int32_t>(hierarchy ? hierarchy->getLevels() : 1, "BTB level count");
+        if (!in.ok() || !btb.loadState(in) || (hierarchy && !hierarchy->loadState(in)) || !ras.loadState(in) ||
+            !indirect.loadState(in) || !predictor.loadState(in) || !in.finish()) {
+            return false;
+        }
+        traceOffset = in.getTraceOffset();
+        return true;
+    }
+
+    // Zero the statistics but keep the BTB and predictor state, e.g. after a warm-up
+    void resetStatistics() {
+        btb.resetStatistics();
+        if (hierarchy) {
+            hierarchy->resetStatistics();
+        }
+        btbHits = 0;
+        btbMisses = 0;
+        predictionHits = 0;
+        predictionMisses = 0;
+        staticPredictionHits = 0;
+        btbHitButMispredicted = 0;
+        std::fill(suppliedTargets, suppliedTargets + SIDE_LEVEL + 1, 0);
+        redirects = 0;
+        wrongTargets = 0;
+        for (TargetCounters& target : targetCounters) {
+            target = TargetCounters();
+        }
+        ras.resetStatistics();
+        if (profile) {
+            profile.reset(new BranchProfile());
+        }
+    }
+
+    // Statistics accessors
+    long long getInstructions() const { return predictionHits + predictionMisses; }
+    long long getBtbHits() const { return btbHits; }
+    long long getBtbMisses() const { return btbMisses; }
+    long long getPredictionHits() const { return predictionHits; }
+    long long getPredictionMisses() const { return predictionMisses; }
+    long long getStaticPredictionHits() const { return staticPredictionHits; }
+    long long getBtbHitButMispredicted() const { return btbHitButMispredicted; }
+
+    // Cycles the frontend lost to bubbles, redirects and flushes under the timing model
+    long long getLostCycles() const {
+        return bubbleCycles() + redirects * timing.redirectPenalty + getFlushes() * timing.flushPenalty;
+    }
+    long long getFlushes() const { return predictionMisses + wrongTargets; }
+
+    // The driver's counters, then the BTB's and the predictor's
+    void registerStats(StatsRegistry& stats) const {
+        stats.counter("instructions", static_cast<uint64_t>(getInstructions()));
+        stats.counter("btb.hits", static_cast<uint64_t>(btbHits));
+        stats.counter("btb.misses", static_cast<uint64_t>(btbMisses));
+        stats.counter("prediction.hits", static_cast<uint64_t>(predictionHits));
+        stats.counter("prediction.misses", static_cast<uint64_t>(predictionMisses));
+        stats.counter("static.hits", static_cast<uint64_t>(staticPredictionHits));
+        stats.counter("btb.hit_but_mispredicted", static_cast<uint64_t>(btbHitButMispredicted));
+        registerTargetStats(targetCounters, stats);
+        stats.counter("frontend.bubble_cycles", static_cast<uint64_t>(bubbleCycles()));
+        stats.counter("frontend.redirects", static_cast<uint64_t>(redirects));
+        stats.counter("frontend.flushes", static_cast<uint64_t>(getFlushes()));
+        stats.counter("frontend.lost_cycles", static_cast<uint64_t>(getLostCycles()));
+        if (useRAS) {
+            ras.registerStats(stats);
+        }
+        btb.registerStats(stats);
+        if (hierarchy) {
+            hierarchy->registerStats(stats);
+        }
+        predictor.registerStats(stats);
+    }
+
+    // Start counting per branch from the next instruction on
+    void enableProfile() {
+        if (!profile) {
+            profile.reset(new BranchProfile());
+        }
+    }
+
+    // Stream the statistics of every window of length instructions to filename (CSV if it ends
+    // in ".csv", binary otherwise), returns false if the file cannot be written
+    bool enableIntervals(size_t length, const std::string& filename) {
+        intervals.reset(new IntervalStats(length, filename));
+        return intervals->isOpen();
+    }
+
+    // Write the last, partial window and close the time series; simulateTrace does this itself
+    bool finishIntervals() {
+        return !intervals || intervals->finish();
+    }
+
+    // Null unless enableProfile was called
+    const BranchProfile* getProfile() const { return profile.get(); }
+
+    const Predictor& getPredictor() const { return predictor; }
+    const BranchTargetBuffer& getBTB() const { return btb; }
+
+    void printStats() const {
+        long long totalInstructions = getInstructions();
+        double accuracy = totalInstructions > 0 ? (double)predictionHits / totalInstructions * 100.0 : 0.0;
+        double staticAccuracy = totalInstructions > 0 ? (double)staticPredictionHits / totalInstructions * 100.0 : 0.0;
+        double btbAccuracy = (btbHits + btbMisses) > 0 ? (double)btbHits / (btbHits + btbMisses) * 100.0 : 0.0;
+
+        std::ios_base::fmtflags flags = std::cout.flags();
+        std::streamsize precision = std::cout.precision();
+
+        std::cout << Predictor::displayName() << " Branch Predictor Statistics:" << std::endl;
+        std::cout << "===================================" << std::endl;
+        std::cout << "Total instructions processed: " << totalInstructions << std::endl;
+        std::cout << "Direction prediction hits: " << predictionHits << std::endl;
+        std::cout << "Direction prediction misses: " << predictionMisses << std::endl;
+        std::cout << "BTB hits but direction mispredicted: " << btbHitButMispredicted << std::endl;
+        std::cout << std::endl;
+
+        // Fixed two-decimal lines, the format the analysis scripts parse
+        std::cout << std::fixed << std::setprecision(2);
+        std::cout << "Direction prediction accuracy: " << accuracy << "%" << std::endl;
+        std::cout << "Static Accuracy: " << staticAccuracy << "%" << std::endl;
+        std::cout << "Dynamic Accuracy: " << accuracy << "%" << std::endl;
+        std::cout << "Improvement: " << accuracy - staticAccuracy << "%" << std::endl;
+        std::cout << "BTB Hit Rate: " << btbAccuracy << "%" << std::endl;
+        std::cout << std::endl;
+        std::cout << "BTB hits: " << btbHits << std::endl;
+        std::cout << "BTB misses: " << btbMisses << std::endl;
+        if (hierarchy) {
+            std::cout << "BTB hits per level:";
+            for (int level = 0; level < hierarchy->getLevels(); level++) {
+                std::cout << (level > 0 ? ", L" : " L") << level << " " << hierarchy->getLevelHits(level);
+            }
+            std::cout << " (" << hierarchy->getPromotions() << " promotions)" << std::endl;
+        }
+        std::cout << std::endl;
+        printTargetStats(std::cout, targetCounters);
+        if (useRAS) {
+            std::cout << "Return address stack: " << ras.getDepth() << " entries, " << ras.getOverflows()
+                      << " overflows, " << ras.getUnderflows() << " underflows" << std::endl;
+        }
+        std::cout << std::endl;
+        std::cout << "Frontend cycles lost: " << getLostCycles() << " (" << bubbleCycles() << " in fetch bubbles, "
+                  << redirects << " decode redirects, " << getFlushes() << " flushes)" << std::endl;
+        std::cout << "Estimated IPC: " << estimatedIPC(timing, totalInstructions, getLostCycles()) << " of "
+                  << timing.fetchWidth << ", " << ipcLossPercent(timing, totalInstructions, getLostCycles())
+                  << "% lost at " << timing.instructionsPerBranch << " instructions per branch" << std::endl;
+
+        std::cout.flags(flags);
+        std::cout.precision(precision);
+    }
+};
+
+#endif //SIMULATIONDRIVER_H
@@ -0,0 +1,66 @@
+#ifndef STACKDISTANCEPROFILER_H
+#define STACKDISTANCEPROFILER_H
+
+#include "AddressIndex.h"
+#include <cstdint>
+#include <vector>
+
+// One-pass BTB hit statistics for a set of fully associative LRU capacities.
+// The simulators only allocate taken branches, so this is Mattson's stack algorithm with
+// a recency priority: a not-taken hit refreshes the entry's timestamp without moving it,
+// and an allocation pushes the least recently used entry of each level down.
+// Only the requested capacities matter, so the stack is kept as bands between consecutive
+// capacities, each a min-heap on last use; an access costs O(bands * log(band size)).
+// BTB contents do not depend on the direction predictor, so the per-band counts give the
+// BTB hits, misses and static prediction results of every capacity at once. Every BTB holding a
+// branch has the target of its last taken execution, so stale targets are counted per band too.
+class StackDistanceProfiler {
+private:
+    std::vector<int> capacities; // Sorted, band i holds levels [capacities[i-1], capacities[i])
+    std::vector<std::vector<int>> bands; // Heap of entry ids, oldest first
+
+    // Per entry: address, last use, band and position in the band's heap
+    std::vector<int> entryAddr;
+    std::vector<int> entryTarget;
+    std::vector<uint64_t> entryTime;
+    std::vector<int> entryBand;
+    std::vector<int> entryHeapPos;
+    std::vector<int> freeEntries;
+    Arena arena; // The index's buckets
+    AddressIndex entries; // Address -> entry id
+    uint64_t clock;
+
+    // Accesses that hit in each band, split by branch outcome (last index = miss)
+    std::vector<long long> takenInBand;
+    std::vector<long long> notTakenInBand;
+    std::vector<long long> wrongTargetInBand; // Taken hits whose stored target was not the new one
+
+    long long totalAccesses;
+    long long notTakenTotal;
+
+    int bandCapacity(int band) const;
+    int bandOf(int capacity) const;
+    long long countUpTo(const std::vector<long long>& perBand, int capacity) const;
+    void heapPush(int band, int id);
+    void heapRemove(int band, int id);
+    void siftUp(int band, int pos);
+    void siftDown(int band, int pos);
+
+public:
+    StackDistanceProfiler(const std::vector<int>& capacities);
+
+    // Record one branch: a BTB lookup followed by an insert if it was taken. A targetAddr of 0
+    // (not recorded) matches any stored target.
+    void access(int sourceAddr, bool taken, int targetAddr);
+
+    long long getAccesses() const { return totalAccesses; }
+
+    // Results for one of the capacities given to the constructor
+    long long btbHits(int capacity) const;
+    long long btbMisses(int capacity) const;
+    long long staticPredictionHits(int capacity) const; // Predict taken iff in BTB
+    long long btbHitButMispredicted(int capacity) const;
+    long long takenWrongTarget(int capacity) const; // Taken hits that supplied a stale target
+};
+
+#endif //STACKDISTANCEPROFILER_H
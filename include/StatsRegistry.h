@@ -0,0 +1,69 @@
+#ifndef STATSREGISTRY_H
+#define STATSREGISTRY_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Named statistics of one run, in registration order. Components register what they count
+// under dotted names ("btb.hits", "tage.allocations"); counters are unsigned 64-bit so they
+// cannot wrap on long traces. Labels describe the configuration (predictor spec, BTB geometry)
+// and are kept apart from counters, so merging the registries of partial runs sums only counters.
+class StatsRegistry {
+public:
+    enum class Kind {
+        COUNTER,
+        NUMBER, // Numeric label, e.g. a table size
+        TEXT    // Text label, e.g. a predictor spec
+    };
+
+    struct Entry {
+        std::string name;
+        Kind kind;
+        uint64_t value;
+        std::string text;
+    };
+
+private:
+    std::vector<Entry> entries;
+
+    Entry* find(const std::string& name);
+    void set(const std::string& name, Kind kind, uint64_t value, const std::string& text);
+
+public:
+    // Registering a name again replaces its value
+    void counter(const std::string& name, uint64_t value) { set(name, Kind::COUNTER, value, ""); }
+    void label(const std::string& name, uint64_t value) { set(name, Kind::NUMBER, value, ""); }
+    void label(const std::string& name, const std::string& text) { set(name, Kind::TEXT, 0, text); }
+
+    // Add the other registry's counters to ours, adopting anything we do not have yet
+    void merge(const StatsRegistry& other);
+
+    const std::vector<Entry>& getEntries() const { return entries; }
+    bool empty() const { return entries.empty(); }
+};
+
+// {"runs": [{name: value, ...}, ...]}, one flat object per registry
+void writeStatsJson(std::ostream& out, const std::vector<StatsRegistry>& runs);
+
+// A header row with every name seen (first-seen order), then one row per registry;
+// names a run does not have are left empty
+void writeStatsCsv(std::ostream& out, const std::vector<StatsRegistry>& runs);
+
+// Where the machine-readable copies of a report go, empty for none
+struct StatsOutput {
+    std::string jsonFile;
+    std::string csvFile;
+
+    bool requested() const { return !jsonFile.empty() || !csvFile.empty(); }
+};
+
+// Remove "--stats-json <file>" and "--stats-csv <file>" from the arguments, wherever they are.
+// Returns false if one is missing its file name.
+bool extractStatsOutput(int& argc, char* argv[], StatsOutput& output);
+
+// Write the requested files, returns false (with a message) on I/O error
+bool writeStatsOutput(const StatsOutput& output, const std::vector<StatsRegistry>& runs);
+
+#endif //STATSREGISTRY_H
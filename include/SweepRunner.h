@@ -0,0 +1,134 @@
+#ifndef SWEEPRUNNER_H
+#define SWEEPRUNNER_H
+
+#include "Arena.h"
+#include "BranchTargetBuffer.h"
+#include "InstructionBatch.h"
+#include "PredictorConfig.h"
+#include "SimulationDriver.h"
+#include "StackDistanceProfiler.h"
+#include "StatsRegistry.h"
+#include "TraceReader.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+// One predictor/BTB combination in a sweep
+struct SweepConfig {
+    PredictorConfig predictor;
+    BTBConfig btb;
+};
+
+// One row of the combined result table
+struct SweepResult {
+    SweepConfig config;
+    long long instructions;
+    long long btbHits;
+    long long btbMisses;
+    long long predictionHits;
+    long long staticPredictionHits;
+    long long btbHitButMispredicted;
+    long long lostCycles; // Frontend cycles lost under the config's timing model
+    bool fromStackDistance; // Taken from the stack-distance pass rather than a full simulation
+    StatsRegistry stats; // Every counter of the run, including the BTB's and the predictor's
+};
+
+// One simulated configuration. The virtual call is made once per block, the count instructions
+// of the batch from begin; the loop inside is SimulationDriver<Predictor>::simulateBatch with
+// predict/update inlined.
+class SweepTarget {
+public:
+    virtual ~SweepTarget() {}
+    virtual void simulateBlock(const InstructionBatch& instructions, size_t begin, size_t count) = 0;
+    // Functional warming, no statistics: the BTB and side predictors, and with direction the predictor too
+    virtual void warmBlock(const InstructionBatch& instructions, size_t begin, size_t count, bool direction) = 0;
+    virtual void resetStatistics() = 0;
+    virtual void collect(SweepResult& result) const = 0;
+};
+
+template <typename Predictor>
+class DriverSweepTarget : public SweepTarget {
+private:
+    SimulationDriver<Predictor> driver;
+
+public:
+    DriverSweepTarget(const BTBConfig& btb, const PredictorConfig& predictor, Arena& arena)
+        : driver(btb, predictor, &arena) {}
+
+    void simulateBlock(const InstructionBatch& instructions, size_t begin, size_t count) override {
+        driver.simulateBatch(instructions, begin, count);
+    }
+
+    void warmBlock(const InstructionBatch& instructions, size_t begin, size_t count, bool direction) override {
+        if (direction) {
+            driver.warmAll(instructions, begin, count);
+        } else {
+            driver.warmBTB(instructions, begin, count);
+        }
+    }
+
+    void resetStatistics() override {
+        driver.resetStatistics();
+    }
+
+    void collect(SweepResult& result) const override {
+        result.instructions = driver.getInstructions();
+        result.btbHits = driver.getBtbHits();
+        result.btbMisses = driver.getBtbMisses();
+        result.predictionHits = driver.getPredictionHits();
+        result.staticPredictionHits = driver.getStaticPredictionHits();
+        result.btbHitButMispredicted = driver.getBtbHitButMispredicted();
+        result.lostCycles = driver.getLostCycles();
+        result.fromStackDistance = false;
+        result.stats = StatsRegistry();
+        driver.registerStats(result.stats);
+    }
+};
+
+// Drives every configuration over one shared instruction stream in a single pass.
+// Static predictors with a fully associative LRU BTB need nothing but BTB presence, so they are
+// all answered by one stack-distance pass; every other configuration gets its own predictor.
+// The simulated configurations share one arena for their tables.
+class SweepRunner {
+private:
+    std::vector<SweepConfig> configs;
+    Arena arena; // Before targets, so it outlives them
+    std::vector<std::unique_ptr<SweepTarget>> targets;
+    std::unique_ptr<StackDistanceProfiler> profiler;
+
+    // Which config each simulated target / profiled result belongs to
+    std::vector<int> targetConfigs;
+    std::vector<int> profiledConfigs;
+
+    std::vector<SweepResult> results;
+
+public:
+    SweepRunner(const std::vector<SweepConfig>& configs);
+
+    // Simulate all configurations over the next part of the trace, in blocks so each
+    // predictor stays cache-resident while it works through a block
+    void simulateBatch(const InstructionBatch& batch);
+
+    // Collect the results once the whole trace has been simulated
+    void finish();
+
+    const std::vector<SweepResult>& getResults() const { return results; }
+
+    // Print one combined table, one row per configuration in the order given
+    void printTable() const;
+};
+
+// The result table shared by sweep and batch mode
+void printResultHeader();
+void printResultRow(const SweepResult& result);
+
+// Label the predictor spec and BTB geometry
+void registerConfigStats(const SweepConfig& config, StatsRegistry& stats);
+
+// The configuration labels followed by the result's counters, one run of the JSON/CSV output
+StatsRegistry resultStats(const SweepResult& result);
+
+// Handle "--sweep <trace_file> <btb_spec>[,<btb_spec>...] [predictor_spec[,predictor_spec...]]"
+int runSweepCommand(int argc, char* argv[], const StatsOutput& statsOutput);
+
+#endif //SWEEPRUNNER_H
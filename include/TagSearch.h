@@ -0,0 +1,20 @@
+#ifndef TAGSEARCH_H
+#define TAGSEARCH_H
+
+// Search of one BTB set's tags, which sit next to each other in the tag array. Returns the
+// index of the way holding tag among the first count ways, or -1.
+using TagSearchFunction = int (*)(const int* tags, int count, int tag);
+
+// Ways compared one at a time, used on any CPU
+int findTagScalar(const int* tags, int count, int tag);
+
+// Four or eight ways per compare, folded into a bitmask with a movemask. nullptr when the
+// build or the CPU running it lacks the instructions.
+TagSearchFunction sse2TagSearch();
+TagSearchFunction avx2TagSearch();
+
+// The widest search this CPU supports, chosen once at startup. "avx2", "sse2" or "scalar".
+TagSearchFunction bestTagSearch();
+const char* bestTagSearchName();
+
+#endif //TAGSEARCH_H
@@ -0,0 +1,103 @@
+#ifndef TAGEPREDICTOR_H
+#define TAGEPREDICTOR_H
+
+#include "BranchTargetBuffer.h"
+#include "PackedCounterTable.h"
+#include "PredictorConfig.h"
+#include "StatsRegistry.h"
+#include <cstdint>
+
+const int TAGE_MAX_TABLES = 16;
+const int TAGE_MAX_HISTORY = 1024;
+
+// A global history of originalLength bits XOR-folded down to compressedLength bits, kept up to
+// date with one shift and two XORs per branch instead of refolding the whole history
+struct FoldedHistory {
+    uint32_t value = 0;
+    int compressedLength = 1;
+    int outPoint = 0; // Where the bit leaving the history lands in the folded value
+
+    void init(int originalLength, int compressed) {
+        value = 0;
+        compressedLength = compressed;
+        outPoint = originalLength % compressed;
+    }
+
+    void update(uint32_t newBit, uint32_t oldBit) {
+        value = (value << 1) | newBit;
+        value ^= oldBit << outPoint;
+        value ^= value >> compressedLength;
+        value &= (1u << compressedLength) - 1;
+    }
+};
+
+// Seznec's TAGE: a bimodal base predictor plus tagged tables indexed by hashes of the branch
+// address with geometrically increasing global history lengths. The longest matching table
+// provides the prediction; mispredictions allocate an entry in a longer table, and 2-bit
+// usefulness counters protect entries that beat the alternate prediction.
+// Spec "tage[:tables[:tableBits[:minHistory[:maxHistory]]]]", default 7 tables of 2^10 entries
+// over histories of 5 to 200 branches, about 30KB in all.
+class TagePredictor {
+private:
+    struct Entry {
+        uint16_t tag;
+        int8_t counter; // 3-bit signed, taken if >= 0
+        uint8_t useful; // 2 bits
+    };
+
+    int numTables;
+    int tableBits;
+    uint32_t tableMask;
+    PackedCounterTable base;
+    ArenaArray<Entry> entries; // Table i at i << tableBits
+    int historyLength[TAGE_MAX_TABLES];
+    int tagBits[TAGE_MAX_TABLES];
+
+    // Global history as a ring of bits, newest at historyHead
+    ArenaArray<uint8_t> history;
+    uint32_t historyHead;
+    uint32_t pathHistory; // Low address bit of recent branches
+    FoldedHistory indexFold[TAGE_MAX_TABLES];
+    FoldedHistory tagFold[TAGE_MAX_TABLES];
+    FoldedHistory tagFoldShort[TAGE_MAX_TABLES]; // Folded one bit shorter, decorrelates the tag from the index
+
+    int useAltOnNew; // Whether a newly allocated (weak) provider should defer to the alternate
+    uint32_t randomState;
+    uint64_t updates;
+
+    // Lookup state from predict, reused by update for the same branch
+    uint32_t indices[TAGE_MAX_TABLES];
+    uint16_t tags[TAGE_MAX_TABLES];
+    int provider; // Longest matching table, -1 for the base predictor
+    int alternate; // Next longest matching table, -1 for the base predictor
+    bool providerPrediction;
+    bool alternatePrediction;
+    bool prediction;
+
+    void computeIndices(uint32_t pc);
+    void allocate(bool taken);
+    void updateHistories(uint32_t pc, bool taken);
+
+    static bool weak(const Entry& entry) { return entry.counter == 0 || entry.counter == -1; }
+
+public:
+    TagePredictor(const BTBConfig& btb, const PredictorConfig& config, Arena& arena);
+
+    bool predict(int sourceAddr, bool);
+
+    // The base counter only, the tagged tables are indexed by histories not known yet
+    void prefetch(int sourceAddr) const { base.prefetch(static_cast<uint32_t>(sourceAddr) >> 2); }
+
+    void update(int sourceAddr, bool taken);
+
+    void registerStats(StatsRegistry& stats) const;
+
+    // Checkpointing of the tables and histories; the lookup state is rebuilt by the next predict
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in);
+
+    static const char* name() { return "tage"; }
+    static const char* displayName() { return "TAGE"; }
+};
+
+#endif //TAGEPREDICTOR_H
@@ -0,0 +1,152 @@
+#ifndef TARGETPREDICTOR_H
+#define TARGETPREDICTOR_H
+
+#include "Arena.h"
+#include "BranchTargetBuffer.h"
+#include "Checkpoint.h"
+#include "StatsRegistry.h"
+#include <cstdint>
+#include <ostream>
+
+// Branch classes by trace record type: 'C' calls, 'R' returns, 'I' indirect jumps and calls,
+// everything else ('B') a direct branch whose target the BTB can hold
+enum class BranchClass {
+    DIRECT,
+    CALL,
+    RETURN,
+    INDIRECT
+};
+
+const int BRANCH_CLASS_COUNT = 4;
+
+// Fixed-width instructions: a call at X returns to X + 4
+const int CALL_RETURN_OFFSET = 4;
+
+// Indirect target cache index: the last 4 taken targets, 4 bits shifted in per target
+const int INDIRECT_PATH_SHIFT = 4;
+const uint32_t INDIRECT_PATH_MASK = 0xFFFF;
+
+inline BranchClass classifyBranch(char type) {
+    switch (type) {
+        case 'C': return BranchClass::CALL;
+        case 'R': return BranchClass::RETURN;
+        case 'I': return BranchClass::INDIRECT;
+        default: return BranchClass::DIRECT;
+    }
+}
+
+// Short name used in reports and statistics ("direct", "call", "return", "indirect")
+const char* branchClassName(BranchClass branchClass);
+
+// Target prediction of one branch class. A taken branch is a hit when the frontend supplied its
+// target; traces that do not record a target (0, as for plain 'R' records) accept any target.
+struct TargetCounters {
+    uint64_t executions = 0;
+    uint64_t taken = 0;
+    uint64_t hits = 0;
+};
+
+// Circular return address stack: calls push their return address, a return predicts the top
+// and pops it if it is taken. A push onto a full stack overwrites the oldest entry, an empty
+// stack predicts nothing.
+class ReturnAddressStack {
+private:
+    ArenaArray<int> entries;
+    int top; // Slot of the newest entry
+    int count; // Valid entries, at most the depth
+    uint64_t overflows;
+    uint64_t underflows;
+
+public:
+    ReturnAddressStack(int depth, Arena& arena);
+
+    int getDepth() const { return static_cast<int>(entries.size()); }
+    uint64_t getOverflows() const { return overflows; }
+    uint64_t getUnderflows() const { return underflows; }
+
+    void push(int returnAddr) {
+        top = top + 1 == getDepth() ? 0 : top + 1;
+        entries[top] = returnAddr;
+        if (count == getDepth()) {
+            overflows++;
+        } else {
+            count++;
+        }
+    }
+
+    // The predicted return address, or -1 if the stack is empty
+    int peek() const { return count > 0 ? entries[top] : -1; }
+
+    void pop() {
+        if (count == 0) {
+            underflows++;
+            return;
+        }
+        top = top == 0 ? getDepth() - 1 : top - 1;
+        count--;
+    }
+
+    // "ras.overflows" and "ras.underflows"; the depth is a configuration label
+    void registerStats(StatsRegistry& stats) const;
+    void resetStatistics();
+
+    // Checkpointing of the entries, loadState fails if the depth differs
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in);
+};
+
+// Path-history indexed indirect target cache: a direct-mapped table of (source, target) pairs
+// indexed by the source address hashed with the targets of the last few taken branches, so one
+// indirect branch gets a separate entry for each path leading to it.
+class IndirectTargetCache {
+private:
+    ArenaArray<int> tags; // Source address, -1 if free
+    ArenaArray<int> targets;
+    uint32_t mask;
+    uint32_t path;
+
+    uint32_t index(int sourceAddr) const {
+        uint32_t h = static_cast<uint32_t>(sourceAddr) * 0x9E3779B1u;
+        return ((h ^ (h >> 16)) ^ path) & mask;
+    }
+
+public:
+    // entries is rounded up to a power of two, the table comes from the arena
+    IndirectTargetCache(int entries, Arena& arena);
+
+    int getEntries() const { return static_cast<int>(tags.size()); }
+
+    // The predicted target, or -1 if this source and path have no entry
+    int predict(int sourceAddr) const {
+        uint32_t i = index(sourceAddr);
+        return tags[i] == sourceAddr ? targets[i] : -1;
+    }
+
+    // Write the actual target, before recordTaken so it lands where predict looked
+    void update(int sourceAddr, int targetAddr) {
+        uint32_t i = index(sourceAddr);
+        tags[i] = sourceAddr;
+        targets[i] = targetAddr;
+    }
+
+    // Shift a taken branch's target into the path history
+    void recordTaken(int targetAddr) {
+        path = ((path << INDIRECT_PATH_SHIFT) ^ (static_cast<uint32_t>(targetAddr) >> 2)) & INDIRECT_PATH_MASK;
+    }
+
+    // Checkpointing of the entries and the path history, loadState fails if the size differs
+    void saveState(CheckpointWriter& out) const;
+    bool loadState(CheckpointReader& in);
+};
+
+// "target.<class>.executions", ".taken" and ".hits" for every class
+void registerTargetStats(const TargetCounters* counters, StatsRegistry& stats);
+
+// One line per class that occurred, with its target accuracy
+void printTargetStats(std::ostream& out, const TargetCounters* counters);
+
+// Remove "--ras <depth>" and "--indirect <entries>" from the arguments, wherever they are, and
+// set the matching BTBConfig fields. Returns false if a value is missing or not a positive number.
+bool extractTargetOptions(int& argc, char* argv[], BTBConfig& config);
+
+#endif //TARGETPREDICTOR_H
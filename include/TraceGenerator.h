@@ -0,0 +1,156 @@
+#ifndef TRACEGENERATOR_H
+#define TRACEGENERATOR_H
+
+#include "TraceReader.h"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// An endless, deterministic stream of branch records, pulled in batches. The same inputs and
+// seed always give the same trace.
+class TraceGenerator {
+public:
+    virtual ~TraceGenerator() = default;
+
+    virtual void generate(Instruction* out, size_t count) = 0;
+};
+
+// Walks the control flow of an ARM (A32) execution profile such as misc/instr_profile: one line
+// per executed instruction, "count address encoding disassembly", in address order. Branches
+// are decoded from their encodings: B/BL are direct branches and calls, MOV PC,LR / BX LR and
+// loads of PC from the stack or through R11 are returns, and any other write to PC is an
+// indirect branch (a call if the previous instruction saved PC into LR). Conditional branches
+// are taken with the probability the counts imply, 1 - count(next) / count(branch); indirect
+// targets are drawn from the profile's blocks, weighted by their counts.
+class ProfileTraceGenerator : public TraceGenerator {
+private:
+    struct Branch {
+        uint32_t address;
+        uint32_t position; // Index in addresses
+        char type; // 'B', 'C', 'R' or 'I'
+        bool links; // Pushes a return address: calls, and indirect calls after MOV LR,PC
+        uint64_t takenThreshold; // Taken if a 32-bit random number is below it, 1 << 32 = always
+        uint32_t target; // Direct branches only
+        uint32_t targetPosition; // First profiled instruction at or after the target
+    };
+
+    std::vector<uint32_t> addresses; // Profiled instructions in address order
+    std::vector<uint32_t> nextBranch; // Per instruction, the first branch at or after it
+    std::vector<Branch> branches;
+    std::vector<uint32_t> blockStarts; // Instructions not preceded by a profiled one
+    std::vector<uint64_t> blockWeights; // Cumulative counts of the block starts
+    std::vector<uint32_t> returnStack;
+    size_t position;
+    uint32_t randomState;
+    bool valid;
+
+    uint32_t nextRandom() {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState;
+    }
+
+    size_t positionOf(uint32_t address) const;
+
+public:
+    ProfileTraceGenerator(const std::string& filename, uint32_t seed = 1);
+
+    bool isValid() const { return valid; }
+    size_t getInstructionCount() const { return addresses.size(); }
+    size_t getBranchCount() const { return branches.size(); }
+
+    void generate(Instruction* out, size_t count) override;
+};
+
+// Synthetic program shape, given as "key=value,..." (any key may be left out):
+//
+//   functions  static functions (default 64)        branches  conditional branches per loop body (8)
+//   loops      loop nest depth per function (2)     trip      iterations of every loop (8)
+//   bias       taken percent of biased branches (90) random   percent of 50/50 branches (10)
+//   calls      percent of functions calling another (50)      depth  maximum call depth (4)
+//   indirect   percent of functions ending in an indirect jump (10)
+//   targets    targets of each indirect jump (4)
+//
+// A function is a direct call (if it has a callee and the depth allows), its loop nest around the
+// body branches, the indirect jump and a return. The remaining non-random branches are biased
+// taken or not taken half each. A driver calls functions over and over, three quarters of the
+// calls going to the hottest eighth of them.
+struct SyntheticSpec {
+    int functions = 64;
+    int branches = 8;
+    int loops = 2;
+    int trip = 8;
+    int bias = 90;
+    int random = 10;
+    int calls = 50;
+    int depth = 4;
+    int indirect = 10;
+    int targets = 4;
+};
+
+// Parse a synthetic spec, an empty spec or "default" gives the defaults.
+// Returns false on an unknown key or a value out of range.
+bool parseSyntheticSpec(const std::string& text, SyntheticSpec& spec);
+
+class SyntheticTraceGenerator : public TraceGenerator {
+private:
+    SyntheticSpec spec;
+    uint32_t randomState;
+    std::vector<int> callees; // Per function, -1 if it calls nothing
+    std::vector<bool> indirectJumps; // Per function
+    std::vector<uint8_t> behaviours; // Per body branch: 0 random, 1 biased taken, 2 biased not taken
+    std::vector<Instruction> pending; // One driver call, not handed out yet
+    size_t pendingOffset;
+    uint64_t invocations;
+
+    uint32_t nextRandom() {
+        randomState ^= randomState << 13;
+        randomState ^= randomState >> 17;
+        randomState ^= randomState << 5;
+        return randomState;
+    }
+
+    void emit(char type, uint32_t sourceAddr, uint32_t targetAddr, bool taken);
+    void emitFunction(int function, int depth, uint32_t returnAddr);
+    void emitLoop(int function, int level);
+    void emitBody(int function);
+
+public:
+    SyntheticTraceGenerator(const SyntheticSpec& spec, uint32_t seed = 1);
+
+    void generate(Instruction* out, size_t count) override;
+};
+
+// Writes the simulator's text trace format through a large buffer with hand-rolled hex
+// formatting, several times faster than fprintf. Mirrors BinaryTraceWriter.
+class TextTraceWriter {
+private:
+    FILE* out;
+    std::vector<char> buffer;
+    size_t used;
+    uint64_t recordCount;
+    bool failed;
+
+    void flush();
+
+public:
+    TextTraceWriter(const std::string& filename);
+    ~TextTraceWriter();
+
+    TextTraceWriter(const TextTraceWriter&) = delete;
+    TextTraceWriter& operator=(const TextTraceWriter&) = delete;
+
+    bool isOpen() const { return out != nullptr; }
+
+    void write(const Instruction& instr);
+
+    // Flush and close, returns false on I/O error
+    bool close();
+
+    uint64_t getRecordCount() const { return recordCount; }
+};
+
+#endif //TRACEGENERATOR_H
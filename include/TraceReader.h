@@ -1,13 +1,22 @@
 #ifndef TRACEREADER_H
 #define TRACEREADER_H
 
+#include "NewlineScanner.h"
+#include <cstddef>
+#include <memory>
 #include <vector>
 #include <string>
 
+class BinaryTraceReader;
+class InstructionBatch;
+class MappedFile;
+class TraceDecompressor;
+
+// One trace record, the addresses first so it packs into 12 bytes
 struct Instruction {
-    char type; // 'B' for branch, 'R' for other
     int sourceAddr;
-    int targetAddr;
+    int targetAddr; // 0 if the record has none
+    char type; // 'B' for branch, 'C' for call, 'R' for return, 'I' for indirect
     char direction; // 'F' for forward 'B' for backward
     bool taken; // True if taken, false if not taken, irrelevant for 'R'
 };
@@ -15,11 +24,53 @@ struct Instruction {
 class TraceReader {
 public:
     TraceReader(const std::string& filename);
-    std::vector<Instruction> readTrace();
+    ~TraceReader();
+
+    TraceReader(const TraceReader&) = delete;
+    TraceReader& operator=(const TraceReader&) = delete;
+
+    // Read the whole trace into memory, in columns for simulation
+    InstructionBatch readTrace();
+
+    // Streaming interface: open once, then pull batches until readBatch returns 0.
+    // Text and binary traces are both accepted, the format is detected from the file, and
+    // text traces may be gzip, zstd or lz4 compressed. Simulation reads column batches, tools
+    // that rewrite the trace read whole records.
+    bool open();
+    size_t readBatch(InstructionBatch& out, size_t maxInstructions);
+    size_t readBatch(std::vector<Instruction>& out, size_t maxInstructions);
+
+    // Parse one line in place, returns false if the line is not a branch record
+    static bool parseLine(const char* begin, const char* end, Instruction& instr);
+
+    // Parse statistics so far
+    size_t getBytesParsed() const { return bytesParsed; }
+    double getParseSeconds() const { return parseSeconds; }
+    double getThroughputMBps() const;
+    void printParseStats() const;
 
 private:
     std::string filename;
-    Instruction parseLine(const std::string& line);
+    std::unique_ptr<MappedFile> file; // Text traces
+    std::unique_ptr<BinaryTraceReader> binary; // Converted traces
+    std::unique_ptr<TraceDecompressor> decompressor; // Compressed text traces
+    std::vector<char> window; // Decompressed text, from the start of the unparsed line
+    size_t windowOffset; // Decompressed bytes before the window
+    const char* textEnd; // End of the complete lines in the window
+    std::vector<Instruction> pending; // Decoded binary records not handed out yet
+    size_t pendingOffset;
+    const char* cursor; // Start of the next unparsed text line
+    NewlineScanner newlines;
+    size_t bytesParsed;
+    double parseSeconds;
+
+    // Parse up to maxInstructions more records onto out, an InstructionBatch or a vector
+    template <typename Batch>
+    size_t appendBatch(Batch& out, size_t maxInstructions);
+
+    // Drop the parsed lines from the window and decompress until it holds a whole line again,
+    // returns false at the end of the trace or on error
+    bool refillText();
 };
 
-#endif // TRACEREADER_H
\ No newline at end of file
+#endif // TRACEREADER_H
@@ -0,0 +1,57 @@
+#ifndef TRACESTREAM_H
+#define TRACESTREAM_H
+
+#include "InstructionBatch.h"
+#include "TraceReader.h"
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <thread>
+
+const size_t TRACE_STREAM_DEFAULT_BATCH = 65536;
+
+// Pull-based source of instruction batches. A background thread parses into one of two
+// buffers while the caller simulates the other, so parsing overlaps simulation and memory
+// use is two batches no matter how long the trace is. The batches come in columns, the parser
+// thread also doing the transposition.
+class TraceStream {
+private:
+    TraceReader reader;
+    size_t batchSize;
+    bool opened;
+    bool background;
+
+    InstructionBatch buffers[2];
+    bool full[2];
+    int current; // Buffer the caller holds, -1 before the first batch
+    bool finished; // The parser has reached the end of the trace
+    bool stopping;
+    size_t instructionsRead;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::thread parser;
+
+    void parseLoop();
+
+public:
+    TraceStream(const std::string& filename, size_t batchSize = TRACE_STREAM_DEFAULT_BATCH, bool background = true);
+    ~TraceStream();
+
+    TraceStream(const TraceStream&) = delete;
+    TraceStream& operator=(const TraceStream&) = delete;
+
+    bool isOpen() const { return opened; }
+
+    // Next batch of instructions, or nullptr at the end of the trace.
+    // The batch stays valid until the following call.
+    const InstructionBatch* next();
+
+    size_t getInstructionsRead() const { return instructionsRead; }
+
+    // Parse throughput, only meaningful once next() has returned nullptr
+    void printParseStats() const { reader.printParseStats(); }
+};
+
+#endif //TRACESTREAM_H
@@ -0,0 +1,101 @@
+#ifndef TWOLEVELPREDICTOR_H
+#define TWOLEVELPREDICTOR_H
+
+#include "BranchTargetBuffer.h"
+#include "PackedCounterTable.h"
+#include "Prefetch.h"
+#include "PredictorConfig.h"
+#include "StatsRegistry.h"
+#include <cstdint>
+
+// Yeh and Patt two-level adaptive predictors. The first level records branch outcome histories,
+// the second is a pattern history table of 2-bit counters indexed by them.
+
+// GAg: one global history register selecting a counter in one global table.
+// Spec "gag[:historyBits]", default 12 bits of history, 2^12 counters.
+class GAgPredictor {
+private:
+    PackedCounterTable table;
+    uint32_t history;
+
+public:
+    GAgPredictor(const BTBConfig& btb, const PredictorConfig& config, Arena& arena);
+
+    bool predict(int, bool) const { return table.predict(history); }
+
+    void prefetch(int) const {}
+
+    void update(int, bool taken) {
+        table.update(history, taken);
+        history = ((history << 1) | static_cast<uint32_t>(taken)) & table.getMask();
+    }
+
+    void registerStats(StatsRegistry& stats) const {
+        stats.label("gag.counters", static_cast<uint64_t>(table.getMask()) + 1);
+    }
+
+    void saveState(CheckpointWriter& out) const {
+        table.saveState(out);
+        out.put(history);
+    }
+
+    bool loadState(CheckpointReader& in) { return table.loadState(in) && in.get(history); }
+
+    static const char* name() { return "gag"; }
+    static const char* displayName() { return "GAg"; }
+};
+
+// PAp: a per-address history table, and per-address pattern tables selected by the low
+// address bits. Spec "pap[:bhtBits[:historyBits[:addressBits]]]", default 2^10 local histories
+// of 10 bits and 2^4 pattern tables, 2^14 counters in all.
+class PApPredictor {
+private:
+    ArenaArray<uint32_t> histories;
+    uint32_t historyTableMask;
+    int historyBits;
+    uint32_t historyMask;
+    uint32_t addressMask;
+    PackedCounterTable table;
+
+    uint32_t branchIndex(int sourceAddr) const { return static_cast<uint32_t>(sourceAddr) >> 2; }
+
+    uint32_t patternIndex(int sourceAddr) const {
+        uint32_t branch = branchIndex(sourceAddr);
+        return ((branch & addressMask) << historyBits) | histories[branch & historyTableMask];
+    }
+
+public:
+    PApPredictor(const BTBConfig& btb, const PredictorConfig& config, Arena& arena);
+
+    bool predict(int sourceAddr, bool) const { return table.predict(patternIndex(sourceAddr)); }
+
+    // The branch's history, its pattern counter depends on what the history will hold
+    void prefetch(int sourceAddr) const { prefetchRead(&histories[branchIndex(sourceAddr) & historyTableMask]); }
+
+    void update(int sourceAddr, bool taken) {
+        table.update(patternIndex(sourceAddr), taken);
+        uint32_t& history = histories[branchIndex(sourceAddr) & historyTableMask];
+        history = ((history << 1) | static_cast<uint32_t>(taken)) & historyMask;
+    }
+
+    void registerStats(StatsRegistry& stats) const {
+        stats.label("pap.histories", static_cast<uint64_t>(histories.size()));
+        stats.label("pap.history_bits", static_cast<uint64_t>(historyBits));
+        stats.label("pap.counters", static_cast<uint64_t>(table.getMask()) + 1);
+    }
+
+    void saveState(CheckpointWriter& out) const {
+        out.put<int32_t>(historyBits);
+        out.putVector(histories);
+        table.saveState(out);
+    }
+
+    bool loadState(CheckpointReader& in) {
+        return in.expect<int32_t>(historyBits, "pap history bits") && in.getVector(histories) && table.loadState(in);
+    }
+
+    static const char* name() { return "pap"; }
+    static const char* displayName() { return "PAp"; }
+};
+
+#endif //TWOLEVELPREDICTOR_H
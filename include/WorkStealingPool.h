@@ -0,0 +1,56 @@
+#ifndef WORKSTEALINGPOOL_H
+#define WORKSTEALINGPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads, each with its own task deque. A worker runs its own newest task
+// first and steals the oldest task of another worker when it runs dry, so tasks submitted from
+// inside a task stay on the submitting thread (and near its data) unless someone is idle.
+// Tasks are expected to be coarse, e.g. one simulation job each.
+class WorkStealingPool {
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex stateMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable allDone;
+    size_t queued; // Tasks sitting in a deque, guarded by stateMutex
+    size_t unfinished; // Submitted but not yet completed, guarded by stateMutex
+    size_t nextQueue; // Round robin for tasks submitted from outside the pool
+    bool stopping;
+
+    bool takeTask(int worker, std::function<void()>& task);
+    void workerLoop(int worker);
+
+public:
+    // threads <= 0 uses one per hardware thread
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    // Queue a task. Called from a worker, it goes on that worker's own deque.
+    void submit(std::function<void()> task);
+
+    // Block until every submitted task, including ones submitted by tasks, has finished
+    void wait();
+
+    int getThreadCount() const { return static_cast<int>(workers.size()); }
+};
+
+#endif //WORKSTEALINGPOOL_H
@@ -0,0 +1,60 @@
+/*
+* Hash index shared by the fully associative BTB and the stack-distance profiler.
+* Buckets are two flat arrays, deletion shifts later entries of the probe chain back
+* so lookups never need tombstones.
+*
+*/
+#include "../include/AddressIndex.h"
+
+namespace {
+
+// Buckets for maxEntries keys at most half full, a power of two
+uint32_t bucketCount(int maxEntries) {
+    uint32_t size = 1;
+    while (size < static_cast<uint32_t>(maxEntries) * 2) {
+        size <<= 1;
+    }
+    return size;
+}
+
+}
+
+AddressIndex::AddressIndex(int maxEntries, Arena& arena)
+    : keys(arena, bucketCount(maxEntries), 0), values(arena, bucketCount(maxEntries), -1),
+      mask(bucketCount(maxEntries) - 1) {}
+
+void AddressIndex::set(int key, int value) {
+    uint32_t i = hash(key) & mask;
+    while (values[i] != -1 && keys[i] != key) {
+        i = (i + 1) & mask;
+    }
+    keys[i] = key;
+    values[i] = value;
+}
+
+void AddressIndex::erase(int key) {
+    uint32_t i = hash(key) & mask;
+    while (values[i] != -1 && keys[i] != key) {
+        i = (i + 1) & mask;
+    }
+    if (values[i] == -1) {
+        return; // Not present
+    }
+
+    // Backward-shift deletion keeps probe chains intact without tombstones
+    uint32_t j = i;
+    while (true) {
+        j = (j + 1) & mask;
+        if (values[j] == -1) {
+            break;
+        }
+        uint32_t home = hash(keys[j]) & mask;
+        bool canMove = (j > i) ? (home <= i || home > j) : (home <= i && home > j);
+        if (canMove) {
+            keys[i] = keys[j];
+            values[i] = values[j];
+            i = j;
+        }
+    }
+    values[i] = -1;
+}
@@ -0,0 +1,27 @@
+/*
+* Block handling of the table arena. The common case, bumping the cursor of the current block,
+* is inline in the header; this is the slow path that starts a new block.
+*
+*/
+#include "../include/Arena.h"
+#include <new>
+
+void Arena::BlockDeleter::operator()(unsigned char* block) const {
+    ::operator delete(block, std::align_val_t(CACHE_LINE_SIZE));
+}
+
+Arena::Arena(size_t blockSize) : cursor(nullptr), remaining(0), blockSize(blockSize), bytesUsed(0) {}
+
+void* Arena::allocateSlow(size_t bytes) {
+    bool own = bytes > blockSize / 4;
+    size_t size = own ? bytes : blockSize;
+    unsigned char* block = static_cast<unsigned char*>(::operator new(size, std::align_val_t(CACHE_LINE_SIZE)));
+    blocks.emplace_back(block);
+    bytesUsed += bytes;
+    if (own) {
+        return block; // The current block keeps its free space for smaller tables
+    }
+    cursor = block + bytes;
+    remaining = size - bytes;
+    return block;
+}
@@ -0,0 +1,96 @@
+/*
+* Multi-level BTB. Each faster level is an ordinary BranchTargetBuffer with its own geometry and
+* replacement policy, so the levels are neither inclusive nor exclusive: an entry is copied into
+* faster levels on a fill or a promotion and ages out of each level on its own. Only the level
+* that supplied a target is updated with a new one, the copies behind it keep the old target
+* until they are supplied again.
+*
+*/
+#include "../include/BTBHierarchy.h"
+#include "../include/Checkpoint.h"
+
+BTBHierarchy::BTBHierarchy(const BTBConfig& config, Arena& arena)
+    : fill(config.fill), promotion(config.promotion), promotions(0) {
+    levels.reserve(config.fasterLevels.size());
+    for (const BTBLevelConfig& level : config.fasterLevels) {
+        levels.emplace_back(makeBTBConfig(level.entries, level.associativity, level.policy), arena);
+        latencies.push_back(level.latency);
+    }
+    latencies.push_back(config.latency);
+    levelHits.assign(latencies.size(), 0);
+}
+
+int BTBHierarchy::update(BranchTargetBuffer& last, const BTBProbe& probe, int sourceAddr, int targetAddr) {
+    int faster = static_cast<int>(levels.size());
+    if (probe.level == -1) {
+        // Missed everywhere: allocate in the main BTB and, filling all levels, in the faster ones
+        if (fill == BTBFillPolicy::ALL) {
+            for (int level = 0; level < faster; level++) {
+                levels[level].update(probe.slots[level], sourceAddr, targetAddr);
+            }
+        }
+        return last.update(probe.slots[faster], sourceAddr, targetAddr);
+    }
+
+    if (probe.level < faster) {
+        levels[probe.level].update(probe.slots[probe.level], sourceAddr, targetAddr);
+    } else {
+        last.update(probe.slots[faster], sourceAddr, targetAddr);
+    }
+    int first = probe.level;
+    if (promotion == BTBPromotion::ALL) {
+        first = 0;
+    } else if (promotion == BTBPromotion::NEXT && probe.level > 0) {
+        first = probe.level - 1;
+    }
+    for (int level = first; level < probe.level; level++) {
+        levels[level].update(probe.slots[level], sourceAddr, targetAddr);
+        promotions++;
+    }
+    return -1;
+}
+
+void BTBHierarchy::registerStats(StatsRegistry& stats) const {
+    for (size_t level = 0; level < levelHits.size(); level++) {
+        std::string prefix = "btb.l" + std::to_string(level);
+        stats.counter(prefix + ".hits", levelHits[level]);
+        if (level < levels.size()) {
+            levels[level].registerStats(stats, prefix);
+        }
+    }
+    stats.counter("btb.promotions", promotions);
+}
+
+void BTBHierarchy::resetStatistics() {
+    for (BranchTargetBuffer& level : levels) {
+        level.resetStatistics();
+    }
+    levelHits.assign(levelHits.size(), 0);
+    promotions = 0;
+}
+
+void BTBHierarchy::saveState(CheckpointWriter& out) const {
+    for (const BranchTargetBuffer& level : levels) {
+        level.saveState(out);
+    }
+}
+
+bool BTBHierarchy::loadState(CheckpointReader& in) {
+    for (BranchTargetBuffer& level : levels) {
+        if (!level.loadState(in)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+double estimatedIPC(const FrontendTiming& timing, long long branches, long long lostCycles) {
+    double instructions = static_cast<double>(branches) * timing.instructionsPerBranch;
+    double cycles = instructions / timing.fetchWidth + static_cast<double>(lostCycles);
+    return cycles > 0 ? instructions / cycles : 0.0;
+}
+
+double ipcLossPercent(const FrontendTiming& timing, long long branches, long long lostCycles) {
+    double cycles = static_cast<double>(branches) * timing.instructionsPerBranch / timing.fetchWidth + static_cast<double>(lostCycles);
+    return cycles > 0 ? static_cast<double>(lostCycles) / cycles * 100.0 : 0.0;
+}
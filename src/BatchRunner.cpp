@@ -0,0 +1,197 @@
+/*
+* Batch mode: many (trace, BTB, predictor) jobs from a manifest, run in parallel.
+* Jobs are grouped by trace. One task per trace parses it into memory and then submits that
+* trace's jobs from inside the pool, so they land on the loading worker's own deque and idle
+* workers steal them. Every job simulates the shared, read-only instruction vector with its own
+* predictor and writes only its own result slot, so the jobs need no locking.
+*
+*/
+#include "../include/BatchRunner.h"
+#include "../include/InstructionBatch.h"
+#include "../include/PredictorRegistry.h"
+#include "../include/TraceReader.h"
+#include "../include/WorkStealingPool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+
+bool readBatchManifest(const std::string& filename, std::vector<BatchJob>& jobs) {
+    std::ifstream manifest(filename);
+    if (!manifest) {
+        std::cerr << "Error: Unable to open manifest " << filename << std::endl;
+        return false;
+    }
+
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(manifest, line)) {
+        lineNumber++;
+        std::istringstream fields(line);
+        std::string trace, btbSpec, predictorSpec, extra;
+        if (!(fields >> trace) || trace[0] == '#') {
+            continue;
+        }
+
+        BatchJob job;
+        job.trace = trace;
+        job.line = lineNumber;
+        if (!(fields >> btbSpec >> predictorSpec) || (fields >> extra && extra[0] != '#')) {
+            std::cerr << "Error: " << filename << ":" << lineNumber
+                      << ": expected <trace_file> <btb_spec> <predictor_spec>" << std::endl;
+            return false;
+        }
+        if (!parseBTBConfig(btbSpec, job.btb)) {
+            std::cerr << "Error: " << filename << ":" << lineNumber << ": invalid BTB spec " << btbSpec << std::endl;
+            return false;
+        }
+        if (!parsePredictorConfig(predictorSpec, job.predictor)) {
+            std::cerr << "Error: " << filename << ":" << lineNumber << ": invalid predictor spec " << predictorSpec << std::endl;
+            return false;
+        }
+        if (!validatePredictorConfig(job.predictor)) {
+            std::cerr << "       at " << filename << ":" << lineNumber << std::endl;
+            return false;
+        }
+        jobs.push_back(job);
+    }
+    return true;
+}
+
+BatchRunner::BatchRunner(const std::vector<BatchJob>& jobs, int threads)
+    : jobs(jobs), threads(threads), wallSeconds(0.0) {}
+
+bool BatchRunner::run() {
+    results.assign(jobs.size(), BatchResult());
+    for (size_t i = 0; i < jobs.size(); i++) {
+        results[i].result.config.btb = jobs[i].btb;
+        results[i].result.config.predictor = jobs[i].predictor;
+        results[i].seconds = 0.0;
+        results[i].ok = false;
+    }
+
+    // Jobs of each distinct trace, in manifest order
+    std::map<std::string, std::vector<size_t>> jobsByTrace;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        jobsByTrace[jobs[i].trace].push_back(i);
+    }
+
+    std::atomic<bool> allRead(true);
+    auto start = std::chrono::steady_clock::now();
+    {
+        WorkStealingPool pool(threads);
+        threads = pool.getThreadCount();
+
+        for (const auto& group : jobsByTrace) {
+            const std::string& traceFile = group.first;
+            const std::vector<size_t>& traceJobs = group.second;
+
+            pool.submit([this, &pool, &allRead, &traceFile, &traceJobs]() {
+                TraceReader reader(traceFile);
+                if (!reader.open()) {
+                    std::cerr << "Error: Unable to read trace " << traceFile << std::endl;
+                    allRead = false;
+                    return;
+                }
+                // Freed when the last job holding it finishes
+                std::shared_ptr<const InstructionBatch> trace = std::make_shared<const InstructionBatch>(reader.readTrace());
+
+                for (size_t index : traceJobs) {
+                    pool.submit([this, trace, index]() {
+                        auto jobStart = std::chrono::steady_clock::now();
+                        Arena arena;
+                        std::unique_ptr<SweepTarget> target = makeSweepTarget(jobs[index].predictor, jobs[index].btb, arena);
+                        target->simulateBlock(*trace, 0, trace->size());
+                        target->collect(results[index].result);
+                        results[index].seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+                        results[index].ok = true;
+                    });
+                }
+            });
+        }
+        pool.wait();
+    }
+    wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return allRead;
+}
+
+void BatchRunner::printReport() const {
+    size_t traceWidth = 5;
+    for (const BatchJob& job : jobs) {
+        traceWidth = std::max(traceWidth, job.trace.size());
+    }
+
+    std::cout << std::left << std::setw(static_cast<int>(traceWidth) + 2) << "trace";
+    printResultHeader();
+
+    long long instructions = 0;
+    double jobSeconds = 0.0;
+    int failed = 0;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        std::cout << std::left << std::setw(static_cast<int>(traceWidth) + 2) << jobs[i].trace;
+        if (!results[i].ok) {
+            std::cout << "failed" << std::endl;
+            failed++;
+            continue;
+        }
+        printResultRow(results[i].result);
+        instructions += results[i].result.instructions;
+        jobSeconds += results[i].seconds;
+    }
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2)
+            << "Ran " << jobs.size() - failed << " of " << jobs.size() << " jobs on " << threads << " threads in "
+            << wallSeconds << " s (" << jobSeconds << " s of simulation, "
+            << (wallSeconds > 0.0 ? jobSeconds / wallSeconds : 0.0) << "x parallel, "
+            << (wallSeconds > 0.0 ? instructions / wallSeconds / 1e6 : 0.0) << "M instructions/s)";
+    std::cout << summary.str() << std::endl;
+}
+
+int runBatchCommand(int argc, char* argv[], const StatsOutput& statsOutput) {
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " --batch <manifest> [threads]" << std::endl;
+        std::cerr << "       manifest lines: <trace_file> <btb_spec> <predictor_spec>" << std::endl;
+        std::cerr << predictorUsage() << std::endl;
+        return 1;
+    }
+
+    std::vector<BatchJob> jobs;
+    if (!readBatchManifest(argv[2], jobs)) {
+        return 1;
+    }
+    int threads = 0;
+    if (argc > 3) {
+        char* end = nullptr;
+        long value = std::strtol(argv[3], &end, 10);
+        if (*end != '\0' || value <= 0 || value > INT_MAX) {
+            std::cerr << "Error: Invalid thread count " << argv[3] << std::endl;
+            std::cerr << "Usage: " << argv[0] << " --batch <manifest> [threads]" << std::endl;
+            return 1;
+        }
+        threads = static_cast<int>(value);
+    }
+
+    BatchRunner runner(jobs, threads);
+    bool ok = runner.run();
+    runner.printReport();
+
+    // Failed jobs have no counters and are left out
+    std::vector<StatsRegistry> runs;
+    for (size_t i = 0; i < jobs.size(); i++) {
+        if (runner.getResults()[i].ok) {
+            runs.push_back(StatsRegistry());
+            runs.back().label("trace", jobs[i].trace);
+            runs.back().label("line", static_cast<uint64_t>(jobs[i].line));
+            runs.back().merge(resultStats(runner.getResults()[i].result));
+        }
+    }
+    return writeStatsOutput(statsOutput, runs) && ok ? 0 : 1;
+}
@@ -0,0 +1,608 @@
+#include "../include/Arena.h"
+#include "../include/BinaryTrace.h"
+#include "../include/BranchPredictor.h"
+#include "../include/BranchTargetBuffer.h"
+#include "../include/GsharePredictor.h"
+#include "../include/InstructionBatch.h"
+#include "../include/PredictorRegistry.h"
+#include "../include/TagSearch.h"
+#include "../include/TagePredictor.h"
+#include "../include/TraceReader.h"
+#include "../include/TwoBitBranchPredictor.h"
+#include "../include/TwoLevelPredictor.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/*
+* branchsim_bench: microbenchmarks for the hot paths, BTB lookup/insert over a range of sizes and
+* geometries, the tag search of one set per SIMD path, trace parsing (per line, text file and
+* binary file), building a sweep's configurations and end-to-end simulation per predictor. Each benchmark is scaled until it runs for --min-time, repeated, and the median
+* ns/op is reported with the heap allocations per op counted by the operator new below.
+* --json writes the results in the Google Benchmark layout so runs can be diffed with
+* src/compare_bench.py.
+*
+*/
+
+namespace {
+
+std::atomic<long long> allocationCount(0);
+std::atomic<long long> allocatedBytes(0);
+
+// Every replaced operator new allocates here and every operator delete frees here, so the
+// malloc/free pairing is in one place. alignment 0 means the default.
+void* countedAlloc(size_t size, size_t alignment) {
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    allocatedBytes.fetch_add(static_cast<long long>(size), std::memory_order_relaxed);
+    size = std::max<size_t>(size, 1);
+    void* memory = alignment == 0 ? std::malloc(size) : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+    if (memory == nullptr) {
+        throw std::bad_alloc();
+    }
+    return memory;
+}
+
+// Once inlined into an operator delete, GCC sees memory from operator new reaching free and warns.
+// That operator new is the one above, which got it from malloc or aligned_alloc, so free is right.
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void countedFree(void* memory) noexcept {
+    std::free(memory);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+}
+
+void* operator new(size_t size) {
+    return countedAlloc(size, 0);
+}
+
+void* operator new[](size_t size) {
+    return countedAlloc(size, 0);
+}
+
+void operator delete(void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, size_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete[](void* memory, size_t) noexcept {
+    countedFree(memory);
+}
+
+// The arena's cache-line aligned blocks
+void* operator new(size_t size, std::align_val_t alignment) {
+    return countedAlloc(size, static_cast<size_t>(alignment));
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    countedFree(memory);
+}
+
+namespace {
+
+const int BENCH_REPETITIONS = 3;
+const size_t ADDRESS_STREAM_SIZE = 1 << 16; // Power of two, indexed with a mask
+const size_t SYNTHETIC_INSTRUCTIONS = 1000000;
+const int SYNTHETIC_BRANCH_SITES = 4096;
+
+// Keep a value alive without letting the compiler see what happens to it
+template <typename T>
+inline void doNotOptimize(const T& value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+struct BenchOptions {
+    double minSeconds = 0.1;
+    std::string filter;
+    std::string jsonFile;
+    std::string traceFile; // Real trace for the reader benchmarks, synthetic if empty
+};
+
+struct BenchResult {
+    std::string name;
+    size_t iterations;
+    double nsPerOp;
+    double allocationsPerOp;
+    double bytesAllocatedPerOp;
+    double itemsPerSecond; // 0 if the benchmark has no item count
+    double bytesPerSecond; // 0 if the benchmark has no byte count
+};
+
+uint32_t xorshift(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+class BenchRunner {
+private:
+    BenchOptions options;
+    std::vector<BenchResult> results;
+
+public:
+    explicit BenchRunner(const BenchOptions& options) : options(options) {}
+
+    // body(iterations) runs the operation that many times. itemsPerOp and bytesPerOp turn the
+    // time per op into a throughput, e.g. a whole-file pass is one op of N instructions.
+    void run(const std::string& name, const std::function<void(size_t)>& body,
+             double itemsPerOp = 0, double bytesPerOp = 0) {
+        if (!options.filter.empty() && name.find(options.filter) == std::string::npos) {
+            return;
+        }
+
+        // Grow the iteration count until one run takes a measurable time, then aim for minSeconds
+        size_t iterations = 1;
+        double seconds = timeRun(body, iterations);
+        while (seconds < options.minSeconds / 10 && iterations < (size_t(1) << 40)) {
+            iterations *= 10;
+            seconds = timeRun(body, iterations);
+        }
+        if (seconds < options.minSeconds) {
+            iterations = static_cast<size_t>(iterations * options.minSeconds / std::max(seconds, 1e-9)) + 1;
+        }
+
+        std::vector<double> samples;
+        long long allocations = 0;
+        long long bytes = 0;
+        for (int rep = 0; rep < BENCH_REPETITIONS; rep++) {
+            long long allocationsBefore = allocationCount.load();
+            long long bytesBefore = allocatedBytes.load();
+            samples.push_back(timeRun(body, iterations) * 1e9 / iterations);
+            allocations += allocationCount.load() - allocationsBefore;
+            bytes += allocatedBytes.load() - bytesBefore;
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult result;
+        result.name = name;
+        result.iterations = iterations;
+        result.nsPerOp = samples[samples.size() / 2];
+        double ops = static_cast<double>(iterations) * BENCH_REPETITIONS;
+        result.allocationsPerOp = allocations / ops;
+        result.bytesAllocatedPerOp = bytes / ops;
+        result.itemsPerSecond = itemsPerOp > 0 ? itemsPerOp * 1e9 / result.nsPerOp : 0;
+        result.bytesPerSecond = bytesPerOp > 0 ? bytesPerOp * 1e9 / result.nsPerOp : 0;
+        results.push_back(result);
+        printResult(result);
+    }
+
+    static void printHeader() {
+        std::cout << std::left << std::setw(44) << "benchmark" << std::right
+                  << std::setw(14) << "iterations" << std::setw(16) << "ns/op" << std::setw(12) << "allocs/op"
+                  << std::setw(14) << "Mitems/s" << std::setw(10) << "MB/s" << std::endl;
+    }
+
+    static void printResult(const BenchResult& result) {
+        std::cout << std::left << std::setw(44) << result.name << std::right
+                  << std::setw(14) << result.iterations
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(16) << result.nsPerOp
+                  << std::setw(12) << result.allocationsPerOp
+                  << std::setw(14) << result.itemsPerSecond / 1e6
+                  << std::setw(10) << result.bytesPerSecond / 1e6 << std::endl;
+    }
+
+    bool writeJson(const std::string& filename) const {
+        std::ofstream out(filename);
+        if (!out) {
+            std::cerr << "Error: Unable to open " << filename << " for writing." << std::endl;
+            return false;
+        }
+        char date[64];
+        std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", std::localtime(&now));
+
+        out << "{\n  \"context\": {\n"
+            << "    \"date\": \"" << date << "\",\n"
+            << "    \"executable\": \"branchsim_bench\",\n"
+#ifdef __VERSION__
+            << "    \"compiler\": \"" << __VERSION__ << "\",\n"
+#endif
+#ifdef NDEBUG
+            << "    \"library_build_type\": \"release\",\n"
+#else
+            << "    \"library_build_type\": \"debug\",\n"
+#endif
+            << "    \"repetitions\": " << BENCH_REPETITIONS << "\n  },\n  \"benchmarks\": [";
+        out << std::setprecision(6) << std::fixed;
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& result = results[i];
+            out << (i == 0 ? "\n" : ",\n")
+                << "    {\"name\": \"" << result.name << "\", \"run_type\": \"aggregate\", \"aggregate_name\": \"median\", "
+                << "\"iterations\": " << result.iterations << ", "
+                << "\"real_time\": " << result.nsPerOp << ", \"time_unit\": \"ns\", "
+                << "\"allocs_per_iter\": " << result.allocationsPerOp << ", "
+                << "\"bytes_allocated_per_iter\": " << result.bytesAllocatedPerOp << ", "
+                << "\"items_per_second\": " << result.itemsPerSecond << ", "
+                << "\"bytes_per_second\": " << result.bytesPerSecond << "}";
+        }
+        out << "\n  ]\n}\n";
+        return true;
+    }
+
+private:
+    static double timeRun(const std::function<void(size_t)>& body, size_t iterations) {
+        auto start = std::chrono::steady_clock::now();
+        body(iterations);
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+};
+
+// Deterministic program-like trace: a fixed set of branch sites, each with its own bias,
+// visited with a skew towards a small hot set
+std::vector<Instruction> makeSyntheticTrace(size_t count) {
+    uint32_t state = 0x12345678u;
+    std::vector<Instruction> sites(SYNTHETIC_BRANCH_SITES);
+    std::vector<uint32_t> takenPercent(SYNTHETIC_BRANCH_SITES);
+    for (int i = 0; i < SYNTHETIC_BRANCH_SITES; i++) {
+        Instruction& site = sites[i];
+        site.type = 'B';
+        site.sourceAddr = 0x8000 + i * 0x40 + static_cast<int>(xorshift(state) % 16) * 4;
+        bool backward = xorshift(state) % 3 == 0;
+        site.targetAddr = site.sourceAddr + (backward ? -1 : 1) * static_cast<int>(4 + xorshift(state) % 0x400);
+        site.direction = backward ? 'B' : 'F';
+        takenPercent[i] = backward ? 90 : xorshift(state) % 100;
+    }
+
+    std::vector<Instruction> trace(count);
+    for (size_t i = 0; i < count; i++) {
+        uint32_t pick = xorshift(state);
+        // Three quarters of the branches come from the hottest 1/16 of the sites
+        int site = (pick & 3) != 0 ? static_cast<int>((pick >> 2) % (SYNTHETIC_BRANCH_SITES / 16))
+                                   : static_cast<int>((pick >> 2) % SYNTHETIC_BRANCH_SITES);
+        trace[i] = sites[site];
+        trace[i].taken = xorshift(state) % 100 < takenPercent[site];
+    }
+    return trace;
+}
+
+// The same instructions as text lines in the simulator's trace format
+std::string formatTextTrace(const std::vector<Instruction>& trace) {
+    std::string text;
+    text.reserve(trace.size() * 48);
+    char line[96];
+    for (size_t i = 0; i < trace.size(); i++) {
+        const Instruction& instr = trace[i];
+        int length = std::snprintf(line, sizeof(line), "%c %08lx from %08x to %08x %c %s\n", instr.type,
+                                   static_cast<unsigned long>(i), static_cast<unsigned>(instr.sourceAddr),
+                                   static_cast<unsigned>(instr.targetAddr), instr.direction,
+                                   instr.taken ? "taken" : "not taken");
+        text.append(line, length);
+    }
+    return text;
+}
+
+std::string temporaryPath(const char* suffix) {
+    const char* dir = std::getenv("TMPDIR");
+    return std::string(dir != nullptr ? dir : "/tmp") + "/branchsim_bench_" + std::to_string(getpid()) + suffix;
+}
+
+std::string levelName(int entries, int associativity, ReplacementPolicy policy) {
+    std::string ways = (associativity <= 0 || associativity >= entries) ? "full" : std::to_string(associativity);
+    return std::to_string(entries) + ":" + ways + ":" + replacementPolicyName(policy);
+}
+
+// Faster levels first, joined by '+' as in a BTB spec
+std::string geometryName(const BTBConfig& config) {
+    std::string name;
+    for (const BTBLevelConfig& level : config.fasterLevels) {
+        name += levelName(level.entries, level.associativity, level.policy) + "+";
+    }
+    return name + levelName(config.entries, config.associativity, config.policy);
+}
+
+// Lookups and inserts over a working set twice the BTB size, so roughly half of them hit
+void benchBTB(BenchRunner& runner) {
+    const int sizes[] = {1, 16, 128, 1024, 10000};
+    const int associativities[] = {0, 1, 4, 8, 16, 32, 64};
+    const ReplacementPolicy policies[] = {ReplacementPolicy::LRU, ReplacementPolicy::PLRU, ReplacementPolicy::RANDOM};
+
+    for (int size : sizes) {
+        std::vector<int> addresses(ADDRESS_STREAM_SIZE);
+        uint32_t state = 0x9E3779B9u;
+        int workingSet = std::max(2, size * 2);
+        for (int& address : addresses) {
+            address = 0x400000 + static_cast<int>(xorshift(state) % workingSet) * 4;
+        }
+
+        for (int associativity : associativities) {
+            if (associativity != 0 && associativity >= size) {
+                continue; // Same as fully associative
+            }
+            if (associativity != 0 && size % associativity != 0) {
+                continue;
+            }
+            for (ReplacementPolicy policy : policies) {
+                if (associativity == 1 && policy != ReplacementPolicy::LRU) {
+                    continue; // Direct-mapped has no replacement choice
+                }
+                BTBConfig config = makeBTBConfig(size, associativity, policy);
+                Arena arena;
+
+                BranchTargetBuffer lookupBTB(config, arena);
+                for (int address : addresses) {
+                    lookupBTB.insert(address, address + 0x40);
+                }
+                runner.run("BTB/lookup/" + geometryName(config), [&](size_t iterations) {
+                    int sum = 0;
+                    for (size_t i = 0; i < iterations; i++) {
+                        sum += lookupBTB.getTargetAddress(addresses[i & (ADDRESS_STREAM_SIZE - 1)]);
+                    }
+                    doNotOptimize(sum);
+                });
+
+                BranchTargetBuffer insertBTB(config, arena);
+                runner.run("BTB/insert/" + geometryName(config), [&](size_t iterations) {
+                    for (size_t i = 0; i < iterations; i++) {
+                        int address = addresses[i & (ADDRESS_STREAM_SIZE - 1)];
+                        insertBTB.insert(address, address + 0x40);
+                    }
+                    doNotOptimize(insertBTB);
+                });
+
+                // What the simulation loop does per taken branch: one probe, then an update through it
+                BranchTargetBuffer accessBTB(config, arena);
+                runner.run("BTB/lookup+update/" + geometryName(config), [&](size_t iterations) {
+                    int sum = 0;
+                    for (size_t i = 0; i < iterations; i++) {
+                        int address = addresses[i & (ADDRESS_STREAM_SIZE - 1)];
+                        BTBSlot entry = accessBTB.lookup(address);
+                        sum += accessBTB.getTarget(entry);
+                        accessBTB.update(entry, address, address + 0x40);
+                    }
+                    doNotOptimize(sum);
+                });
+            }
+        }
+    }
+}
+
+// One set's tag search per path, over full sets of 4 to 64 ways, half of the searches missing
+void benchTagSearch(BenchRunner& runner) {
+    const std::pair<const char*, TagSearchFunction> paths[] = {
+        {"scalar", findTagScalar}, {"sse2", sse2TagSearch()}, {"avx2", avx2TagSearch()}};
+    const int counts[] = {4, 8, 16, 64};
+
+    for (int count : counts) {
+        std::vector<int> tags(count);
+        for (int way = 0; way < count; way++) {
+            tags[way] = 0x400000 + way * 8;
+        }
+        std::vector<int> keys(ADDRESS_STREAM_SIZE);
+        uint32_t state = 0x9E3779B9u;
+        for (int& key : keys) {
+            key = 0x400000 + static_cast<int>(xorshift(state) % (2 * count)) * 4;
+        }
+        for (const auto& path : paths) {
+            if (path.second == nullptr) {
+                continue; // Not supported by this CPU
+            }
+            runner.run(std::string("TagSearch/") + path.first + "/" + std::to_string(count), [&](size_t iterations) {
+                int sum = 0;
+                for (size_t i = 0; i < iterations; i++) {
+                    sum += path.second(tags.data(), count, keys[i & (ADDRESS_STREAM_SIZE - 1)]);
+                }
+                doNotOptimize(sum);
+            });
+        }
+    }
+}
+
+void benchParsing(BenchRunner& runner, const std::vector<Instruction>& trace, const BenchOptions& options) {
+    // parseLine alone, over lines already split in memory
+    std::string text = formatTextTrace(trace);
+    std::vector<size_t> lineStarts;
+    lineStarts.push_back(0);
+    for (size_t i = 0; i < text.size(); i++) {
+        if (text[i] == '\n') {
+            lineStarts.push_back(i + 1);
+        }
+    }
+    size_t lines = lineStarts.size() - 1;
+    runner.run("Parse/parseLine", [&](size_t iterations) {
+        Instruction instr;
+        int sum = 0;
+        for (size_t i = 0; i < iterations; i++) {
+            size_t line = i % lines;
+            TraceReader::parseLine(text.data() + lineStarts[line], text.data() + lineStarts[line + 1] - 1, instr);
+            sum += instr.sourceAddr;
+        }
+        doNotOptimize(sum);
+    }, 1, static_cast<double>(text.size()) / lines);
+
+    // Whole-file passes through TraceReader, text and converted binary
+    std::string textFile = options.traceFile;
+    bool ownTextFile = textFile.empty();
+    if (ownTextFile) {
+        textFile = temporaryPath(".txt");
+        std::ofstream out(textFile, std::ios::binary);
+        out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    }
+    std::string binaryFile = temporaryPath(".bpt");
+    size_t instructions = 0;
+    {
+        TraceReader reader(textFile);
+        BinaryTraceWriter writer(binaryFile);
+        std::vector<Instruction> batch;
+        if (reader.open()) {
+            while (reader.readBatch(batch, 65536) > 0) {
+                for (const Instruction& instr : batch) {
+                    writer.write(instr);
+                }
+                instructions += batch.size();
+            }
+        }
+        writer.close();
+    }
+
+    const std::string* files[] = {&textFile, &binaryFile};
+    const char* names[] = {"Parse/TraceReader/text", "Parse/TraceReader/binary"};
+    for (int f = 0; f < 2; f++) {
+        std::ifstream sizeCheck(*files[f], std::ios::binary | std::ios::ate);
+        double fileBytes = static_cast<double>(sizeCheck.tellg());
+        runner.run(names[f], [&](size_t iterations) {
+            std::vector<Instruction> batch;
+            for (size_t i = 0; i < iterations; i++) {
+                TraceReader reader(*files[f]);
+                if (!reader.open()) {
+                    return;
+                }
+                while (reader.readBatch(batch, 65536) > 0) {
+                    doNotOptimize(batch.data());
+                }
+            }
+        }, static_cast<double>(instructions), fileBytes);
+    }
+
+    if (ownTextFile) {
+        std::remove(textFile.c_str());
+    }
+    std::remove(binaryFile.c_str());
+}
+
+// What a sweep or batch run does before simulating: every predictor behind every BTB geometry,
+// built from one arena and dropped again. One op is the whole set.
+void benchConstruction(BenchRunner& runner) {
+    const char* btbSpecs[] = {"512", "1024:4:plru", "4096:8:lru", "16384:4:lru", "64+1024:4:lru:ras16:ind512"};
+    const char* predictorSpecs[] = {"static", "twobit", "gshare", "gag", "pap", "tage"};
+    std::vector<SweepConfig> configs;
+    for (const char* btbSpec : btbSpecs) {
+        for (const char* predictorSpec : predictorSpecs) {
+            SweepConfig config;
+            parseBTBConfig(btbSpec, config.btb);
+            parsePredictorConfig(predictorSpec, config.predictor);
+            configs.push_back(config);
+        }
+    }
+
+    runner.run("Construct/sweep-" + std::to_string(configs.size()), [&](size_t iterations) {
+        std::vector<std::unique_ptr<SweepTarget>> targets;
+        targets.reserve(configs.size());
+        for (size_t i = 0; i < iterations; i++) {
+            Arena arena;
+            for (const SweepConfig& config : configs) {
+                targets.push_back(makeSweepTarget(config.predictor, config.btb, arena));
+            }
+            doNotOptimize(targets.back());
+            targets.clear();
+        }
+    }, static_cast<double>(configs.size()));
+}
+
+template <typename Predictor>
+void benchPredictor(BenchRunner& runner, const BTBConfig& config, const InstructionBatch& trace) {
+    // One op is a whole pass over the trace with a fresh predictor
+    runner.run(std::string("Simulate/") + Predictor::name() + "/" + geometryName(config), [&](size_t iterations) {
+        for (size_t i = 0; i < iterations; i++) {
+            SimulationDriver<Predictor> driver(config);
+            driver.simulateBatch(trace);
+            doNotOptimize(driver.getPredictionHits());
+        }
+    }, static_cast<double>(trace.size()));
+}
+
+void benchSimulation(BenchRunner& runner, const std::vector<Instruction>& records) {
+    // The columns every simulating mode hands the driver
+    InstructionBatch trace(records);
+    std::vector<BTBConfig> configs = {
+        makeBTBConfig(16, 0, ReplacementPolicy::LRU),
+        makeBTBConfig(512, 0, ReplacementPolicy::LRU),
+        makeBTBConfig(4096, 0, ReplacementPolicy::LRU),
+        makeBTBConfig(1024, 1, ReplacementPolicy::LRU),
+        makeBTBConfig(1024, 4, ReplacementPolicy::LRU),
+        makeBTBConfig(1024, 4, ReplacementPolicy::PLRU),
+    };
+    for (const BTBConfig& config : configs) {
+        benchPredictor<StaticPredictor>(runner, config, trace);
+    }
+    for (const BTBConfig& config : configs) {
+        benchPredictor<TwoBitPredictor>(runner, config, trace);
+    }
+    // History-based predictors at their default table sizes, behind a common BTB
+    benchPredictor<GsharePredictor>(runner, configs[4], trace);
+    benchPredictor<GAgPredictor>(runner, configs[4], trace);
+    benchPredictor<PApPredictor>(runner, configs[4], trace);
+    benchPredictor<TagePredictor>(runner, configs[4], trace);
+
+    // A small fully associative L0 in front of the common BTB
+    BTBConfig levels = configs[4];
+    levels.fasterLevels.push_back(BTBLevelConfig{64, 0, ReplacementPolicy::LRU, 0});
+    levels.latency = 1;
+    benchPredictor<TwoBitPredictor>(runner, levels, trace);
+}
+
+void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " [--filter <substring>] [--min-time <seconds>] [--json <file>] [--trace <file>]" << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        if (arg == "--filter") {
+            options.filter = argv[++i];
+        } else if (arg == "--min-time") {
+            options.minSeconds = std::atof(argv[++i]);
+        } else if (arg == "--json") {
+            options.jsonFile = argv[++i];
+        } else if (arg == "--trace") {
+            options.traceFile = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<Instruction> trace = makeSyntheticTrace(SYNTHETIC_INSTRUCTIONS);
+
+    BenchRunner runner(options);
+    BenchRunner::printHeader();
+    benchBTB(runner);
+    benchTagSearch(runner);
+    benchParsing(runner, trace, options);
+    benchConstruction(runner);
+    benchSimulation(runner, trace);
+
+    if (!options.jsonFile.empty() && !runner.writeJson(options.jsonFile)) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,233 @@
+/*
+* Writer and block reader for the packed binary trace format described in BinaryTrace.h.
+* The reader works straight out of the memory-mapped file and decodes one block at a time,
+* so a converted trace is replayed without any text parsing.
+*
+*/
+#include "../include/BinaryTrace.h"
+#include <cstring>
+#include <iostream>
+#include <utility>
+
+namespace {
+
+const char MAGIC[8] = {'B', 'P', 'T', 'R', 'A', 'C', 'E', '\0'};
+const size_t HEADER_SIZE = 32;
+const size_t RECORD_COUNT_OFFSET = 16;
+
+const uint8_t TYPE_LITERAL = 7;
+const uint8_t TAKEN_BIT = 1 << 3;
+const uint8_t HAS_TARGET_BIT = 1 << 6;
+const char TYPE_CODES[] = {'B', 'R', 'M', 'C', 'I'};
+const char DIRECTION_CODES[] = {'?', 'F', 'B', '?'};
+
+uint8_t typeCode(char type) {
+    for (uint8_t code = 0; code < sizeof(TYPE_CODES); code++) {
+        if (TYPE_CODES[code] == type) {
+            return code;
+        }
+    }
+    return TYPE_LITERAL;
+}
+
+uint8_t directionCode(char direction) {
+    return direction == 'F' ? 1 : direction == 'B' ? 2 : 0;
+}
+
+void putLittleEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+uint64_t getLittleEndian(const char* p, int bytes) {
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+        value |= static_cast<uint64_t>(static_cast<uint8_t>(p[i])) << (8 * i);
+    }
+    return value;
+}
+
+void putVarint(std::vector<uint8_t>& out, uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<uint8_t>(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+// Returns false if the varint runs past end
+inline bool getVarint(const uint8_t*& p, const uint8_t* end, uint64_t& value) {
+    if (p < end && *p < 0x80) {
+        value = *p++; // Small deltas fit in one byte, the common case
+        return true;
+    }
+    value = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t byte = *p++;
+        value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+        if ((byte & 0x80) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+inline uint64_t zigzag(int64_t value) {
+    return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+}
+
+inline int64_t unzigzag(uint64_t value) {
+    return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+}
+
+bool isBinaryTrace(const char* data, size_t size) {
+    return size >= sizeof(MAGIC) && std::memcmp(data, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+BinaryTraceWriter::BinaryTraceWriter(const std::string& filename, uint32_t blockRecords)
+    : out(filename, std::ios::binary | std::ios::trunc), blockRecords(blockRecords > 0 ? blockRecords : 1),
+      recordCount(0), previousSource(0) {
+    if (!out.is_open()) {
+        return;
+    }
+    std::vector<uint8_t> header(MAGIC, MAGIC + sizeof(MAGIC));
+    putLittleEndian(header, BINARY_TRACE_VERSION, 2);
+    putLittleEndian(header, HEADER_SIZE, 2);
+    putLittleEndian(header, this->blockRecords, 4);
+    putLittleEndian(header, 0, 8); // Record count, patched by close()
+    putLittleEndian(header, 0, 8);
+    out.write(reinterpret_cast<const char*>(header.data()), header.size());
+    flags.reserve(this->blockRecords);
+}
+
+BinaryTraceWriter::~BinaryTraceWriter() {
+    close();
+}
+
+void BinaryTraceWriter::write(const Instruction& instr) {
+    uint8_t code = typeCode(instr.type);
+    bool hasTarget = instr.targetAddr != 0 || instr.type == 'B';
+    flags.push_back(static_cast<uint8_t>(code | (instr.taken ? TAKEN_BIT : 0) |
+                                         (directionCode(instr.direction) << 4) | (hasTarget ? HAS_TARGET_BIT : 0)));
+    if (code == TYPE_LITERAL) {
+        addresses.push_back(static_cast<uint8_t>(instr.type));
+    }
+    putVarint(addresses, zigzag(static_cast<int64_t>(instr.sourceAddr) - previousSource));
+    if (hasTarget) {
+        putVarint(addresses, zigzag(static_cast<int64_t>(instr.targetAddr) - instr.sourceAddr));
+    }
+    previousSource = instr.sourceAddr;
+    recordCount++;
+
+    if (flags.size() == blockRecords) {
+        flushBlock();
+    }
+}
+
+void BinaryTraceWriter::flushBlock() {
+    if (flags.empty()) {
+        return;
+    }
+    std::vector<uint8_t> blockHeader;
+    putLittleEndian(blockHeader, flags.size(), 4);
+    putLittleEndian(blockHeader, flags.size() + addresses.size(), 4);
+    out.write(reinterpret_cast<const char*>(blockHeader.data()), blockHeader.size());
+    out.write(reinterpret_cast<const char*>(flags.data()), flags.size());
+    out.write(reinterpret_cast<const char*>(addresses.data()), addresses.size());
+    flags.clear();
+    addresses.clear();
+}
+
+bool BinaryTraceWriter::close() {
+    if (!out.is_open()) {
+        return false;
+    }
+    flushBlock();
+    std::vector<uint8_t> count;
+    putLittleEndian(count, recordCount, 8);
+    out.seekp(RECORD_COUNT_OFFSET);
+    out.write(reinterpret_cast<const char*>(count.data()), count.size());
+    bool ok = out.good();
+    out.close();
+    return ok;
+}
+
+BinaryTraceReader::BinaryTraceReader(const std::string& filename)
+    : BinaryTraceReader(std::unique_ptr<MappedFile>(new MappedFile(filename))) {}
+
+BinaryTraceReader::BinaryTraceReader(std::unique_ptr<MappedFile> mappedFile)
+    : file(std::move(mappedFile)), valid(false), blockRecords(0), recordCount(0), offset(0), previousSource(0) {
+    if (!file->isOpen() || file->size() < HEADER_SIZE || !isBinaryTrace(file->data(), file->size())) {
+        return;
+    }
+    const char* header = file->data();
+    uint16_t version = static_cast<uint16_t>(getLittleEndian(header + 8, 2));
+    uint16_t headerSize = static_cast<uint16_t>(getLittleEndian(header + 10, 2));
+    if (version != BINARY_TRACE_VERSION || headerSize < HEADER_SIZE || headerSize > file->size()) {
+        std::cerr << "Error: Unsupported binary trace version " << version << "." << std::endl;
+        return;
+    }
+    blockRecords = static_cast<uint32_t>(getLittleEndian(header + 12, 4));
+    recordCount = getLittleEndian(header + RECORD_COUNT_OFFSET, 8);
+    offset = headerSize;
+    valid = true;
+}
+
+bool BinaryTraceReader::readBlock(std::vector<Instruction>& out) {
+    out.clear();
+    if (!valid || file->size() - offset < 8) {
+        return false;
+    }
+    const char* block = file->data() + offset;
+    uint32_t records = static_cast<uint32_t>(getLittleEndian(block, 4));
+    uint32_t payloadBytes = static_cast<uint32_t>(getLittleEndian(block + 4, 4));
+    if (records > payloadBytes || payloadBytes > file->size() - offset - 8) {
+        std::cerr << "Error: Truncated binary trace block." << std::endl;
+        valid = false;
+        return false;
+    }
+
+    const uint8_t* flags = reinterpret_cast<const uint8_t*>(block + 8);
+    const uint8_t* p = flags + records;
+    const uint8_t* end = flags + payloadBytes;
+    out.resize(records);
+
+    for (uint32_t i = 0; i < records; i++) {
+        uint8_t flag = flags[i];
+        Instruction& instr = out[i];
+        uint64_t sourceDelta = 0;
+        uint64_t targetDelta = 0;
+        uint8_t code = flag & 7;
+
+        bool ok = true;
+        if (code == TYPE_LITERAL) {
+            ok = p < end;
+            instr.type = ok ? static_cast<char>(*p++) : '?';
+        } else {
+            instr.type = code < sizeof(TYPE_CODES) ? TYPE_CODES[code] : '?';
+        }
+        ok = ok && getVarint(p, end, sourceDelta);
+        if (flag & HAS_TARGET_BIT) {
+            ok = ok && getVarint(p, end, targetDelta);
+        }
+        if (!ok) {
+            std::cerr << "Error: Corrupt binary trace block." << std::endl;
+            out.resize(i);
+            valid = false;
+            return !out.empty();
+        }
+
+        instr.sourceAddr = static_cast<int>(previousSource + unzigzag(sourceDelta));
+        instr.targetAddr = (flag & HAS_TARGET_BIT) ? static_cast<int>(instr.sourceAddr + unzigzag(targetDelta)) : 0;
+        instr.direction = DIRECTION_CODES[(flag >> 4) & 3];
+        instr.taken = (flag & TAKEN_BIT) != 0;
+        previousSource = instr.sourceAddr;
+    }
+
+    offset += 8 + static_cast<size_t>(payloadBytes);
+    file->release(offset); // Decoded blocks are not needed again
+    return true;
+}
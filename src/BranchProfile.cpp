@@ -0,0 +1,113 @@
+/*
+* Per-branch hot-spot profile. The driver feeds every simulated branch through record() when a
+* profile is enabled, and every BTB eviction through recordEviction(), so mispredictions, BTB
+* misses and conflicts can be pinned on individual source addresses.
+*
+*/
+#include "../include/BranchProfile.h"
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+double percent(uint64_t part, uint64_t total) {
+    return total > 0 ? (double)part / total * 100.0 : 0.0;
+}
+
+}
+
+BranchProfile::BranchProfile(size_t expectedBranches) : mask(0) {
+    uint32_t size = 16;
+    while (size < expectedBranches * 2) {
+        size <<= 1;
+    }
+    keys.assign(size, 0);
+    slots.assign(size, BRANCH_PROFILE_EMPTY);
+    mask = size - 1;
+    records.reserve(expectedBranches);
+}
+
+void BranchProfile::grow() {
+    uint32_t size = static_cast<uint32_t>(slots.size()) * 2;
+    keys.assign(size, 0);
+    slots.assign(size, BRANCH_PROFILE_EMPTY);
+    mask = size - 1;
+    for (uint32_t index = 0; index < records.size(); index++) {
+        uint32_t i = hash(records[index].sourceAddr) & mask;
+        while (slots[i] != BRANCH_PROFILE_EMPTY) {
+            i = (i + 1) & mask;
+        }
+        keys[i] = records[index].sourceAddr;
+        slots[i] = index;
+    }
+}
+
+std::vector<BranchRecord> BranchProfile::top(size_t n) const {
+    std::vector<BranchRecord> sorted = records;
+    auto costlier = [](const BranchRecord& a, const BranchRecord& b) {
+        if (a.redirects != b.redirects) {
+            return a.redirects > b.redirects;
+        }
+        return a.executions > b.executions;
+    };
+    n = std::min(n, sorted.size());
+    std::partial_sort(sorted.begin(), sorted.begin() + n, sorted.end(), costlier);
+    sorted.resize(n);
+    return sorted;
+}
+
+void BranchProfile::printReport(std::ostream& out, size_t n) const {
+    uint64_t totalRedirects = 0;
+    for (const BranchRecord& branch : records) {
+        totalRedirects += branch.redirects;
+    }
+    std::vector<BranchRecord> hottest = top(n);
+
+    std::ostringstream report;
+    report << "Top " << hottest.size() << " of " << records.size()
+           << " branches by fetch redirects (wrong direction, or taken without a BTB entry):" << std::endl;
+    report << std::left << std::setw(12) << "pc" << std::right << std::setw(12) << "executions" << std::setw(8) << "taken%"
+           << std::setw(13) << "mispredicts" << std::setw(13) << "mispredict%" << std::setw(12) << "btb_misses"
+           << std::setw(22) << "hit_but_mispredicted" << std::setw(9) << "evicted" << std::setw(11) << "redirects"
+           << std::setw(8) << "share%" << std::setw(13) << "cumulative%" << std::endl;
+
+    uint64_t cumulative = 0;
+    report << std::fixed << std::setprecision(2);
+    for (const BranchRecord& branch : hottest) {
+        cumulative += branch.redirects;
+        std::ostringstream pc;
+        pc << "0x" << std::hex << std::setw(8) << std::setfill('0') << static_cast<uint32_t>(branch.sourceAddr);
+        report << std::left << std::setw(12) << pc.str() << std::right << std::setw(12) << branch.executions
+               << std::setw(8) << percent(branch.taken, branch.executions) << std::setw(13) << branch.mispredicts
+               << std::setw(13) << percent(branch.mispredicts, branch.executions) << std::setw(12) << branch.btbMisses
+               << std::setw(22) << branch.hitButMispredicted << std::setw(9) << branch.evicted
+               << std::setw(11) << branch.redirects << std::setw(8) << percent(branch.redirects, totalRedirects)
+               << std::setw(13) << percent(cumulative, totalRedirects) << std::endl;
+    }
+    out << report.str();
+}
+
+bool extractProfileOption(int& argc, char* argv[], size_t& top) {
+    int kept = 0;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--profile") != 0) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        char* end = nullptr;
+        long value = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+        if (i + 1 >= argc || *end != '\0' || value <= 0) {
+            std::cerr << "Error: --profile needs the number of branches to report" << std::endl;
+            return false;
+        }
+        top = static_cast<size_t>(value);
+        i++;
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return true;
+}
@@ -1,87 +1,506 @@
 /*
-* The cache model we use which utilises a doubly linked list to keep track of LRU / MRU with Head / Tail
-* We use an array to keep track of data in cache
-*
+* The cache model for the BTB. Entries live in flat arrays indexed by slot (set * ways + way),
+* taken from the caller's arena, so there is no per-entry heap node, constructing a BTB makes no
+* allocation of its own and a lookup only ever scans the ways of one set.
+* Direct-mapped and N-way set-associative BTBs hash the source address to a set.
+* A fully associative BTB is a single set with an open-addressing hash index from tag to slot,
+* which keeps lookups O(1) however large the BTB is. Sets of VECTOR_SEARCH_MIN_WAYS or more ways
+* are searched with the SIMD compare from TagSearch.h, narrower ones with an inline loop.
+* Replacement is LRU (linked list of slot indices per set), tree PLRU or random.
 *
 */
 #include "../include/BranchTargetBuffer.h"
+#include "../include/Checkpoint.h"
+#include "../include/Prefetch.h"
+#include <cstdlib>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+
+namespace {
 
-BTBEntry::BTBEntry(int src, int tgt) :
-    sourceAddr_tag(src), targetAddr_data(tgt), prev(nullptr), next(nullptr) {}
+// Below this the inline loop beats the call into the vector search
+const int VECTOR_SEARCH_MIN_WAYS = 8;
 
+int roundUpToPowerOfTwo(int value) {
+    int result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
 
-BranchTargetBuffer::BranchTargetBuffer(int cap) : capacity(cap) {
-    // Setting head and tail values
-    head = new BTBEntry(-1, -1);
-    tail = new BTBEntry(-1, -1);
-    head -> next = tail; // We use a wrap-around structure to move to the head
-    tail -> prev = head;
+// One level of a BTB spec, "entries[:associativity[:policy[:field...]]]". Only the last level
+// may size the side predictors or set the hierarchy and timing fields, any level its latency.
+bool parseLevelSpec(const std::string& spec, bool last, BTBConfig& parsed, bool& hasLatency) {
+    size_t first = spec.find(':');
+    size_t second = first == std::string::npos ? std::string::npos : spec.find(':', first + 1);
+    try {
+        size_t used = 0;
+        std::string entries = spec.substr(0, first);
+        parsed.entries = std::stoi(entries, &used);
+        if (used != entries.size() || parsed.entries < 0) {
+            return false;
+        }
+        if (first != std::string::npos) {
+            std::string ways = spec.substr(first + 1, second == std::string::npos ? std::string::npos : second - first - 1);
+            parsed.associativity = std::stoi(ways, &used);
+            if (used != ways.size() || parsed.associativity < 0) {
+                return false;
+            }
+        }
+    } catch (const std::exception&) {
+        return false;
+    }
+    if (second == std::string::npos) {
+        return true;
+    }
 
-    // Creating cache array
-    entries = new BTBEntry*[capacity];
-    for (int i = 0; i < capacity; i++){
-        entries[i] = new BTBEntry(-1, -1);
-        addToFront(entries[i]);
+    // The policy, then optional fields: "ras<depth>", "ind<entries>", "lat<cycles>"...
+    size_t next = spec.find(':', second + 1);
+    if (!parseReplacementPolicy(spec.substr(second + 1, next == std::string::npos ? std::string::npos : next - second - 1), parsed.policy)) {
+        return false;
+    }
+    while (next != std::string::npos) {
+        size_t begin = next + 1;
+        next = spec.find(':', begin);
+        std::string field = spec.substr(begin, next == std::string::npos ? std::string::npos : next - begin);
+        if (last && (field == "fill-last" || field == "promote-next" || field == "promote-none")) {
+            if (field == "fill-last") {
+                parsed.fill = BTBFillPolicy::LAST;
+            } else {
+                parsed.promotion = field == "promote-next" ? BTBPromotion::NEXT : BTBPromotion::NONE;
+            }
+            continue;
+        }
+        // A name and a number, latencies may be 0 and everything else must be positive
+        size_t digits = field.find_first_of("0123456789");
+        std::string name = field.substr(0, digits);
+        char* end = nullptr;
+        long value = digits != std::string::npos && digits > 0 ? std::strtol(field.c_str() + digits, &end, 10) : -1;
+        if (value < 0 || *end != '\0' || (value == 0 && name != "lat")) {
+            return false;
+        }
+        int* target = nullptr;
+        if (name == "lat") {
+            target = &parsed.latency;
+            hasLatency = true;
+        } else if (last && name == "ras") {
+            target = &parsed.rasDepth;
+        } else if (last && name == "ind") {
+            target = &parsed.indirectEntries;
+        } else if (last && name == "redirect") {
+            target = &parsed.timing.redirectPenalty;
+        } else if (last && name == "flush") {
+            target = &parsed.timing.flushPenalty;
+        } else if (last && name == "ipb") {
+            target = &parsed.timing.instructionsPerBranch;
+        } else if (last && name == "width") {
+            target = &parsed.timing.fetchWidth;
+        } else {
+            return false;
+        }
+        *target = static_cast<int>(value);
     }
+    return true;
 }
 
-BranchTargetBuffer::~BranchTargetBuffer() {
-    for (int i = 0; i < capacity; i++) {
-        delete entries[i];
+}
+
+const char* replacementPolicyName(ReplacementPolicy policy) {
+    switch (policy) {
+        case ReplacementPolicy::LRU: return "lru";
+        case ReplacementPolicy::PLRU: return "plru";
+        case ReplacementPolicy::RANDOM: return "random";
     }
-    delete[] entries;
-    delete head;
-    delete tail;
-};
+    return "unknown";
+}
 
+bool parseReplacementPolicy(const std::string& name, ReplacementPolicy& policy) {
+    if (name == "lru") {
+        policy = ReplacementPolicy::LRU;
+    } else if (name == "plru") {
+        policy = ReplacementPolicy::PLRU;
+    } else if (name == "random") {
+        policy = ReplacementPolicy::RANDOM;
+    } else {
+        return false;
+    }
+    return true;
+}
 
+const char* fillPolicyName(BTBFillPolicy fill) {
+    return fill == BTBFillPolicy::LAST ? "last" : "all";
+}
 
-void BranchTargetBuffer::addToFront(BTBEntry *entry) const {
-    entry -> next = head -> next;
-    entry -> prev = head;
-    head  -> next -> prev = entry;
-    head -> next = entry;
+const char* promotionName(BTBPromotion promotion) {
+    switch (promotion) {
+        case BTBPromotion::ALL: return "all";
+        case BTBPromotion::NEXT: return "next";
+        case BTBPromotion::NONE: return "none";
+    }
+    return "unknown";
 }
 
-void BranchTargetBuffer::removeNode(const BTBEntry *entry) {
-   entry -> prev -> next = entry -> next;
-   entry -> next -> prev = entry -> prev;
+bool parseBTBConfig(const std::string& spec, BTBConfig& config) {
+    // Every level but the last becomes one of the faster levels, in order
+    std::vector<std::string> levels;
+    size_t begin = 0;
+    for (size_t plus = spec.find('+'); ; plus = spec.find('+', begin)) {
+        levels.push_back(spec.substr(begin, plus == std::string::npos ? std::string::npos : plus - begin));
+        if (plus == std::string::npos) {
+            break;
+        }
+        begin = plus + 1;
+    }
+    if ((int)levels.size() > BTB_MAX_LEVELS) {
+        return false;
+    }
+
+    BTBConfig parsed;
+    for (size_t i = 0; i + 1 < levels.size(); i++) {
+        BTBConfig level;
+        bool hasLatency = false;
+        if (!parseLevelSpec(levels[i], false, level, hasLatency) || level.entries == 0) {
+            return false;
+        }
+        parsed.fasterLevels.push_back(BTBLevelConfig{level.entries, level.associativity, level.policy,
+                                                     hasLatency ? level.latency : static_cast<int>(i)});
+    }
+    bool hasLatency = false;
+    if (!parseLevelSpec(levels.back(), true, parsed, hasLatency)) {
+        return false;
+    }
+    if (!hasLatency) {
+        parsed.latency = static_cast<int>(parsed.fasterLevels.size());
+    }
+    config = parsed;
+    return true;
 }
 
-void BranchTargetBuffer::moveToFront(BTBEntry *entry) const {
-    removeNode(entry);
-    addToFront(entry);
+BranchTargetBuffer::BranchTargetBuffer(const BTBConfig& config, Arena& arena)
+    : capacity(config.entries > 0 ? config.entries : 0), ways(0), numSets(0), policy(config.policy),
+      fullyAssociative(false), plruLeaves(1), randomState(0x2545F491u),
+      tagSearch(nullptr), allocations(0), evictions(0) {
+    if (capacity == 0) {
+        return; // No BTB, every lookup misses
+    }
+
+    if (config.associativity <= 0 || config.associativity >= capacity) {
+        ways = capacity;
+        fullyAssociative = true;
+    } else {
+        ways = config.associativity;
+        if (capacity % ways != 0) {
+            std::cerr << "Warning: BTB size " << capacity << " is not a multiple of "
+                      << ways << " ways, using " << capacity - capacity % ways << " entries." << std::endl;
+            capacity -= capacity % ways;
+        }
+    }
+    numSets = capacity / ways;
+
+    tags = ArenaArray<int>(arena, capacity, -1);
+    targets = ArenaArray<int>(arena, capacity, -1);
+    fillCount = ArenaArray<int>(arena, numSets, 0);
+
+    switch (policy) {
+        case ReplacementPolicy::LRU:
+            lruPrev = ArenaArray<int>(arena, capacity, -1);
+            lruNext = ArenaArray<int>(arena, capacity, -1);
+            mruSlot = ArenaArray<int>(arena, numSets, -1);
+            lruSlot = ArenaArray<int>(arena, numSets, -1);
+            break;
+        case ReplacementPolicy::PLRU:
+            plruLeaves = roundUpToPowerOfTwo(ways);
+            plruBits = ArenaArray<uint8_t>(arena, static_cast<size_t>(numSets) * (plruLeaves - 1), 0);
+            break;
+        case ReplacementPolicy::RANDOM:
+            break;
+    }
+
+    if (fullyAssociative) {
+        index = AddressIndex(capacity, arena);
+    } else if (ways >= VECTOR_SEARCH_MIN_WAYS && bestTagSearch() != findTagScalar) {
+        tagSearch = bestTagSearch();
+    }
 }
 
-int BranchTargetBuffer::getTargetAddress(int sourceAddr) const {
-    for (int i = 0; i < capacity; i++){
-        if (entries[i] -> sourceAddr_tag == sourceAddr) {
-            moveToFront(entries[i]); // Make it MRU
-            return entries[i] -> targetAddr_data;
+int BranchTargetBuffer::setIndex(int sourceAddr) const {
+    if (fullyAssociative) {
+        return 0;
+    }
+    // Multiply-shift range reduction, works for any number of sets without a division
+    uint32_t h = static_cast<uint32_t>(sourceAddr) * 0x9E3779B1u;
+    return static_cast<int>((static_cast<uint64_t>(h) * static_cast<uint32_t>(numSets)) >> 32);
+}
+
+int BranchTargetBuffer::findSlot(int set, int sourceAddr) const {
+    if (fullyAssociative) {
+        return index.find(sourceAddr);
+    }
+    int base = set * ways;
+    if (tagSearch != nullptr) {
+        int way = tagSearch(&tags[base], fillCount[set], sourceAddr);
+        return way != -1 ? base + way : -1;
+    }
+    int end = base + fillCount[set];
+    for (int slot = base; slot < end; slot++) {
+        if (tags[slot] == sourceAddr) {
+            return slot;
         }
     }
-    return -1; // Cache miss
+    return -1;
 }
 
-void BranchTargetBuffer::insert(int sourceAddr, int targetAddr) const {
-    // Check if already in cache before inserting
-    for (int i = 0; i < capacity; i++){
-        if (entries[i] -> sourceAddr_tag == sourceAddr){
-            moveToFront(entries[i]);
-            return;
+void BranchTargetBuffer::addToFront(int set, int slot) {
+    lruPrev[slot] = -1;
+    lruNext[slot] = mruSlot[set];
+    if (mruSlot[set] != -1) {
+        lruPrev[mruSlot[set]] = slot;
+    } else {
+        lruSlot[set] = slot;
+    }
+    mruSlot[set] = slot;
+}
+
+void BranchTargetBuffer::removeNode(int set, int slot) {
+    int prev = lruPrev[slot];
+    int next = lruNext[slot];
+    if (prev != -1) {
+        lruNext[prev] = next;
+    } else {
+        mruSlot[set] = next;
+    }
+    if (next != -1) {
+        lruPrev[next] = prev;
+    } else {
+        lruSlot[set] = prev;
+    }
+}
+
+void BranchTargetBuffer::touch(int set, int slot) {
+    switch (policy) {
+        case ReplacementPolicy::LRU:
+            if (mruSlot[set] != slot) { // Make it MRU
+                removeNode(set, slot);
+                addToFront(set, slot);
+            }
+            break;
+        case ReplacementPolicy::PLRU: {
+            // Point every node on the path away from this way
+            uint8_t* bits = &plruBits[static_cast<size_t>(set) * (plruLeaves - 1)];
+            int way = slot - set * ways;
+            int node = 0;
+            int low = 0;
+            for (int size = plruLeaves; size > 1; size /= 2) {
+                int half = size / 2;
+                if (way < low + half) {
+                    bits[node] = 1;
+                    node = 2 * node + 1;
+                } else {
+                    bits[node] = 0;
+                    node = 2 * node + 2;
+                    low += half;
+                }
+            }
+            break;
+        }
+        case ReplacementPolicy::RANDOM:
+            break;
+    }
+}
+
+int BranchTargetBuffer::chooseVictim(int set) {
+    int base = set * ways;
+
+    // Use empty ways first, in order
+    if (fillCount[set] < ways) {
+        int slot = base + fillCount[set]++;
+        if (policy == ReplacementPolicy::LRU) {
+            addToFront(set, slot);
+        }
+        return slot;
+    }
+
+    switch (policy) {
+        case ReplacementPolicy::LRU:
+            return lruSlot[set];
+        case ReplacementPolicy::PLRU: {
+            // Follow the bits, never stepping into the padding leaves past the last way
+            const uint8_t* bits = &plruBits[static_cast<size_t>(set) * (plruLeaves - 1)];
+            int node = 0;
+            int low = 0;
+            for (int size = plruLeaves; size > 1; size /= 2) {
+                int half = size / 2;
+                if (bits[node] && low + half < ways) {
+                    node = 2 * node + 2;
+                    low += half;
+                } else {
+                    node = 2 * node + 1;
+                }
+            }
+            return base + low;
+        }
+        case ReplacementPolicy::RANDOM: {
+            randomState ^= randomState << 13;
+            randomState ^= randomState >> 17;
+            randomState ^= randomState << 5;
+            return base + static_cast<int>((static_cast<uint64_t>(randomState) * static_cast<uint32_t>(ways)) >> 32);
         }
     }
+    return base;
+}
+
+int BranchTargetBuffer::getTargetAddress(int sourceAddr) {
+    return getTarget(lookup(sourceAddr));
+}
+
+int BranchTargetBuffer::insert(int sourceAddr, int targetAddr) {
+    if (numSets == 0) {
+        return -1;
+    }
+
+    // Check if already in cache before inserting
+    int set = setIndex(sourceAddr);
+    int slot = findSlot(set, sourceAddr);
+    if (slot != -1) {
+        targets[slot] = targetAddr;
+        touch(set, slot);
+        return -1;
+    }
+    return allocate(set, sourceAddr, targetAddr);
+}
+
+BTBSlot BranchTargetBuffer::lookup(int sourceAddr) {
+    if (numSets == 0) {
+        return BTBSlot{-1, -1};
+    }
+    int set = setIndex(sourceAddr);
+    int slot = findSlot(set, sourceAddr);
+    if (slot != -1) {
+        touch(set, slot);
+    }
+    return BTBSlot{set, slot};
+}
 
-    // evict tail -> prev and move new node to beginning of list
-    BTBEntry* lru_node = tail -> prev;
-    lru_node -> sourceAddr_tag = sourceAddr;
-    lru_node -> targetAddr_data = targetAddr;
-    moveToFront(lru_node);
+void BranchTargetBuffer::prefetch(int sourceAddr) const {
+    if (numSets == 0) {
+        return;
+    }
+    if (fullyAssociative) {
+        index.prefetch(sourceAddr);
+        return;
+    }
+    int base = setIndex(sourceAddr) * ways;
+    prefetchRead(&tags[base]);
+    prefetchRead(&targets[base]);
+}
 
+int BranchTargetBuffer::update(const BTBSlot& entry, int sourceAddr, int targetAddr) {
+    if (entry.slot != -1) {
+        targets[entry.slot] = targetAddr; // Already promoted by the lookup
+        return -1;
+    }
+    return entry.set != -1 ? allocate(entry.set, sourceAddr, targetAddr) : -1;
 }
 
+int BranchTargetBuffer::allocate(int set, int sourceAddr, int targetAddr) {
+    // Evict the victim way and reuse its slot for the new branch
+    bool evicting = fillCount[set] == ways;
+    allocations++;
+    evictions += evicting;
+    int slot = chooseVictim(set);
+    int evicted = evicting ? tags[slot] : -1;
+    if (fullyAssociative) {
+        if (evicting) {
+            index.erase(evicted);
+        }
+        index.set(sourceAddr, slot);
+    }
+    tags[slot] = sourceAddr;
+    targets[slot] = targetAddr;
+    touch(set, slot);
+    return evicted;
+}
 
+void BranchTargetBuffer::registerStats(StatsRegistry& stats, const std::string& prefix) const {
+    stats.counter(prefix + ".allocations", allocations);
+    stats.counter(prefix + ".evictions", evictions);
+}
 
+void BranchTargetBuffer::resetStatistics() {
+    allocations = 0;
+    evictions = 0;
+}
 
+void BranchTargetBuffer::saveState(CheckpointWriter& out) const {
+    out.put<int32_t>(capacity);
+    out.put<int32_t>(ways);
+    out.put(policy);
+    out.putVector(tags);
+    out.putVector(targets);
+    out.putVector(fillCount);
+    out.putVector(lruPrev);
+    out.putVector(lruNext);
+    out.putVector(mruSlot);
+    out.putVector(lruSlot);
+    out.putVector(plruBits);
+    out.put(randomState);
+}
 
+bool BranchTargetBuffer::loadState(CheckpointReader& in) {
+    ReplacementPolicy stored = policy;
+    if (!in.expect<int32_t>(capacity, "BTB size") || !in.expect<int32_t>(ways, "BTB associativity") || !in.get(stored)) {
+        return false;
+    }
+    if (stored != policy) {
+        in.fail(std::string("Checkpoint BTB replacement is ") + replacementPolicyName(stored) + ", this run has " +
+                replacementPolicyName(policy));
+        return false;
+    }
+    in.getVector(tags);
+    in.getVector(targets);
+    in.getVector(fillCount);
+    in.getVector(lruPrev);
+    in.getVector(lruNext);
+    in.getVector(mruSlot);
+    in.getVector(lruSlot);
+    in.getVector(plruBits);
+    in.get(randomState);
+    if (!in.ok()) {
+        return false;
+    }
 
+    // Lookups and replacement index the tables with these, so a corrupt snapshot must not get through
+    for (int set = 0; set < numSets; set++) {
+        int base = set * ways;
+        if (fillCount[set] < 0 || fillCount[set] > ways) {
+            in.fail("Checkpoint BTB set " + std::to_string(set) + " holds " + std::to_string(fillCount[set]) +
+                    " entries in its " + std::to_string(ways) + " ways");
+            return false;
+        }
+        if (policy != ReplacementPolicy::LRU) {
+            continue;
+        }
+        // Links point to a filled way of the same set, or are -1 at the ends of the recency list
+        auto filled = [&](int slot) { return slot >= base && slot < base + fillCount[set]; };
+        auto link = [&](int slot) { return slot == -1 || filled(slot); };
+        bool valid = fillCount[set] == 0 ? mruSlot[set] == -1 && lruSlot[set] == -1 : filled(mruSlot[set]) && filled(lruSlot[set]);
+        for (int slot = base; slot < base + ways && valid; slot++) {
+            valid = link(lruPrev[slot]) && link(lruNext[slot]);
+        }
+        if (!valid) {
+            in.fail("Checkpoint BTB set " + std::to_string(set) + " has a recency list outside the set");
+            return false;
+        }
+    }
+
+    // The hash index is derived state, rebuilt from the filled ways
+    if (fullyAssociative) {
+        index.clear();
+        for (int slot = 0; slot < fillCount[0]; slot++) {
+            index.set(tags[slot], slot);
+        }
+    }
+    return true;
+}
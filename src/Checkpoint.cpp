@@ -0,0 +1,116 @@
+/*
+* Snapshot files of the predictor state, in the format described in Checkpoint.h.
+* The writer builds the whole snapshot in memory and the reader loads the whole file, the
+* state of even a large BTB and TAGE is a few hundred KB. Components serialise themselves;
+* this file only handles the header and the file I/O.
+*
+*/
+#include "../include/Checkpoint.h"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+namespace {
+
+const char MAGIC[8] = {'B', 'P', 'C', 'K', 'P', 'T', '\0', '\0'};
+
+}
+
+CheckpointWriter::CheckpointWriter(const std::string& predictorName, uint64_t traceOffset)
+    : data(MAGIC, MAGIC + sizeof(MAGIC)) {
+    put<uint16_t>(CHECKPOINT_VERSION);
+    put<uint16_t>(0);
+    put<uint32_t>(0);
+    put<uint64_t>(traceOffset);
+    put<uint32_t>(static_cast<uint32_t>(predictorName.size()));
+    data.insert(data.end(), predictorName.begin(), predictorName.end());
+}
+
+bool CheckpointWriter::writeFile(const std::string& filename) const {
+    std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    out.close();
+    if (!out) {
+        std::cerr << "Error: Unable to write checkpoint " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+CheckpointReader::CheckpointReader(const std::string& filename)
+    : position(0), failed(false), traceOffset(0) {
+    std::ifstream in(filename, std::ios::binary);
+    if (!in) {
+        fail("Unable to open checkpoint " + filename);
+        return;
+    }
+    data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    if (data.size() < sizeof(MAGIC) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0) {
+        fail(filename + " is not a checkpoint");
+        return;
+    }
+    position = sizeof(MAGIC);
+    uint16_t version = 0;
+    uint16_t reserved16 = 0;
+    uint32_t reserved32 = 0;
+    uint32_t nameLength = 0;
+    if (get(version) && version != CHECKPOINT_VERSION) {
+        fail("Checkpoint version " + std::to_string(version) + " is not supported");
+    }
+    get(reserved16);
+    get(reserved32);
+    get(traceOffset);
+    get(nameLength);
+    if (!failed && data.size() - position < nameLength) {
+        fail("Checkpoint " + filename + " is truncated");
+    }
+    if (failed) {
+        return;
+    }
+    predictorName.assign(reinterpret_cast<const char*>(data.data() + position), nameLength);
+    position += nameLength;
+}
+
+void CheckpointReader::fail(const std::string& message) {
+    if (!failed) {
+        std::cerr << "Error: " << message << std::endl;
+        failed = true;
+    }
+}
+
+bool CheckpointReader::finish() {
+    if (!failed && position != data.size()) {
+        fail("Checkpoint has " + std::to_string(data.size() - position) + " bytes of unexpected data");
+    }
+    return !failed;
+}
+
+bool extractCheckpointOptions(int& argc, char* argv[], CheckpointOptions& options) {
+    int kept = 0;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--checkpoint") == 0) {
+            char* end = nullptr;
+            unsigned long long value = i + 2 < argc ? std::strtoull(argv[i + 1], &end, 10) : 0;
+            if (i + 2 >= argc || *end != '\0' || value == 0) {
+                std::cerr << "Error: --checkpoint needs an instruction count and a file name" << std::endl;
+                return false;
+            }
+            options.saveAt = value;
+            options.saveFile = argv[i + 2];
+            i += 2;
+        } else if (std::strcmp(argv[i], "--restore") == 0) {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: --restore needs a checkpoint file" << std::endl;
+                return false;
+            }
+            options.restoreFile = argv[++i];
+        } else {
+            argv[kept++] = argv[i];
+        }
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return true;
+}
@@ -0,0 +1,155 @@
+/*
+* The command line of branch_sim and branch_sim_TwoBit. Options such as --stats-json or
+* --profile may appear anywhere and are taken out of argv first, so the modes and the single run
+* see only their positional arguments. Both binaries differ only in what a single run simulates.
+*
+*/
+#include "../include/CommandLine.h"
+#include "../include/BatchRunner.h"
+#include "../include/BranchProfile.h"
+#include "../include/IntervalStats.h"
+#include "../include/ParallelRunner.h"
+#include "../include/SamplingRunner.h"
+#include "../include/SweepRunner.h"
+#include "../include/TargetPredictor.h"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+bool isModeArgument(int argc, char* argv[]) {
+    return argc > 1 && std::string(argv[1]).compare(0, 2, "--") == 0;
+}
+
+void printUsage(char* argv[], bool predictorArgument) {
+    std::cerr << "Usage: " << argv[0] << " <trace_file> <btb_size> [associativity] [lru|plru|random]"
+              << (predictorArgument ? " [predictor]" : "") << std::endl;
+    std::cerr << "       " << argv[0] << " --sweep <trace_file> <btb_spec>[,<btb_spec>...] [predictor[,predictor...]]" << std::endl;
+    std::cerr << "       " << argv[0] << " --batch <manifest> [threads]" << std::endl;
+    std::cerr << "       " << argv[0] << " --parallel <trace_file> <btb_spec> <predictor_spec> [chunks [warmup [threads]]] [--no-exact]" << std::endl;
+    std::cerr << "       " << argv[0] << " --sample <trace_file> <btb_spec> <predictor_spec> [sampling_spec [none|btb|full]] [--no-exact]" << std::endl;
+    std::cerr << "       any mode but --sample also takes [--stats-json <file>] [--stats-csv <file>]" << std::endl;
+    std::cerr << "       single runs also take [--profile <N>] for the N branches causing the most redirects" << std::endl;
+    std::cerr << "       and [--intervals <N> <file>] for per-window statistics (CSV if <file> ends in .csv, else binary)" << std::endl;
+    std::cerr << "       and [--ras <depth>] [--indirect <entries>] for return and indirect target predictors" << std::endl;
+    std::cerr << "       and [--checkpoint <N> <file>] [--restore <file>] to save the state after N instructions and" << std::endl;
+    std::cerr << "       stop, or to resume from a saved state" << std::endl;
+    if (predictorArgument) {
+        std::cerr << predictorUsage() << std::endl;
+    }
+}
+
+} // namespace
+
+bool parseCountArgument(int argc, char* argv[], int i, const char* name, long minimum, long maximum, long& value) {
+    if (i >= argc) {
+        return true;
+    }
+    char* end = nullptr;
+    errno = 0;
+    long parsed = std::strtol(argv[i], &end, 10);
+    if (end == argv[i] || *end != '\0' || errno == ERANGE || parsed < minimum || parsed > maximum) {
+        std::cerr << "Error: Invalid " << name << " " << argv[i] << ", expected a number ";
+        if (maximum == LONG_MAX) {
+            std::cerr << "of at least " << minimum << std::endl;
+        } else {
+            std::cerr << "from " << minimum << " to " << maximum << std::endl;
+        }
+        return false;
+    }
+    value = parsed;
+    return true;
+}
+
+bool dispatchCommandLine(int& argc, char* argv[], bool predictorArgument, SingleRun& run, int& status) {
+    status = 1;
+    // --stats-json/--stats-csv may appear anywhere, every mode writes its counters there
+    if (!extractStatsOutput(argc, argv, run.statsOutput)) {
+        return false;
+    }
+    // --profile <N> reports the N costliest branches of a single run
+    if (!extractProfileOption(argc, argv, run.options.profileTop)) {
+        return false;
+    }
+    if (run.options.profileTop > 0 && isModeArgument(argc, argv)) {
+        std::cerr << "Error: --profile only applies to a single run" << std::endl;
+        return false;
+    }
+    // --intervals <N> <file> streams the statistics of every N-instruction window of a single run
+    if (!extractIntervalOption(argc, argv, run.options.intervalLength, run.options.intervalFile)) {
+        return false;
+    }
+    if (run.options.intervalLength > 0 && isModeArgument(argc, argv)) {
+        std::cerr << "Error: --intervals only applies to a single run" << std::endl;
+        return false;
+    }
+    // --ras <depth> and --indirect <entries> add return and indirect target predictors to a
+    // single run, the other modes take them as ":ras<depth>:ind<entries>" in the BTB spec
+    BTBConfig targetOptions;
+    if (!extractTargetOptions(argc, argv, targetOptions)) {
+        return false;
+    }
+    if ((targetOptions.rasDepth > 0 || targetOptions.indirectEntries > 0) && isModeArgument(argc, argv)) {
+        std::cerr << "Error: --ras and --indirect only apply to a single run, use the BTB spec instead" << std::endl;
+        return false;
+    }
+    // --checkpoint <N> <file> saves the predictor state after N instructions of a single run and
+    // stops, --restore <file> resumes from such a snapshot instead of replaying the trace prefix
+    if (!extractCheckpointOptions(argc, argv, run.options.checkpoint)) {
+        return false;
+    }
+    if (run.options.checkpoint.requested() && isModeArgument(argc, argv)) {
+        std::cerr << "Error: --checkpoint and --restore only apply to a single run" << std::endl;
+        return false;
+    }
+
+    // Sweep mode runs many BTB configurations over one parse of the trace
+    if (argc > 1 && std::string(argv[1]) == "--sweep") {
+        status = runSweepCommand(argc, argv, run.statsOutput);
+        return false;
+    }
+    // Batch mode runs a manifest of trace/BTB/predictor jobs on every core
+    if (argc > 1 && std::string(argv[1]) == "--batch") {
+        status = runBatchCommand(argc, argv, run.statsOutput);
+        return false;
+    }
+    // Parallel mode splits one long trace into chunks simulated concurrently
+    if (argc > 1 && std::string(argv[1]) == "--parallel") {
+        status = runParallelCommand(argc, argv, run.statsOutput);
+        return false;
+    }
+    // Sample mode measures short units of one trace and estimates the full-trace rates
+    if (argc > 1 && std::string(argv[1]) == "--sample") {
+        if (run.statsOutput.requested()) {
+            std::cerr << "Error: --sample reports estimates, not counters, and has no --stats-json/--stats-csv output" << std::endl;
+            return false;
+        }
+        status = runSampleCommand(argc, argv);
+        return false;
+    }
+
+    if (argc < 3) {
+        printUsage(argv, predictorArgument);
+        return false;
+    }
+
+    run.traceFile = argv[1];
+    long entries = 0;
+    long associativity = 0; // 0 = fully associative
+    if (!parseCountArgument(argc, argv, 2, "BTB size", 0, INT_MAX, entries) ||
+        !parseCountArgument(argc, argv, 3, "associativity", 0, INT_MAX, associativity)) {
+        return false;
+    }
+    run.btb.entries = static_cast<int>(entries);
+    run.btb.associativity = static_cast<int>(associativity);
+    if (argc > 4 && !parseReplacementPolicy(argv[4], run.btb.policy)) {
+        std::cerr << "Error: Unknown replacement policy " << argv[4] << std::endl;
+        return false;
+    }
+    run.btb.rasDepth = targetOptions.rasDepth;
+    run.btb.indirectEntries = targetOptions.indirectEntries;
+    status = 0;
+    return true;
+}
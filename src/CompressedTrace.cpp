@@ -0,0 +1,494 @@
+/*
+* Compressed trace input: the format is recognised from its magic bytes and decompressed as the
+* reader asks for more text. BGZF gzip and multi-frame zstd files are a sequence of independent
+* blocks whose compressed and decompressed sizes are known from their headers, so the blocks are
+* listed up front and decompressed on worker threads into a ring of slots a few blocks ahead of
+* the reader, which takes them back in file order. Everything else goes through the library's
+* streaming decoder on the reader's own thread.
+*
+*/
+
+#include "../include/CompressedTrace.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#ifdef BRANCHSIM_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef BRANCHSIM_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef BRANCHSIM_HAVE_LZ4
+#include <lz4frame.h>
+#endif
+
+namespace {
+
+// Output handed to the reader per readBlock by the streaming decoders
+const size_t STREAM_BLOCK_SIZE = 1 << 20;
+
+// Compressed input fed to a streaming decoder per call; zlib counts in 32 bits
+const size_t STREAM_INPUT_CHUNK = 1 << 24;
+
+// Decoded jobs a parallel decompressor keeps in flight per worker
+const size_t BLOCKS_PER_WORKER = 2;
+
+inline uint16_t readLE16(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint16_t>(b[0] | (b[1] << 8));
+}
+
+inline uint32_t readLE32(const char* p) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(p);
+    return static_cast<uint32_t>(b[0]) | (static_cast<uint32_t>(b[1]) << 8) | (static_cast<uint32_t>(b[2]) << 16) |
+           (static_cast<uint32_t>(b[3]) << 24);
+}
+
+// One independently compressed block of a block-framed file
+struct CompressedBlock {
+    size_t offset;
+    size_t size;
+    size_t decompressedSize;
+};
+
+// Decode one whole block into exactly outSize bytes, thread-safe
+using BlockDecoder = bool (*)(const char* in, size_t inSize, char* out, size_t outSize);
+
+class ParallelBlockDecompressor : public TraceDecompressor {
+private:
+    std::unique_ptr<MappedFile> file;
+    std::vector<CompressedBlock> blocks;
+    std::vector<size_t> jobs; // First block of each job, then blocks.size()
+    BlockDecoder decode;
+    std::vector<std::vector<char>> slots; // Job i decodes into slot i % slots.size()
+    std::vector<char> ready; // Per slot: 0 pending, 1 decoded, 2 failed
+    size_t nextToDecode; // Jobs
+    size_t nextToRead;
+    bool stopping;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::vector<std::thread> workers;
+
+    size_t jobCount() const { return jobs.size() - 1; }
+
+    // Decode the blocks of a job one after another into out, resized to fit
+    bool decodeJob(size_t job, std::vector<char>& out, size_t at) const {
+        size_t size = 0;
+        for (size_t b = jobs[job]; b < jobs[job + 1]; b++) {
+            size += blocks[b].decompressedSize;
+        }
+        out.resize(at + size);
+        for (size_t b = jobs[job]; b < jobs[job + 1]; b++) {
+            const CompressedBlock& block = blocks[b];
+            if (!decode(file->data() + block.offset, block.size, out.data() + at, block.decompressedSize)) {
+                return false;
+            }
+            at += block.decompressedSize;
+        }
+        return true;
+    }
+
+    void work() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            // A slot is free once the reader has taken the job that used it before
+            changed.wait(lock, [this] {
+                return stopping || nextToDecode == jobCount() || nextToDecode < nextToRead + slots.size();
+            });
+            if (stopping || nextToDecode == jobCount()) {
+                return;
+            }
+            size_t job = nextToDecode++;
+            size_t slot = job % slots.size();
+            lock.unlock();
+
+            bool ok = decodeJob(job, slots[slot], 0);
+
+            lock.lock();
+            ready[slot] = ok ? 1 : 2;
+            changed.notify_all();
+        }
+    }
+
+public:
+    ParallelBlockDecompressor(std::unique_ptr<MappedFile> file, std::vector<CompressedBlock> blocks,
+                              BlockDecoder decode, int threads)
+        : file(std::move(file)), blocks(std::move(blocks)), decode(decode), nextToDecode(0), nextToRead(0),
+          stopping(false) {
+        // Small blocks (64 KiB in BGZF) are grouped so a hand-over moves about a stream block
+        size_t grouped = 0;
+        for (size_t b = 0; b < this->blocks.size(); b++) {
+            if (grouped == 0) {
+                jobs.push_back(b);
+            }
+            grouped += this->blocks[b].decompressedSize;
+            if (grouped >= STREAM_BLOCK_SIZE) {
+                grouped = 0;
+            }
+        }
+        jobs.push_back(this->blocks.size());
+
+        // Without a spare hardware thread, workers would only add hand-overs: decode inline
+        size_t workerCount = threads > 1 ? std::min(static_cast<size_t>(threads), jobCount()) : 0;
+        slots.resize(workerCount * BLOCKS_PER_WORKER);
+        ready.assign(slots.size(), 0);
+        for (size_t i = 0; i < workerCount; i++) {
+            workers.emplace_back(&ParallelBlockDecompressor::work, this);
+        }
+    }
+
+    ~ParallelBlockDecompressor() override {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool readBlock(std::vector<char>& out) override {
+        if (error || nextToRead == jobCount()) {
+            return false;
+        }
+        bool ok;
+        if (workers.empty()) {
+            ok = decodeJob(nextToRead, out, out.size());
+            file->release(blocks[jobs[nextToRead + 1] - 1].offset);
+        } else {
+            size_t slot = nextToRead % slots.size();
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                changed.wait(lock, [this, slot] { return ready[slot] != 0; });
+            }
+            ok = ready[slot] == 1;
+            if (ok) {
+                out.insert(out.end(), slots[slot].begin(), slots[slot].end());
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                ready[slot] = 0;
+            }
+        }
+        if (!ok) {
+            std::cerr << "Error: Corrupt compressed block at offset " << blocks[jobs[nextToRead]].offset << std::endl;
+            error = true;
+            return false;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            nextToRead++;
+        }
+        changed.notify_all();
+        return true;
+    }
+};
+
+#ifdef BRANCHSIM_HAVE_ZLIB
+
+// BGZF: every gzip member carries its own compressed size in a "BC" extra subfield
+bool listBgzfBlocks(const char* data, size_t size, std::vector<CompressedBlock>& blocks) {
+    size_t offset = 0;
+    while (offset < size) {
+        const char* p = data + offset;
+        size_t left = size - offset;
+        if (left < 18 || readLE32(p) != 0x04088B1Fu) { // Magic, deflate, FEXTRA set
+            return false;
+        }
+        size_t extraLength = readLE16(p + 10);
+        if (left < 12 + extraLength || extraLength < 6 || p[12] != 'B' || p[13] != 'C' || readLE16(p + 14) != 2) {
+            return false;
+        }
+        size_t memberSize = static_cast<size_t>(readLE16(p + 16)) + 1;
+        if (memberSize > left || memberSize < 12 + extraLength + 8) {
+            return false;
+        }
+        blocks.push_back({offset, memberSize, readLE32(p + memberSize - 4)});
+        offset += memberSize;
+    }
+    return true;
+}
+
+bool decodeGzipMember(const char* in, size_t inSize, char* out, size_t outSize) {
+    z_stream stream;
+    std::memset(&stream, 0, sizeof(stream));
+    if (inflateInit2(&stream, 15 + 16) != Z_OK) { // gzip wrapper, checks the CRC
+        return false;
+    }
+    unsigned char scratch = 0; // zlib wants a buffer even for an empty member
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+    stream.avail_in = static_cast<uInt>(inSize);
+    stream.next_out = outSize > 0 ? reinterpret_cast<Bytef*>(out) : &scratch;
+    stream.avail_out = static_cast<uInt>(outSize > 0 ? outSize : 1);
+    int result = inflate(&stream, Z_FINISH);
+    bool ok = result == Z_STREAM_END && stream.total_out == outSize;
+    inflateEnd(&stream);
+    return ok;
+}
+
+// Plain gzip, any number of concatenated members
+class GzipStreamDecompressor : public TraceDecompressor {
+private:
+    std::unique_ptr<MappedFile> file;
+    z_stream stream;
+    size_t consumed; // Compressed bytes handed to zlib
+    bool finished;
+
+public:
+    explicit GzipStreamDecompressor(std::unique_ptr<MappedFile> file)
+        : file(std::move(file)), consumed(0), finished(false) {
+        std::memset(&stream, 0, sizeof(stream));
+        if (inflateInit2(&stream, 15 + 32) != Z_OK) {
+            std::cerr << "Error: Unable to initialise zlib." << std::endl;
+            error = true;
+        }
+    }
+
+    ~GzipStreamDecompressor() override { inflateEnd(&stream); }
+
+    bool readBlock(std::vector<char>& out) override {
+        if (error || finished) {
+            return false;
+        }
+        size_t old = out.size();
+        out.resize(old + STREAM_BLOCK_SIZE);
+        stream.next_out = reinterpret_cast<Bytef*>(out.data() + old);
+        stream.avail_out = static_cast<uInt>(STREAM_BLOCK_SIZE);
+        while (stream.avail_out > 0) {
+            if (stream.avail_in == 0) {
+                file->release(consumed);
+                if (consumed == file->size()) {
+                    std::cerr << "Error: Truncated gzip trace." << std::endl;
+                    error = true;
+                    break;
+                }
+                size_t chunk = std::min(STREAM_INPUT_CHUNK, file->size() - consumed);
+                stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(file->data() + consumed));
+                stream.avail_in = static_cast<uInt>(chunk);
+                consumed += chunk;
+            }
+            int result = inflate(&stream, Z_NO_FLUSH);
+            if (result == Z_STREAM_END) {
+                if (stream.avail_in == 0 && consumed == file->size()) {
+                    finished = true;
+                    break;
+                }
+                inflateReset(&stream); // Another member follows
+            } else if (result != Z_OK && result != Z_BUF_ERROR) {
+                std::cerr << "Error: Corrupt gzip trace: " << (stream.msg ? stream.msg : "inflate failed")
+                          << std::endl;
+                error = true;
+                break;
+            }
+        }
+        size_t produced = STREAM_BLOCK_SIZE - stream.avail_out;
+        out.resize(old + produced);
+        return !error && (produced > 0 || !finished);
+    }
+};
+
+#endif
+
+#ifdef BRANCHSIM_HAVE_ZSTD
+
+// Frames that record their decompressed size; false if any does not, or the file is damaged
+bool listZstdFrames(const char* data, size_t size, std::vector<CompressedBlock>& blocks) {
+    size_t offset = 0;
+    while (offset < size) {
+        size_t frameSize = ZSTD_findFrameCompressedSize(data + offset, size - offset);
+        unsigned long long contentSize = ZSTD_getFrameContentSize(data + offset, size - offset);
+        if (ZSTD_isError(frameSize) || contentSize == ZSTD_CONTENTSIZE_UNKNOWN ||
+            contentSize == ZSTD_CONTENTSIZE_ERROR) {
+            return false;
+        }
+        blocks.push_back({offset, frameSize, static_cast<size_t>(contentSize)});
+        offset += frameSize;
+    }
+    return true;
+}
+
+bool decodeZstdFrame(const char* in, size_t inSize, char* out, size_t outSize) {
+    size_t result = ZSTD_decompress(out, outSize, in, inSize);
+    return !ZSTD_isError(result) && result == outSize;
+}
+
+class ZstdStreamDecompressor : public TraceDecompressor {
+private:
+    std::unique_ptr<MappedFile> file;
+    ZSTD_DStream* stream;
+    ZSTD_inBuffer input;
+    size_t lastResult; // 0 once a frame is complete
+
+public:
+    explicit ZstdStreamDecompressor(std::unique_ptr<MappedFile> file)
+        : file(std::move(file)), stream(ZSTD_createDStream()), lastResult(0) {
+        input = {this->file->data(), this->file->size(), 0};
+        if (stream == nullptr || ZSTD_isError(ZSTD_initDStream(stream))) {
+            std::cerr << "Error: Unable to initialise zstd." << std::endl;
+            error = true;
+        }
+    }
+
+    ~ZstdStreamDecompressor() override { ZSTD_freeDStream(stream); }
+
+    bool readBlock(std::vector<char>& out) override {
+        if (error || input.pos == input.size) {
+            if (!error && lastResult != 0) {
+                std::cerr << "Error: Truncated zstd trace." << std::endl;
+                error = true;
+            }
+            return false;
+        }
+        size_t old = out.size();
+        out.resize(old + STREAM_BLOCK_SIZE);
+        ZSTD_outBuffer output = {out.data() + old, STREAM_BLOCK_SIZE, 0};
+        while (output.pos < output.size && input.pos < input.size) {
+            lastResult = ZSTD_decompressStream(stream, &output, &input);
+            if (ZSTD_isError(lastResult)) {
+                std::cerr << "Error: Corrupt zstd trace: " << ZSTD_getErrorName(lastResult) << std::endl;
+                error = true;
+                break;
+            }
+        }
+        out.resize(old + output.pos);
+        file->release(input.pos);
+        return !error;
+    }
+};
+
+#endif
+
+#ifdef BRANCHSIM_HAVE_LZ4
+
+class Lz4StreamDecompressor : public TraceDecompressor {
+private:
+    std::unique_ptr<MappedFile> file;
+    LZ4F_dctx* context;
+    size_t consumed;
+    size_t lastResult; // 0 once a frame is complete
+
+public:
+    explicit Lz4StreamDecompressor(std::unique_ptr<MappedFile> file)
+        : file(std::move(file)), context(nullptr), consumed(0), lastResult(0) {
+        if (LZ4F_isError(LZ4F_createDecompressionContext(&context, LZ4F_VERSION))) {
+            std::cerr << "Error: Unable to initialise lz4." << std::endl;
+            context = nullptr;
+            error = true;
+        }
+    }
+
+    ~Lz4StreamDecompressor() override { LZ4F_freeDecompressionContext(context); }
+
+    bool readBlock(std::vector<char>& out) override {
+        if (error || consumed == file->size()) {
+            if (!error && lastResult != 0) {
+                std::cerr << "Error: Truncated lz4 trace." << std::endl;
+                error = true;
+            }
+            return false;
+        }
+        size_t old = out.size();
+        out.resize(old + STREAM_BLOCK_SIZE);
+        size_t produced = 0;
+        while (produced < STREAM_BLOCK_SIZE && consumed < file->size()) {
+            size_t outSize = STREAM_BLOCK_SIZE - produced;
+            size_t inSize = std::min(STREAM_INPUT_CHUNK, file->size() - consumed);
+            lastResult = LZ4F_decompress(context, out.data() + old + produced, &outSize, file->data() + consumed,
+                                         &inSize, nullptr);
+            if (LZ4F_isError(lastResult)) {
+                std::cerr << "Error: Corrupt lz4 trace: " << LZ4F_getErrorName(lastResult) << std::endl;
+                error = true;
+                break;
+            }
+            produced += outSize;
+            consumed += inSize;
+        }
+        out.resize(old + produced);
+        file->release(consumed);
+        return !error;
+    }
+};
+
+#endif
+
+}
+
+TraceCompression detectCompression(const char* data, size_t size) {
+    const unsigned char* b = reinterpret_cast<const unsigned char*>(data);
+    if (size >= 2 && b[0] == 0x1F && b[1] == 0x8B) {
+        return TraceCompression::GZIP;
+    }
+    if (size >= 4 && readLE32(data) == 0xFD2FB528u) {
+        return TraceCompression::ZSTD;
+    }
+    if (size >= 4 && readLE32(data) == 0x184D2204u) {
+        return TraceCompression::LZ4;
+    }
+    return TraceCompression::NONE;
+}
+
+const char* compressionName(TraceCompression compression) {
+    switch (compression) {
+        case TraceCompression::GZIP: return "gzip";
+        case TraceCompression::ZSTD: return "zstd";
+        case TraceCompression::LZ4: return "lz4";
+        default: return "none";
+    }
+}
+
+bool isCompressionSupported(TraceCompression compression) {
+    switch (compression) {
+        case TraceCompression::NONE: return true;
+#ifdef BRANCHSIM_HAVE_ZLIB
+        case TraceCompression::GZIP: return true;
+#endif
+#ifdef BRANCHSIM_HAVE_ZSTD
+        case TraceCompression::ZSTD: return true;
+#endif
+#ifdef BRANCHSIM_HAVE_LZ4
+        case TraceCompression::LZ4: return true;
+#endif
+        default: return false;
+    }
+}
+
+std::unique_ptr<TraceDecompressor> openDecompressor(std::unique_ptr<MappedFile> file, TraceCompression compression,
+                                                    int threads) {
+    if (threads <= 0) {
+        threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    }
+    std::vector<CompressedBlock> blocks;
+    switch (compression) {
+#ifdef BRANCHSIM_HAVE_ZLIB
+        case TraceCompression::GZIP:
+            if (listBgzfBlocks(file->data(), file->size(), blocks) && blocks.size() > 1) {
+                return std::unique_ptr<TraceDecompressor>(
+                    new ParallelBlockDecompressor(std::move(file), std::move(blocks), decodeGzipMember, threads));
+            }
+            return std::unique_ptr<TraceDecompressor>(new GzipStreamDecompressor(std::move(file)));
+#endif
+#ifdef BRANCHSIM_HAVE_ZSTD
+        case TraceCompression::ZSTD:
+            if (listZstdFrames(file->data(), file->size(), blocks) && blocks.size() > 1) {
+                return std::unique_ptr<TraceDecompressor>(
+                    new ParallelBlockDecompressor(std::move(file), std::move(blocks), decodeZstdFrame, threads));
+            }
+            return std::unique_ptr<TraceDecompressor>(new ZstdStreamDecompressor(std::move(file)));
+#endif
+#ifdef BRANCHSIM_HAVE_LZ4
+        case TraceCompression::LZ4:
+            return std::unique_ptr<TraceDecompressor>(new Lz4StreamDecompressor(std::move(file)));
+#endif
+        default:
+            std::cerr << "Error: Trace is " << compressionName(compression)
+                      << " compressed, but this build has no " << compressionName(compression)
+                      << " support; decompress it first or rebuild with the library installed." << std::endl;
+            return nullptr;
+    }
+}
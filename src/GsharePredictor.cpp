@@ -0,0 +1,12 @@
+/*
+* Gshare set-up. Prediction and update are inline in the header so they fold into the
+* simulation loop.
+*
+*/
+#include "../include/GsharePredictor.h"
+
+GsharePredictor::GsharePredictor(const BTBConfig&, const PredictorConfig& config, Arena& arena)
+    : tableBits(config.param(0, 14)), historyBits(config.param(1, tableBits)), history(0) {
+    table = PackedCounterTable(tableBits, arena);
+    historyMask = historyBits >= 64 ? ~0ull : (1ull << historyBits) - 1;
+}
@@ -0,0 +1,103 @@
+/*
+* Column storage of instructions. Addresses are appended to their arrays and the flags ORed into
+* the mask words, new words starting out zero, so the bits past the end of the batch are always
+* clear and a block at the end needs no special case.
+*
+*/
+#include "../include/InstructionBatch.h"
+#include <algorithm>
+
+namespace {
+
+// classifyBranch as a table, record types come mixed and a switch or compare chain on them
+// would mispredict
+struct BranchClassTable {
+    uint8_t code[256];
+
+    BranchClassTable() {
+        for (int c = 0; c < 256; c++) {
+            code[c] = static_cast<uint8_t>(BranchClass::DIRECT);
+        }
+        code['C'] = static_cast<uint8_t>(BranchClass::CALL);
+        code['R'] = static_cast<uint8_t>(BranchClass::RETURN);
+        code['I'] = static_cast<uint8_t>(BranchClass::INDIRECT);
+    }
+};
+
+const BranchClassTable BRANCH_CLASS;
+
+}
+
+InstructionBatch::InstructionBatch(const std::vector<Instruction>& instructions) {
+    append(instructions.data(), instructions.size());
+}
+
+void InstructionBatch::clear() {
+    sourceAddrs.clear();
+    targetAddrs.clear();
+    takenBits.clear();
+    backwardBits.clear();
+    classLowBits.clear();
+    classHighBits.clear();
+}
+
+void InstructionBatch::reserve(size_t count) {
+    size_t words = (count + 63) / 64;
+    sourceAddrs.reserve(count);
+    targetAddrs.reserve(count);
+    takenBits.reserve(words);
+    backwardBits.reserve(words);
+    classLowBits.reserve(words);
+    classHighBits.reserve(words);
+}
+
+void InstructionBatch::push_back(const Instruction& instr) {
+    append(&instr, 1);
+}
+
+// Columns are resized once and each flag word is built in a register, one word boundary at a
+// time, rather than pushed a record at a time. Flags are shifted in from the top, a constant shift
+// being cheaper than one by a variable count, then moved down into place.
+void InstructionBatch::append(const Instruction* instructions, size_t count) {
+    size_t begin = size();
+    size_t words = (begin + count + 63) / 64;
+    sourceAddrs.resize(begin + count);
+    targetAddrs.resize(begin + count);
+    takenBits.resize(words, 0);
+    backwardBits.resize(words, 0);
+    classLowBits.resize(words, 0);
+    classHighBits.resize(words, 0);
+
+    int* sources = sourceAddrs.data() + begin;
+    int* targets = targetAddrs.data() + begin;
+    for (size_t i = 0; i < count; i++) {
+        sources[i] = instructions[i].sourceAddr;
+        targets[i] = instructions[i].targetAddr;
+    }
+
+    size_t i = 0;
+    while (i < count) {
+        size_t word = (begin + i) / 64;
+        unsigned shift = static_cast<unsigned>((begin + i) % 64);
+        size_t run = std::min<size_t>(count - i, 64 - shift);
+        uint64_t taken = 0;
+        uint64_t backward = 0;
+        uint64_t classLow = 0;
+        uint64_t classHigh = 0;
+        for (size_t k = 0; k < run; k++) {
+            const Instruction& instr = instructions[i + k];
+            uint64_t code = BRANCH_CLASS.code[static_cast<uint8_t>(instr.type)];
+            taken = (taken >> 1) | (static_cast<uint64_t>(instr.taken) << 63);
+            backward = (backward >> 1) | (static_cast<uint64_t>(instr.direction == 'B') << 63);
+            classLow = (classLow >> 1) | (code << 63);
+            classHigh = (classHigh >> 1) | ((code >> 1) << 63);
+        }
+        // The run's first flag is at bit 64 - run, it belongs at shift
+        unsigned down = static_cast<unsigned>(64 - run);
+        takenBits[word] |= (taken >> down) << shift;
+        backwardBits[word] |= (backward >> down) << shift;
+        classLowBits[word] |= (classLow >> down) << shift;
+        classHighBits[word] |= (classHigh >> down) << shift;
+        i += run;
+    }
+}
@@ -0,0 +1,155 @@
+/*
+* Interval time-series statistics. The counters of the open window are bumped inline by the
+* driver; when a window closes it becomes one CSV line or one fixed-size binary record in an
+* output buffer, so a long trace streams out with constant memory and no per-window allocation.
+*
+*/
+#include "../include/IntervalStats.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const char INTERVAL_MAGIC[8] = {'B', 'P', 'I', 'V', 'A', 'L', '\0', '\0'};
+const uint32_t INTERVAL_FIELDS = 8;
+const size_t INTERVAL_BUFFER_BYTES = 1 << 16;
+
+void putLittleEndian(std::vector<uint8_t>& out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; i++) {
+        out.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+}
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+double percent(uint64_t part, uint64_t total) {
+    return total > 0 ? (double)part / total * 100.0 : 0.0;
+}
+
+}
+
+IntervalStats::IntervalStats(size_t length, const std::string& filename)
+    : length(length > 0 ? length : 1), csv(endsWith(filename, ".csv")),
+      out(filename, csv ? std::ios::out : std::ios::out | std::ios::binary),
+      window(1), start(0), instructions(0), predictionHits(0), staticHits(0), btbHits(0), btbMisses(0), evictions(0),
+      uniquePCs(0), mask(0), distinct(0), closedCleanly(false) {
+    keys.assign(1024, 0);
+    stamps.assign(1024, 0);
+    mask = 1023;
+    if (!out) {
+        std::cerr << "Error: Unable to write interval statistics to " << filename << std::endl;
+        return;
+    }
+
+    if (csv) {
+        out << "start,instructions,prediction_hits,static_hits,btb_hits,btb_misses,btb_evictions,unique_pcs,"
+               "accuracy,static_accuracy,btb_hit_rate\n";
+    } else {
+        buffer.insert(buffer.end(), INTERVAL_MAGIC, INTERVAL_MAGIC + sizeof(INTERVAL_MAGIC));
+        putLittleEndian(buffer, INTERVAL_STATS_VERSION, 4);
+        putLittleEndian(buffer, INTERVAL_FIELDS, 4);
+        putLittleEndian(buffer, this->length, 8);
+    }
+}
+
+IntervalStats::~IntervalStats() {
+    finish();
+}
+
+void IntervalStats::grow() {
+    std::vector<int> oldKeys;
+    std::vector<uint32_t> oldStamps;
+    oldKeys.swap(keys);
+    oldStamps.swap(stamps);
+    keys.assign(oldKeys.size() * 2, 0);
+    stamps.assign(oldStamps.size() * 2, 0);
+    mask = static_cast<uint32_t>(stamps.size() - 1);
+    for (size_t j = 0; j < oldStamps.size(); j++) {
+        if (oldStamps[j] == 0) {
+            continue;
+        }
+        uint32_t i = hash(oldKeys[j]) & mask;
+        while (stamps[i] != 0) {
+            i = (i + 1) & mask;
+        }
+        keys[i] = oldKeys[j];
+        stamps[i] = oldStamps[j];
+    }
+}
+
+void IntervalStats::closeWindow() {
+    if (out.is_open()) {
+        if (csv) {
+            std::ostringstream line;
+            line << start << ',' << instructions << ',' << predictionHits << ',' << staticHits << ',' << btbHits << ','
+                 << btbMisses << ',' << evictions << ',' << uniquePCs << std::fixed << std::setprecision(4) << ','
+                 << percent(predictionHits, instructions) << ',' << percent(staticHits, instructions) << ','
+                 << percent(btbHits, btbHits + btbMisses) << '\n';
+            out << line.str();
+        } else {
+            uint64_t fields[INTERVAL_FIELDS] = {start, instructions, predictionHits, staticHits,
+                                                btbHits, btbMisses, evictions, uniquePCs};
+            for (uint64_t field : fields) {
+                putLittleEndian(buffer, field, 8);
+            }
+            if (buffer.size() >= INTERVAL_BUFFER_BYTES) {
+                out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+    }
+
+    window++;
+    start += instructions;
+    instructions = 0;
+    predictionHits = 0;
+    staticHits = 0;
+    btbHits = 0;
+    btbMisses = 0;
+    evictions = 0;
+    uniquePCs = 0;
+}
+
+bool IntervalStats::finish() {
+    if (!out.is_open()) {
+        return closedCleanly;
+    }
+    if (instructions > 0) {
+        closeWindow();
+    }
+    out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()));
+    buffer.clear();
+    out.close();
+    closedCleanly = !out.fail();
+    if (!closedCleanly) {
+        std::cerr << "Error: Failed writing interval statistics" << std::endl;
+    }
+    return closedCleanly;
+}
+
+bool extractIntervalOption(int& argc, char* argv[], size_t& length, std::string& filename) {
+    int kept = 0;
+    for (int i = 0; i < argc; i++) {
+        if (std::strcmp(argv[i], "--intervals") != 0) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        char* end = nullptr;
+        long value = i + 2 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+        if (i + 2 >= argc || *end != '\0' || value <= 0) {
+            std::cerr << "Error: --intervals needs a window length and a file name" << std::endl;
+            return false;
+        }
+        length = static_cast<size_t>(value);
+        filename = argv[i + 2];
+        i += 2;
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return true;
+}
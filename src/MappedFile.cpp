@@ -0,0 +1,104 @@
+/*
+* Memory-mapped trace files. The mapping is private and read-only, and we tell the kernel the
+* file will be read front to back so it can read ahead aggressively.
+*
+*/
+#include "../include/MappedFile.h"
+#include <fstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BRANCHSIM_HAVE_MMAP 1
+#endif
+
+#ifdef BRANCHSIM_HAVE_MMAP
+bool MappedFile::readAll(int fd) {
+    const size_t chunk = 1 << 20;
+    size_t used = 0;
+    while (true) {
+        buffer.resize(used + chunk);
+        ssize_t got = read(fd, buffer.data() + used, chunk);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            buffer.clear();
+            return false;
+        }
+        if (got == 0) {
+            break;
+        }
+        used += static_cast<size_t>(got);
+    }
+    buffer.resize(used);
+    mapped = buffer.data();
+    length = used;
+    return true;
+}
+#endif
+
+MappedFile::MappedFile(const std::string& filename) : mapped(nullptr), length(0), opened(false), memoryMapped(false), released(0) {
+#ifdef BRANCHSIM_HAVE_MMAP
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd != -1) {
+        struct stat info;
+        if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+            length = static_cast<size_t>(info.st_size);
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (address != MAP_FAILED) {
+                madvise(address, length, MADV_SEQUENTIAL);
+                mapped = static_cast<const char*>(address);
+                memoryMapped = true;
+                opened = true;
+            } else {
+                length = 0;
+            }
+        }
+        if (!opened) {
+            // A pipe, FIFO or empty file has no size to map: read it through the descriptor already
+            // open, reopening a FIFO could lose what the writer put in it meanwhile
+            opened = readAll(fd);
+        }
+        close(fd);
+        if (opened) {
+            return;
+        }
+    }
+#endif
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        return;
+    }
+    buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    mapped = buffer.data();
+    length = buffer.size();
+    opened = true;
+}
+
+void MappedFile::release(size_t upTo) {
+#ifdef BRANCHSIM_HAVE_MMAP
+    if (!memoryMapped) {
+        return;
+    }
+    size_t pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    size_t end = (upTo < length ? upTo : length) / pageSize * pageSize;
+    if (end > released) {
+        madvise(const_cast<char*>(mapped) + released, end - released, MADV_DONTNEED);
+        released = end;
+    }
+#else
+    (void)upTo;
+#endif
+}
+
+MappedFile::~MappedFile() {
+#ifdef BRANCHSIM_HAVE_MMAP
+    if (memoryMapped) {
+        munmap(const_cast<char*>(mapped), length);
+    }
+#endif
+}
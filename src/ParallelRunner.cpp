@@ -0,0 +1,183 @@
+/*
+* Chunked parallel simulation of a single trace. Branch predictor and BTB state only depend on
+* recent history, so a chunk that first replays a warm-up window from the end of the previous
+* chunk behaves almost like the serial run from its first measured instruction. The error that
+* remains comes from state older than the window; the exact serial run is simulated alongside
+* (unless disabled) so the report shows how much accuracy the speedup cost.
+*
+*/
+#include "../include/ParallelRunner.h"
+#include "../include/CommandLine.h"
+#include "../include/PredictorRegistry.h"
+#include "../include/WorkStealingPool.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace {
+
+const size_t PARALLEL_DEFAULT_WARMUP = 100000;
+
+double percent(long long part, long long total) {
+    return total > 0 ? (double)part / total * 100.0 : 0.0;
+}
+
+}
+
+ParallelRunner::ParallelRunner(const SweepConfig& config, size_t chunks, size_t warmup, int threads)
+    : config(config), chunks(std::max<size_t>(1, chunks)), warmup(warmup), threads(threads) {}
+
+SweepResult ParallelRunner::simulate(const InstructionBatch& instructions) const {
+    size_t count = instructions.size();
+    size_t chunkCount = std::min(chunks, std::max<size_t>(1, count));
+    std::vector<SweepResult> chunkResults(chunkCount);
+
+    {
+        WorkStealingPool pool(threads);
+        for (size_t chunk = 0; chunk < chunkCount; chunk++) {
+            pool.submit([&, chunk]() {
+                size_t begin = count * chunk / chunkCount;
+                size_t end = count * (chunk + 1) / chunkCount;
+                size_t warm = std::min(warmup, begin);
+
+                Arena arena;
+                std::unique_ptr<SweepTarget> target = makeSweepTarget(config.predictor, config.btb, arena);
+                if (warm > 0) {
+                    // Rebuild the BTB and counter state from the tail of the previous chunk
+                    target->simulateBlock(instructions, begin - warm, warm);
+                    target->resetStatistics();
+                }
+                target->simulateBlock(instructions, begin, end - begin);
+                target->collect(chunkResults[chunk]);
+            });
+        }
+        pool.wait();
+    }
+
+    SweepResult merged = chunkResults[0];
+    merged.config = config;
+    for (size_t chunk = 1; chunk < chunkCount; chunk++) {
+        const SweepResult& part = chunkResults[chunk];
+        merged.instructions += part.instructions;
+        merged.btbHits += part.btbHits;
+        merged.btbMisses += part.btbMisses;
+        merged.predictionHits += part.predictionHits;
+        merged.staticPredictionHits += part.staticPredictionHits;
+        merged.btbHitButMispredicted += part.btbHitButMispredicted;
+        merged.lostCycles += part.lostCycles;
+        merged.stats.merge(part.stats);
+    }
+    return merged;
+}
+
+SweepResult ParallelRunner::simulateExact(const InstructionBatch& instructions) const {
+    SweepResult result;
+    Arena arena;
+    std::unique_ptr<SweepTarget> target = makeSweepTarget(config.predictor, config.btb, arena);
+    target->simulateBlock(instructions, 0, instructions.size());
+    target->collect(result);
+    result.config = config;
+    return result;
+}
+
+int runParallelCommand(int argc, char* argv[], const StatsOutput& statsOutput) {
+    // Trailing --no-exact skips the serial reference run
+    bool exact = true;
+    if (argc > 0 && std::string(argv[argc - 1]) == "--no-exact") {
+        exact = false;
+        argc--;
+    }
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " --parallel <trace_file> <btb_spec> <predictor_spec> [chunks [warmup [threads]]] [--no-exact]" << std::endl;
+        std::cerr << "       chunks and threads default to one per core, warmup to " << PARALLEL_DEFAULT_WARMUP << " instructions" << std::endl;
+        std::cerr << predictorUsage() << std::endl;
+        return 1;
+    }
+
+    std::string traceFile = argv[2];
+    SweepConfig config;
+    if (!parseBTBConfig(argv[3], config.btb)) {
+        std::cerr << "Error: Invalid BTB spec " << argv[3] << std::endl;
+        return 1;
+    }
+    if (!parsePredictorConfig(argv[4], config.predictor)) {
+        std::cerr << "Error: Invalid predictor spec " << argv[4] << std::endl;
+        return 1;
+    }
+    if (!validatePredictorConfig(config.predictor)) {
+        return 1;
+    }
+    long threadCount = 0;
+    long chunkCount = 0;
+    long warmupCount = static_cast<long>(PARALLEL_DEFAULT_WARMUP);
+    if (!parseCountArgument(argc, argv, 5, "chunk count", 1, LONG_MAX, chunkCount) ||
+        !parseCountArgument(argc, argv, 6, "warm-up length", 0, LONG_MAX, warmupCount) ||
+        !parseCountArgument(argc, argv, 7, "thread count", 1, INT_MAX, threadCount)) {
+        return 1;
+    }
+    int threads = static_cast<int>(threadCount);
+    int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    size_t chunks = chunkCount > 0 ? static_cast<size_t>(chunkCount) : static_cast<size_t>(threads > 0 ? threads : cores);
+    size_t warmup = static_cast<size_t>(warmupCount);
+
+    // Chunks need random access, so this mode holds the whole trace in memory
+    TraceReader reader(traceFile);
+    if (!reader.open()) {
+        return 1;
+    }
+    InstructionBatch instructions = reader.readTrace();
+    reader.printParseStats();
+
+    ParallelRunner runner(config, chunks, warmup, threads);
+    auto start = std::chrono::steady_clock::now();
+    SweepResult parallel = runner.simulate(instructions);
+    double parallelSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Simulated " << instructions.size() << " instructions in " << chunks << " chunks with "
+              << warmup << " warm-up instructions each" << std::endl;
+    std::cout << std::left << std::setw(10) << "run";
+    printResultHeader();
+    std::cout << std::left << std::setw(10) << "parallel";
+    printResultRow(parallel);
+
+    std::vector<StatsRegistry> runs(1);
+    runs[0].label("trace", traceFile);
+    runs[0].label("run", "parallel");
+    runs[0].label("chunks", static_cast<uint64_t>(chunks));
+    runs[0].label("warmup", static_cast<uint64_t>(warmup));
+    runs[0].merge(resultStats(parallel));
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(3);
+    if (exact) {
+        start = std::chrono::steady_clock::now();
+        SweepResult serial = runner.simulateExact(instructions);
+        double serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << std::left << std::setw(10) << "exact";
+        printResultRow(serial);
+        runs.push_back(StatsRegistry());
+        runs.back().label("trace", traceFile);
+        runs.back().label("run", "exact");
+        runs.back().merge(resultStats(serial));
+
+        double accuracyError = percent(parallel.predictionHits, parallel.instructions) - percent(serial.predictionHits, serial.instructions);
+        // Over BTB lookups, branches taking their target from the RAS or indirect cache are neither
+        double hitRateError = percent(parallel.btbHits, parallel.btbHits + parallel.btbMisses) -
+                              percent(serial.btbHits, serial.btbHits + serial.btbMisses);
+        double staticError = percent(parallel.staticPredictionHits, parallel.instructions) - percent(serial.staticPredictionHits, serial.instructions);
+        summary << "Error vs exact: accuracy " << std::showpos << accuracyError << " pp, BTB hit rate " << hitRateError
+                << " pp, static accuracy " << staticError << " pp" << std::noshowpos << std::endl;
+        summary << "Parallel " << parallelSeconds << " s, serial " << serialSeconds << " s, speedup "
+                << std::setprecision(2) << (parallelSeconds > 0.0 ? serialSeconds / parallelSeconds : 0.0) << "x";
+    } else {
+        summary << "Parallel " << parallelSeconds << " s";
+    }
+    std::cout << summary.str() << std::endl;
+    return writeStatsOutput(statsOutput, runs) ? 0 : 1;
+}
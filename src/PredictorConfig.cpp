@@ -0,0 +1,41 @@
+/*
+* Predictor specs on the command line: a name followed by colon-separated integer parameters.
+*
+*/
+#include "../include/PredictorConfig.h"
+#include <stdexcept>
+
+bool parsePredictorConfig(const std::string& spec, PredictorConfig& config) {
+    PredictorConfig parsed;
+    parsed.params.clear();
+    size_t colon = spec.find(':');
+    parsed.name = spec.substr(0, colon);
+    if (parsed.name.empty()) {
+        return false;
+    }
+    while (colon != std::string::npos) {
+        size_t next = spec.find(':', colon + 1);
+        std::string field = spec.substr(colon + 1, next == std::string::npos ? std::string::npos : next - colon - 1);
+        try {
+            size_t used = 0;
+            int value = std::stoi(field, &used);
+            if (used != field.size() || value < 0) {
+                return false;
+            }
+            parsed.params.push_back(value);
+        } catch (const std::exception&) {
+            return false;
+        }
+        colon = next;
+    }
+    config = parsed;
+    return true;
+}
+
+std::string predictorConfigName(const PredictorConfig& config) {
+    std::string name = config.name;
+    for (int param : config.params) {
+        name += ":" + std::to_string(param);
+    }
+    return name;
+}
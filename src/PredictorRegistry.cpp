@@ -0,0 +1,129 @@
+/*
+* Maps predictor spec names to the policy classes. Each class is instantiated here with the
+* templated driver, so the per-instruction loop is specialised for every predictor while the
+* command-line tools pick one at run time.
+*
+*/
+#include "../include/PredictorRegistry.h"
+#include "../include/BranchPredictor.h"
+#include "../include/GsharePredictor.h"
+#include "../include/TagePredictor.h"
+#include "../include/TwoBitBranchPredictor.h"
+#include "../include/TwoLevelPredictor.h"
+#include <iostream>
+
+namespace {
+
+template <typename Predictor>
+struct PredictorType {
+    using type = Predictor;
+};
+
+// Call visit(PredictorType<P>()) for the predictor the spec names, false if there is none
+template <typename Visitor>
+bool forEachPredictorType(const PredictorConfig& config, Visitor&& visit) {
+    if (config.name == StaticPredictor::name()) {
+        visit(PredictorType<StaticPredictor>());
+    } else if (config.name == TwoBitPredictor::name()) {
+        visit(PredictorType<TwoBitPredictor>());
+    } else if (config.name == GsharePredictor::name()) {
+        visit(PredictorType<GsharePredictor>());
+    } else if (config.name == GAgPredictor::name()) {
+        visit(PredictorType<GAgPredictor>());
+    } else if (config.name == PApPredictor::name()) {
+        visit(PredictorType<PApPredictor>());
+    } else if (config.name == TagePredictor::name()) {
+        visit(PredictorType<TagePredictor>());
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool checkParam(const PredictorConfig& config, size_t i, int fallback, int low, int high, const char* what) {
+    int value = config.param(i, fallback);
+    if (value < low || value > high) {
+        std::cerr << "Error: " << config.name << " " << what << " must be between " << low << " and " << high << std::endl;
+        return false;
+    }
+    return true;
+}
+
+}
+
+bool validatePredictorConfig(const PredictorConfig& config) {
+    size_t maxParams = 0;
+    bool valid = true;
+    if (config.name == StaticPredictor::name() || config.name == TwoBitPredictor::name()) {
+        maxParams = 0;
+    } else if (config.name == GsharePredictor::name()) {
+        maxParams = 2;
+        valid = checkParam(config, 0, 14, 1, 28, "table bits") &&
+                checkParam(config, 1, config.param(0, 14), 0, 64, "history bits");
+    } else if (config.name == GAgPredictor::name()) {
+        maxParams = 1;
+        valid = checkParam(config, 0, 12, 1, 28, "history bits");
+    } else if (config.name == PApPredictor::name()) {
+        maxParams = 3;
+        valid = checkParam(config, 0, 10, 0, 24, "history table bits") &&
+                checkParam(config, 1, 10, 0, 28, "history bits") &&
+                checkParam(config, 2, 4, 0, 28 - config.param(1, 10), "address bits");
+    } else if (config.name == TagePredictor::name()) {
+        maxParams = 4;
+        valid = checkParam(config, 0, 7, 1, TAGE_MAX_TABLES, "table count") &&
+                checkParam(config, 1, 10, 4, 20, "table bits") &&
+                checkParam(config, 3, 200, 1, TAGE_MAX_HISTORY - 1, "maximum history") &&
+                checkParam(config, 2, 5, 1, config.param(3, 200), "minimum history");
+    } else {
+        std::cerr << "Error: Unknown predictor " << config.name << std::endl;
+        return false;
+    }
+    if (config.params.size() > maxParams) {
+        std::cerr << "Error: Too many parameters for " << config.name << std::endl;
+        return false;
+    }
+    return valid;
+}
+
+const char* predictorUsage() {
+    return "       predictor = static | twobit | gshare[:tableBits[:historyBits]] | gag[:historyBits]\n"
+           "                   | pap[:historyTableBits[:historyBits[:addressBits]]]\n"
+           "                   | tage[:tables[:tableBits[:minHistory[:maxHistory]]]]";
+}
+
+std::unique_ptr<SweepTarget> makeSweepTarget(const PredictorConfig& predictor, const BTBConfig& btb, Arena& arena) {
+    std::unique_ptr<SweepTarget> target;
+    forEachPredictorType(predictor, [&](auto type) {
+        using Predictor = typename decltype(type)::type;
+        target.reset(new DriverSweepTarget<Predictor>(btb, predictor, arena));
+    });
+    return target;
+}
+
+bool runPredictorSimulation(const PredictorConfig& predictor, const BTBConfig& btb, const std::string& traceFile,
+                            StatsRegistry& stats, const RunOptions& options) {
+    bool ok = true;
+    forEachPredictorType(predictor, [&](auto type) {
+        using Predictor = typename decltype(type)::type;
+        SimulationDriver<Predictor> driver(btb, predictor);
+        if (options.profileTop > 0) {
+            driver.enableProfile();
+        }
+        if (options.intervalLength > 0 && !driver.enableIntervals(options.intervalLength, options.intervalFile)) {
+            ok = false;
+            return;
+        }
+        if (!driver.simulateTrace(traceFile, options.checkpoint)) {
+            ok = false;
+            return;
+        }
+        ok = driver.finishIntervals();
+        driver.printStats();
+        driver.registerStats(stats);
+        if (options.profileTop > 0) {
+            std::cout << std::endl;
+            driver.getProfile()->printReport(std::cout, options.profileTop);
+        }
+    });
+    return ok;
+}
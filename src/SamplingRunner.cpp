@@ -0,0 +1,466 @@
+/*
+* Sampled simulation. Instead of simulating every instruction in detail, measure short units of
+* the trace and estimate the full-trace rates from them, the way SMARTS and SimPoint do for
+* cycle-level simulators.
+* Between samples the trace is fast-forwarded. With functional warming (the default) the BTB is
+* still updated for every instruction, because a large BTB remembers branches from far back;
+* the direction predictors only remember recent history, so the detailed warm-up window right
+* before each unit is enough to rebuild their counters.
+* Every sample contributes one accuracy, BTB hit rate and static accuracy. The estimate is the
+* stratum-weighted mean of the sample rates and its variance the usual stratified-sampling
+* variance, which gives a Student t confidence interval.
+*
+*/
+#include "../include/SamplingRunner.h"
+#include "../include/PredictorRegistry.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <sstream>
+
+namespace {
+
+const int SIMPOINT_DIMENSION_BITS = 5;
+const int SIMPOINT_DIMENSIONS = 1 << SIMPOINT_DIMENSION_BITS; // Buckets of the per-interval branch address profile
+const int SIMPOINT_ITERATIONS = 30;
+const double TARGET_HALF_WIDTH = 0.5; // Percentage points, for the sample size advice
+
+// Two-sided 95% Student t quantiles for 1 to 30 degrees of freedom
+const double T_QUANTILES_95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+};
+
+double tQuantile95(size_t degreesOfFreedom) {
+    if (degreesOfFreedom <= 30) {
+        return T_QUANTILES_95[degreesOfFreedom - 1];
+    }
+    return 1.96 + 2.372 / degreesOfFreedom; // First Cornish-Fisher term, within 0.003 of the table at 30
+}
+
+double percent(long long part, long long total) {
+    return total > 0 ? (double)part / total * 100.0 : 0.0;
+}
+
+uint32_t nextRandom(uint32_t& state) {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+// Stratified estimate of the mean rate. A stratum with a single sample has no variance of its
+// own and borrows the pooled within-stratum variance of the others.
+SampledMetric estimate(const std::vector<double>& rates, const std::vector<int>& strata, const std::vector<size_t>& strataUnits) {
+    size_t strataCount = strataUnits.size();
+    std::vector<size_t> counts(strataCount, 0);
+    std::vector<double> means(strataCount, 0.0);
+    std::vector<double> variances(strataCount, 0.0);
+    for (size_t i = 0; i < rates.size(); i++) {
+        counts[strata[i]]++;
+        means[strata[i]] += rates[i];
+    }
+    for (size_t h = 0; h < strataCount; h++) {
+        means[h] = counts[h] > 0 ? means[h] / counts[h] : 0.0;
+    }
+    for (size_t i = 0; i < rates.size(); i++) {
+        double deviation = rates[i] - means[strata[i]];
+        variances[strata[i]] += deviation * deviation;
+    }
+
+    size_t degreesOfFreedom = 0;
+    double pooled = 0.0;
+    size_t totalUnits = 0;
+    for (size_t h = 0; h < strataCount; h++) {
+        if (counts[h] > 1) {
+            pooled += variances[h];
+            degreesOfFreedom += counts[h] - 1;
+            variances[h] /= counts[h] - 1;
+        }
+        totalUnits += strataUnits[h];
+    }
+    pooled = degreesOfFreedom > 0 ? pooled / degreesOfFreedom : 0.0;
+
+    SampledMetric metric{0.0, std::numeric_limits<double>::quiet_NaN()};
+    double variance = 0.0;
+    for (size_t h = 0; h < strataCount; h++) {
+        if (counts[h] == 0) {
+            continue;
+        }
+        double weight = (double)strataUnits[h] / totalUnits;
+        double unsampled = 1.0 - (double)counts[h] / strataUnits[h]; // Finite population correction
+        metric.estimate += weight * means[h];
+        variance += weight * weight * unsampled * (counts[h] > 1 ? variances[h] : pooled) / counts[h];
+    }
+    if (degreesOfFreedom > 0) {
+        metric.halfWidth = tQuantile95(degreesOfFreedom) * std::sqrt(variance);
+    }
+    return metric;
+}
+
+}
+
+bool parseWarmingMode(const std::string& name, WarmingMode& mode) {
+    if (name == "none") {
+        mode = WarmingMode::NONE;
+    } else if (name == "btb") {
+        mode = WarmingMode::BTB;
+    } else if (name == "full") {
+        mode = WarmingMode::FULL;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* warmingModeName(WarmingMode mode) {
+    switch (mode) {
+        case WarmingMode::NONE: return "none";
+        case WarmingMode::BTB: return "btb";
+        case WarmingMode::FULL: return "full";
+    }
+    return "unknown";
+}
+
+bool parseSamplingConfig(const std::string& spec, SamplingConfig& config) {
+    PredictorConfig fields; // Same "name:param:..." grammar as a predictor spec
+    if (!parsePredictorConfig(spec, fields)) {
+        return false;
+    }
+
+    SamplingConfig parsed;
+    parsed.warming = config.warming;
+    if (fields.name == "periodic" && fields.params.size() <= 3) {
+        parsed.method = SamplingMethod::PERIODIC;
+        parsed.samples = fields.param(0, 100);
+        parsed.unit = fields.param(1, 1000);
+        parsed.warmup = fields.param(2, 5000);
+    } else if (fields.name == "simpoint" && fields.params.size() <= 4) {
+        parsed.method = SamplingMethod::SIMPOINT;
+        parsed.samples = fields.param(0, 10);
+        parsed.perCluster = fields.param(1, 3);
+        parsed.unit = fields.param(2, 10000);
+        parsed.warmup = fields.param(3, 5000);
+    } else {
+        return false;
+    }
+    if (parsed.samples == 0 || parsed.perCluster == 0 || parsed.unit == 0) {
+        return false;
+    }
+    config = parsed;
+    return true;
+}
+
+SamplingRunner::SamplingRunner(const SweepConfig& config, const SamplingConfig& sampling)
+    : config(config), sampling(sampling) {}
+
+std::vector<SamplingRunner::Sample> SamplingRunner::choosePeriodic(size_t count, std::vector<size_t>& strataUnits) const {
+    std::vector<Sample> samples;
+    size_t units = count / sampling.unit;
+    size_t n = std::min(sampling.samples, units);
+    for (size_t i = 0; i < n; i++) {
+        // Measure the last unit of each period, so the warm-up fits in front of it
+        size_t end = count * (i + 1) / n;
+        samples.push_back(Sample{end - sampling.unit, end, 0});
+    }
+    strataUnits.assign(n > 0 ? 1 : 0, units);
+    return samples;
+}
+
+std::vector<SamplingRunner::Sample> SamplingRunner::chooseSimPoints(const InstructionBatch& instructions,
+                                                                    std::vector<size_t>& strataUnits) const {
+    size_t intervals = instructions.size() / sampling.unit;
+    size_t k = std::min(sampling.samples, intervals);
+    strataUnits.clear();
+    if (k == 0) {
+        return std::vector<Sample>();
+    }
+
+    // Profile each interval as a normalised histogram of hashed branch addresses, the branch
+    // trace's stand-in for SimPoint's basic block vectors
+    std::vector<double> profiles(intervals * SIMPOINT_DIMENSIONS, 0.0);
+    double weight = 1.0 / sampling.unit;
+    for (size_t interval = 0; interval < intervals; interval++) {
+        double* profile = &profiles[interval * SIMPOINT_DIMENSIONS];
+        size_t begin = interval * sampling.unit;
+        for (size_t i = begin; i < begin + sampling.unit; i++) {
+            uint32_t h = static_cast<uint32_t>(instructions.sourceAddr(i)) * 0x9E3779B1u;
+            profile[h >> (32 - SIMPOINT_DIMENSION_BITS)] += weight;
+        }
+    }
+
+    auto distance = [&](size_t interval, const double* centroid) {
+        const double* profile = &profiles[interval * SIMPOINT_DIMENSIONS];
+        double sum = 0.0;
+        for (int d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+            double delta = profile[d] - centroid[d];
+            sum += delta * delta;
+        }
+        return sum;
+    };
+
+    // k-means++ seeding with a fixed seed, so repeated runs choose the same samples
+    uint32_t randomState = 0x2545F491u;
+    std::vector<double> centroids(k * SIMPOINT_DIMENSIONS);
+    std::vector<double> nearest(intervals, std::numeric_limits<double>::max());
+    size_t chosen = nextRandom(randomState) % intervals;
+    for (size_t c = 0; c < k; c++) {
+        std::copy_n(&profiles[chosen * SIMPOINT_DIMENSIONS], SIMPOINT_DIMENSIONS, &centroids[c * SIMPOINT_DIMENSIONS]);
+        double total = 0.0;
+        for (size_t interval = 0; interval < intervals; interval++) {
+            nearest[interval] = std::min(nearest[interval], distance(interval, &centroids[c * SIMPOINT_DIMENSIONS]));
+            total += nearest[interval];
+        }
+        double target = total * (nextRandom(randomState) / 4294967296.0);
+        for (chosen = 0; chosen + 1 < intervals && target >= nearest[chosen]; chosen++) {
+            target -= nearest[chosen];
+        }
+    }
+
+    std::vector<int> cluster(intervals, -1);
+    for (int iteration = 0; iteration < SIMPOINT_ITERATIONS; iteration++) {
+        bool changed = false;
+        for (size_t interval = 0; interval < intervals; interval++) {
+            int best = 0;
+            double bestDistance = std::numeric_limits<double>::max();
+            for (size_t c = 0; c < k; c++) {
+                double d = distance(interval, &centroids[c * SIMPOINT_DIMENSIONS]);
+                if (d < bestDistance) {
+                    bestDistance = d;
+                    best = static_cast<int>(c);
+                }
+            }
+            changed = changed || cluster[interval] != best;
+            cluster[interval] = best;
+        }
+        if (!changed) {
+            break;
+        }
+
+        // Empty clusters keep their old centroid
+        std::vector<double> sums(k * SIMPOINT_DIMENSIONS, 0.0);
+        std::vector<size_t> sizes(k, 0);
+        for (size_t interval = 0; interval < intervals; interval++) {
+            sizes[cluster[interval]]++;
+            for (int d = 0; d < SIMPOINT_DIMENSIONS; d++) {
+                sums[cluster[interval] * SIMPOINT_DIMENSIONS + d] += profiles[interval * SIMPOINT_DIMENSIONS + d];
+            }
+        }
+        for (size_t c = 0; c < k; c++) {
+            for (int d = 0; sizes[c] > 0 && d < SIMPOINT_DIMENSIONS; d++) {
+                centroids[c * SIMPOINT_DIMENSIONS + d] = sums[c * SIMPOINT_DIMENSIONS + d] / sizes[c];
+            }
+        }
+    }
+
+    // Draw members at random rather than taking the one nearest the centroid, so the spread
+    // within a cluster is an honest estimate of its variance
+    std::vector<std::vector<size_t>> members(k);
+    for (size_t interval = 0; interval < intervals; interval++) {
+        members[cluster[interval]].push_back(interval);
+    }
+    std::vector<Sample> samples;
+    for (std::vector<size_t>& group : members) {
+        if (group.empty()) {
+            continue;
+        }
+        int stratum = static_cast<int>(strataUnits.size());
+        strataUnits.push_back(group.size());
+        size_t draws = std::min(sampling.perCluster, group.size());
+        for (size_t i = 0; i < draws; i++) {
+            std::swap(group[i], group[i + nextRandom(randomState) % (group.size() - i)]);
+            size_t begin = group[i] * sampling.unit;
+            samples.push_back(Sample{begin, begin + sampling.unit, stratum});
+        }
+    }
+    std::sort(samples.begin(), samples.end(), [](const Sample& a, const Sample& b) { return a.begin < b.begin; });
+    return samples;
+}
+
+SamplingResult SamplingRunner::simulate(const InstructionBatch& instructions) const {
+    std::vector<size_t> strataUnits;
+    std::vector<Sample> samples = sampling.method == SamplingMethod::PERIODIC
+        ? choosePeriodic(instructions.size(), strataUnits)
+        : chooseSimPoints(instructions, strataUnits);
+
+    SamplingResult result{};
+    result.samples = samples.size();
+    result.strata = strataUnits.size();
+    result.totalInstructions = static_cast<long long>(instructions.size());
+
+    std::vector<double> accuracy, btbHitRate, staticAccuracy;
+    std::vector<int> strata;
+    Arena arena;
+    std::unique_ptr<SweepTarget> target = makeSweepTarget(config.predictor, config.btb, arena);
+    size_t position = 0;
+
+    for (const Sample& sample : samples) {
+        size_t warmBegin = sample.begin - std::min(sampling.warmup, sample.begin - position);
+
+        // Fast-forward up to the warm-up window
+        size_t gap = warmBegin - position;
+        if (sampling.warming != WarmingMode::NONE) {
+            target->warmBlock(instructions, position, gap, sampling.warming == WarmingMode::FULL);
+        }
+        result.warmedInstructions += sampling.warming == WarmingMode::NONE ? 0 : static_cast<long long>(gap);
+
+        target->simulateBlock(instructions, warmBegin, sample.begin - warmBegin);
+        target->resetStatistics();
+        target->simulateBlock(instructions, sample.begin, sample.end - sample.begin);
+
+        SweepResult part;
+        target->collect(part);
+        accuracy.push_back(percent(part.predictionHits, part.instructions));
+        btbHitRate.push_back(percent(part.btbHits, part.btbHits + part.btbMisses));
+        staticAccuracy.push_back(percent(part.staticPredictionHits, part.instructions));
+        strata.push_back(sample.stratum);
+
+        result.measuredInstructions += static_cast<long long>(sample.end - sample.begin);
+        result.detailedInstructions += static_cast<long long>(sample.end - warmBegin);
+        position = sample.end;
+    }
+
+    result.accuracy = estimate(accuracy, strata, strataUnits);
+    result.btbHitRate = estimate(btbHitRate, strata, strataUnits);
+    result.staticAccuracy = estimate(staticAccuracy, strata, strataUnits);
+
+    double mean = 0.0;
+    for (double rate : accuracy) {
+        mean += rate;
+    }
+    mean = accuracy.empty() ? 0.0 : mean / accuracy.size();
+    double sumSquares = 0.0;
+    for (double rate : accuracy) {
+        sumSquares += (rate - mean) * (rate - mean);
+    }
+    result.accuracyStdDev = accuracy.size() > 1 ? std::sqrt(sumSquares / (accuracy.size() - 1)) : 0.0;
+    return result;
+}
+
+int runSampleCommand(int argc, char* argv[]) {
+    // Trailing --no-exact skips the full reference run
+    bool exact = true;
+    if (argc > 0 && std::string(argv[argc - 1]) == "--no-exact") {
+        exact = false;
+        argc--;
+    }
+    if (argc < 5) {
+        std::cerr << "Usage: " << argv[0] << " --sample <trace_file> <btb_spec> <predictor_spec> [sampling_spec [none|btb|full]] [--no-exact]" << std::endl;
+        std::cerr << "       sampling specs: periodic[:samples[:unit[:warmup]]] (default periodic:100:1000:5000)" << std::endl;
+        std::cerr << "                       simpoint[:clusters[:perCluster[:interval[:warmup]]]] (default simpoint:10:3:10000:5000)" << std::endl;
+        std::cerr << "       warming between samples: none, btb (default) or full" << std::endl;
+        std::cerr << predictorUsage() << std::endl;
+        return 1;
+    }
+
+    std::string traceFile = argv[2];
+    SweepConfig config;
+    if (!parseBTBConfig(argv[3], config.btb)) {
+        std::cerr << "Error: Invalid BTB spec " << argv[3] << std::endl;
+        return 1;
+    }
+    if (!parsePredictorConfig(argv[4], config.predictor)) {
+        std::cerr << "Error: Invalid predictor spec " << argv[4] << std::endl;
+        return 1;
+    }
+    if (!validatePredictorConfig(config.predictor)) {
+        return 1;
+    }
+    SamplingConfig sampling;
+    if (argc > 6 && !parseWarmingMode(argv[6], sampling.warming)) {
+        std::cerr << "Error: Unknown warming mode " << argv[6] << std::endl;
+        return 1;
+    }
+    if (argc > 5 && !parseSamplingConfig(argv[5], sampling)) {
+        std::cerr << "Error: Invalid sampling spec " << argv[5] << std::endl;
+        return 1;
+    }
+
+    // Samples are placed over the whole trace, so this mode holds it in memory
+    TraceReader reader(traceFile);
+    if (!reader.open()) {
+        return 1;
+    }
+    InstructionBatch instructions = reader.readTrace();
+    reader.printParseStats();
+
+    SamplingRunner runner(config, sampling);
+    auto start = std::chrono::steady_clock::now();
+    SamplingResult sampled = runner.simulate(instructions);
+    double sampledSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    if (sampled.samples == 0) {
+        std::cerr << "Error: Trace of " << instructions.size() << " instructions is shorter than one sampling unit of "
+                  << sampling.unit << std::endl;
+        return 1;
+    }
+
+    SweepResult serial{};
+    double serialSeconds = 0.0;
+    if (exact) {
+        start = std::chrono::steady_clock::now();
+        Arena arena;
+        std::unique_ptr<SweepTarget> target = makeSweepTarget(config.predictor, config.btb, arena);
+        target->simulateBlock(instructions, 0, instructions.size());
+        target->collect(serial);
+        serialSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    std::ostringstream report;
+    report << std::fixed << std::setprecision(2);
+    report << "Sampled " << sampled.samples << " units of " << sampling.unit << " instructions";
+    if (sampling.method == SamplingMethod::SIMPOINT) {
+        report << " from " << sampled.strata << " SimPoint clusters";
+    }
+    report << " (" << sampling.warmup << " warm-up, " << warmingModeName(sampling.warming) << " warming) of "
+           << sampled.totalInstructions << " instructions" << std::endl;
+    report << "Detailed simulation " << percent(sampled.detailedInstructions, sampled.totalInstructions)
+           << "% of the trace (" << percent(sampled.measuredInstructions, sampled.totalInstructions) << "% measured), warmed "
+           << percent(sampled.warmedInstructions, sampled.totalInstructions) << "%" << std::endl;
+
+    report << std::left << std::setw(18) << "metric" << std::right << std::setw(10) << "estimate" << std::setw(12) << "95% CI";
+    if (exact) {
+        report << std::setw(10) << "exact" << std::setw(10) << "error" << "  in CI";
+    }
+    report << std::endl;
+
+    auto row = [&](const char* name, const SampledMetric& metric, double exactValue) {
+        std::ostringstream interval;
+        interval << std::fixed << std::setprecision(2);
+        if (std::isnan(metric.halfWidth)) {
+            interval << "n/a";
+        } else {
+            interval << "+/-" << metric.halfWidth;
+        }
+        report << std::left << std::setw(18) << name << std::right << std::setw(9) << metric.estimate << "%"
+               << std::setw(12) << interval.str();
+        if (exact) {
+            double error = metric.estimate - exactValue;
+            report << std::setw(9) << exactValue << "%" << std::setw(10) << std::showpos << error << std::noshowpos
+                   << (std::isnan(metric.halfWidth) ? "  n/a" : std::fabs(error) <= metric.halfWidth ? "  yes" : "  no");
+        }
+        report << std::endl;
+    };
+    row("accuracy", sampled.accuracy, percent(serial.predictionHits, serial.instructions));
+    row("BTB hit rate", sampled.btbHitRate, percent(serial.btbHits, serial.btbHits + serial.btbMisses));
+    row("static accuracy", sampled.staticAccuracy, percent(serial.staticPredictionHits, serial.instructions));
+
+    if (sampling.method == SamplingMethod::PERIODIC && sampled.samples > 1) {
+        // SMARTS sample size rule: n >= (z * stddev / half-width)^2
+        double needed = std::ceil(std::pow(1.96 * sampled.accuracyStdDev / TARGET_HALF_WIDTH, 2.0));
+        report << "Accuracy varies by " << sampled.accuracyStdDev << " pp between samples, about "
+               << std::setprecision(0) << needed << " samples give +/-" << std::setprecision(2) << TARGET_HALF_WIDTH << " pp" << std::endl;
+    }
+    report << std::setprecision(3) << "Sampled " << sampledSeconds << " s";
+    if (exact) {
+        report << ", full " << serialSeconds << " s, speedup " << std::setprecision(2)
+               << (sampledSeconds > 0.0 ? serialSeconds / sampledSeconds : 0.0) << "x";
+    }
+    std::cout << report.str() << std::endl;
+    return 0;
+}
@@ -0,0 +1,206 @@
+/*
+* Single-pass stack-distance profiler for fully associative LRU BTBs.
+* Conceptually every branch has a level in a priority stack whose top k levels are exactly the
+* contents of a k-entry BTB, and a hit at level d is a hit for every capacity above d.
+* Taken branches move to the top. At each capacity boundary the BTB of that size evicts its least
+* recently used entry, which is either the entry pushed down from the smaller BTB above or the
+* oldest entry of the band below the boundary, so only the oldest entry of each band is needed.
+*
+*/
+#include "../include/StackDistanceProfiler.h"
+#include <algorithm>
+
+StackDistanceProfiler::StackDistanceProfiler(const std::vector<int>& requested)
+    : clock(0), totalAccesses(0), notTakenTotal(0) {
+    for (int capacity : requested) {
+        if (capacity > 0) {
+            capacities.push_back(capacity);
+        }
+    }
+    std::sort(capacities.begin(), capacities.end());
+    capacities.erase(std::unique(capacities.begin(), capacities.end()), capacities.end());
+
+    // One spare entry for the new branch while the one it pushes out is still in the stack
+    int maxCapacity = capacities.empty() ? 0 : capacities.back() + 1;
+    bands.resize(capacities.size());
+    for (size_t band = 0; band < bands.size(); band++) {
+        bands[band].reserve(bandCapacity(static_cast<int>(band)));
+    }
+    entryAddr.resize(maxCapacity);
+    entryTarget.resize(maxCapacity);
+    entryTime.resize(maxCapacity);
+    entryBand.resize(maxCapacity);
+    entryHeapPos.resize(maxCapacity);
+    for (int id = maxCapacity - 1; id >= 0; id--) {
+        freeEntries.push_back(id);
+    }
+    entries = AddressIndex(maxCapacity, arena);
+    takenInBand.assign(capacities.size() + 1, 0);
+    notTakenInBand.assign(capacities.size() + 1, 0);
+    wrongTargetInBand.assign(capacities.size() + 1, 0);
+}
+
+int StackDistanceProfiler::bandCapacity(int band) const {
+    return capacities[band] - (band > 0 ? capacities[band - 1] : 0);
+}
+
+int StackDistanceProfiler::bandOf(int capacity) const {
+    return static_cast<int>(std::lower_bound(capacities.begin(), capacities.end(), capacity) - capacities.begin());
+}
+
+void StackDistanceProfiler::siftUp(int band, int pos) {
+    std::vector<int>& heap = bands[band];
+    int id = heap[pos];
+    while (pos > 0) {
+        int parent = (pos - 1) / 2;
+        if (entryTime[heap[parent]] <= entryTime[id]) {
+            break;
+        }
+        heap[pos] = heap[parent];
+        entryHeapPos[heap[pos]] = pos;
+        pos = parent;
+    }
+    heap[pos] = id;
+    entryHeapPos[id] = pos;
+}
+
+void StackDistanceProfiler::siftDown(int band, int pos) {
+    std::vector<int>& heap = bands[band];
+    int size = static_cast<int>(heap.size());
+    int id = heap[pos];
+    while (true) {
+        int child = 2 * pos + 1;
+        if (child >= size) {
+            break;
+        }
+        if (child + 1 < size && entryTime[heap[child + 1]] < entryTime[heap[child]]) {
+            child++;
+        }
+        if (entryTime[id] <= entryTime[heap[child]]) {
+            break;
+        }
+        heap[pos] = heap[child];
+        entryHeapPos[heap[pos]] = pos;
+        pos = child;
+    }
+    heap[pos] = id;
+    entryHeapPos[id] = pos;
+}
+
+void StackDistanceProfiler::heapPush(int band, int id) {
+    entryBand[id] = band;
+    bands[band].push_back(id);
+    siftUp(band, static_cast<int>(bands[band].size()) - 1);
+}
+
+void StackDistanceProfiler::heapRemove(int band, int id) {
+    std::vector<int>& heap = bands[band];
+    int pos = entryHeapPos[id];
+    int last = heap.back();
+    heap.pop_back();
+    if (last != id) {
+        heap[pos] = last;
+        entryHeapPos[last] = pos;
+        siftUp(band, pos);
+        siftDown(band, entryHeapPos[last]);
+    }
+}
+
+void StackDistanceProfiler::access(int sourceAddr, bool taken, int targetAddr) {
+    clock++;
+    totalAccesses++;
+    int id = entries.find(sourceAddr);
+    int numBands = static_cast<int>(capacities.size());
+    int band = id == -1 ? numBands : entryBand[id];
+
+    if (taken) {
+        takenInBand[band]++;
+        wrongTargetInBand[band] += id != -1 && targetAddr != 0 && entryTarget[id] != targetAddr;
+    } else {
+        notTakenInBand[band]++;
+        notTakenTotal++;
+
+        // A not-taken branch is never allocated, on a hit it only refreshes its recency
+        if (id != -1) {
+            entryTime[id] = clock;
+            siftDown(band, entryHeapPos[id]);
+        }
+        return;
+    }
+
+    if (numBands == 0) {
+        return;
+    }
+
+    // Take the branch out of its band (leaving the hole the carried entries end in) and put it on top
+    if (id != -1) {
+        heapRemove(band, id);
+    } else {
+        id = freeEntries.back();
+        freeEntries.pop_back();
+        entryAddr[id] = sourceAddr;
+        entries.set(sourceAddr, id);
+    }
+    entryTime[id] = clock;
+    entryTarget[id] = targetAddr;
+
+    int carry = id;
+    for (int b = 0; b < band; b++) {
+        std::vector<int>& heap = bands[b];
+        if (static_cast<int>(heap.size()) < bandCapacity(b)) {
+            // Room left in this band, so every band below it is empty
+            heapPush(b, carry);
+            return;
+        }
+        // The older of the carried entry and this band's oldest is what a BTB ending here evicts
+        int oldest = heap[0];
+        if (entryTime[oldest] < entryTime[carry]) {
+            heap[0] = carry;
+            entryBand[carry] = b;
+            siftDown(b, 0);
+            carry = oldest;
+        }
+    }
+
+    if (band < numBands) {
+        heapPush(band, carry); // Fill the hole the branch left
+    } else {
+        // Fell off the bottom of the largest BTB
+        entries.erase(entryAddr[carry]);
+        freeEntries.push_back(carry);
+    }
+}
+
+long long StackDistanceProfiler::countUpTo(const std::vector<long long>& perBand, int capacity) const {
+    // A BTB of this capacity holds every band above its boundary
+    long long count = 0;
+    if (capacity <= 0) {
+        return 0;
+    }
+    int last = std::min(bandOf(capacity), static_cast<int>(capacities.size()) - 1);
+    for (int band = 0; band <= last; band++) {
+        count += perBand[band];
+    }
+    return count;
+}
+
+long long StackDistanceProfiler::btbHits(int capacity) const {
+    return countUpTo(takenInBand, capacity) + countUpTo(notTakenInBand, capacity);
+}
+
+long long StackDistanceProfiler::btbMisses(int capacity) const {
+    return totalAccesses - btbHits(capacity);
+}
+
+long long StackDistanceProfiler::staticPredictionHits(int capacity) const {
+    // Hits on taken branches plus misses on not-taken branches
+    return countUpTo(takenInBand, capacity) + (notTakenTotal - btbHitButMispredicted(capacity));
+}
+
+long long StackDistanceProfiler::btbHitButMispredicted(int capacity) const {
+    return countUpTo(notTakenInBand, capacity);
+}
+
+long long StackDistanceProfiler::takenWrongTarget(int capacity) const {
+    return countUpTo(wrongTargetInBand, capacity);
+}
@@ -0,0 +1,174 @@
+/*
+* Statistics registry and its JSON/CSV writers. The reports printed for people stay as they
+* were; these files are what scripts should read instead of scraping them.
+*
+*/
+#include "../include/StatsRegistry.h"
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace {
+
+void writeJsonString(std::ostream& out, const std::string& text) {
+    out << '"';
+    for (char c : text) {
+        switch (c) {
+            case '"': out << "\\\""; break;
+            case '\\': out << "\\\\"; break;
+            case '\n': out << "\\n"; break;
+            case '\t': out << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    const char* hex = "0123456789abcdef";
+                    out << "\\u00" << hex[(c >> 4) & 0xF] << hex[c & 0xF];
+                } else {
+                    out << c;
+                }
+        }
+    }
+    out << '"';
+}
+
+void writeCsvField(std::ostream& out, const std::string& text) {
+    if (text.find_first_of(",\"\n") == std::string::npos) {
+        out << text;
+        return;
+    }
+    out << '"';
+    for (char c : text) {
+        out << (c == '"' ? "\"\"" : std::string(1, c));
+    }
+    out << '"';
+}
+
+}
+
+StatsRegistry::Entry* StatsRegistry::find(const std::string& name) {
+    for (Entry& entry : entries) {
+        if (entry.name == name) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+void StatsRegistry::set(const std::string& name, Kind kind, uint64_t value, const std::string& text) {
+    if (Entry* entry = find(name)) {
+        *entry = Entry{name, kind, value, text};
+    } else {
+        entries.push_back(Entry{name, kind, value, text});
+    }
+}
+
+void StatsRegistry::merge(const StatsRegistry& other) {
+    for (const Entry& theirs : other.entries) {
+        Entry* ours = find(theirs.name);
+        if (!ours) {
+            entries.push_back(theirs);
+        } else if (ours->kind == Kind::COUNTER && theirs.kind == Kind::COUNTER) {
+            ours->value += theirs.value;
+        }
+    }
+}
+
+void writeStatsJson(std::ostream& out, const std::vector<StatsRegistry>& runs) {
+    out << "{\n  \"runs\": [";
+    for (size_t run = 0; run < runs.size(); run++) {
+        out << (run > 0 ? ",\n    {" : "\n    {");
+        const std::vector<StatsRegistry::Entry>& entries = runs[run].getEntries();
+        for (size_t i = 0; i < entries.size(); i++) {
+            const StatsRegistry::Entry& entry = entries[i];
+            out << (i > 0 ? ", " : "");
+            writeJsonString(out, entry.name);
+            out << ": ";
+            if (entry.kind == StatsRegistry::Kind::TEXT) {
+                writeJsonString(out, entry.text);
+            } else {
+                out << entry.value;
+            }
+        }
+        out << "}";
+    }
+    out << (runs.empty() ? "]\n}\n" : "\n  ]\n}\n");
+}
+
+void writeStatsCsv(std::ostream& out, const std::vector<StatsRegistry>& runs) {
+    std::vector<std::string> columns;
+    for (const StatsRegistry& run : runs) {
+        for (const StatsRegistry::Entry& entry : run.getEntries()) {
+            bool known = false;
+            for (const std::string& column : columns) {
+                known = known || column == entry.name;
+            }
+            if (!known) {
+                columns.push_back(entry.name);
+            }
+        }
+    }
+
+    for (size_t c = 0; c < columns.size(); c++) {
+        out << (c > 0 ? "," : "");
+        writeCsvField(out, columns[c]);
+    }
+    out << "\n";
+    for (const StatsRegistry& run : runs) {
+        const std::vector<StatsRegistry::Entry>& entries = run.getEntries();
+        for (size_t c = 0; c < columns.size(); c++) {
+            out << (c > 0 ? "," : "");
+            for (const StatsRegistry::Entry& entry : entries) {
+                if (entry.name != columns[c]) {
+                    continue;
+                }
+                if (entry.kind == StatsRegistry::Kind::TEXT) {
+                    writeCsvField(out, entry.text);
+                } else {
+                    out << entry.value;
+                }
+                break;
+            }
+        }
+        out << "\n";
+    }
+}
+
+bool extractStatsOutput(int& argc, char* argv[], StatsOutput& output) {
+    int kept = 0;
+    for (int i = 0; i < argc; i++) {
+        bool json = std::strcmp(argv[i], "--stats-json") == 0;
+        bool csv = std::strcmp(argv[i], "--stats-csv") == 0;
+        if (!json && !csv) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Error: " << argv[i] << " needs a file name" << std::endl;
+            return false;
+        }
+        (json ? output.jsonFile : output.csvFile) = argv[++i];
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return true;
+}
+
+bool writeStatsOutput(const StatsOutput& output, const std::vector<StatsRegistry>& runs) {
+    bool ok = true;
+    if (!output.jsonFile.empty()) {
+        std::ofstream out(output.jsonFile);
+        writeStatsJson(out, runs);
+        if (!out) {
+            std::cerr << "Error: Unable to write " << output.jsonFile << std::endl;
+            ok = false;
+        }
+    }
+    if (!output.csvFile.empty()) {
+        std::ofstream out(output.csvFile);
+        writeStatsCsv(out, runs);
+        if (!out) {
+            std::cerr << "Error: Unable to write " << output.csvFile << std::endl;
+            ok = false;
+        }
+    }
+    return ok;
+}
@@ -0,0 +1,255 @@
+/*
+* Multi-configuration sweep. The trace is parsed once and every BTB size / predictor pair is
+* driven over the same instruction batch, block by block, so one run replaces a process per size.
+* Static predictors on fully associative LRU BTBs come from the stack-distance profiler, which gives
+* the result for every requested capacity from a single walk of the trace.
+*
+*/
+#include "../include/SweepRunner.h"
+#include "../include/BTBHierarchy.h"
+#include "../include/BranchPredictor.h"
+#include "../include/PredictorRegistry.h"
+#include "../include/TraceStream.h"
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <utility>
+
+namespace {
+
+// Instructions handed to each configuration at a time
+const size_t SWEEP_BLOCK_SIZE = 4096;
+
+bool isFullyAssociativeLRU(const BTBConfig& config) {
+    return config.policy == ReplacementPolicy::LRU && config.rasDepth == 0 && config.indirectEntries == 0 &&
+           config.fasterLevels.empty() && (config.associativity <= 0 || config.associativity >= config.entries);
+}
+
+std::vector<std::string> splitList(const std::string& list) {
+    std::vector<std::string> items;
+    std::stringstream stream(list);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+double percent(long long part, long long total) {
+    return total > 0 ? (double)part / total * 100.0 : 0.0;
+}
+
+}
+
+SweepRunner::SweepRunner(const std::vector<SweepConfig>& configs) : configs(configs) {
+    std::vector<int> profiledCapacities;
+    for (int i = 0; i < (int)configs.size(); i++) {
+        const SweepConfig& config = configs[i];
+        if (config.predictor.name == StaticPredictor::name() && config.predictor.params.empty() && isFullyAssociativeLRU(config.btb)) {
+            profiledConfigs.push_back(i);
+            profiledCapacities.push_back(config.btb.entries);
+        } else if (std::unique_ptr<SweepTarget> target = makeSweepTarget(config.predictor, config.btb, arena)) {
+            targetConfigs.push_back(i);
+            targets.push_back(std::move(target));
+        }
+    }
+    if (!profiledConfigs.empty()) {
+        profiler.reset(new StackDistanceProfiler(profiledCapacities));
+    }
+}
+
+void SweepRunner::simulateBatch(const InstructionBatch& instructions) {
+    for (size_t start = 0; start < instructions.size(); start += SWEEP_BLOCK_SIZE) {
+        size_t end = std::min(instructions.size(), start + SWEEP_BLOCK_SIZE);
+
+        if (profiler) {
+            for (size_t i = start; i < end; i++) {
+                profiler->access(instructions.sourceAddr(i), instructions.taken(i), instructions.targetAddr(i));
+            }
+        }
+        for (auto& target : targets) {
+            target->simulateBlock(instructions, start, end - start);
+        }
+    }
+}
+
+void SweepRunner::finish() {
+    results.assign(configs.size(), SweepResult());
+    for (int i = 0; i < (int)configs.size(); i++) {
+        results[i].config = configs[i];
+    }
+
+    if (profiler) {
+        for (int index : profiledConfigs) {
+            SweepResult& result = results[index];
+            int capacity = configs[index].btb.entries;
+            result.instructions = profiler->getAccesses();
+            result.btbHits = profiler->btbHits(capacity);
+            result.btbMisses = profiler->btbMisses(capacity);
+            result.staticPredictionHits = profiler->staticPredictionHits(capacity);
+            result.predictionHits = result.staticPredictionHits;
+            result.btbHitButMispredicted = profiler->btbHitButMispredicted(capacity);
+            result.fromStackDistance = true;
+
+            // Static prediction is taken iff in the BTB, so it never needs a decode redirect: a
+            // taken hit costs the BTB latency, a stale target or a wrong direction a flush
+            const BTBConfig& btb = configs[index].btb;
+            long long takenHits = result.btbHits - result.btbHitButMispredicted;
+            long long wrongTargets = profiler->takenWrongTarget(capacity);
+            long long flushes = (result.instructions - result.staticPredictionHits) + wrongTargets;
+            long long bubbles = (takenHits - wrongTargets) * btb.latency;
+            result.lostCycles = bubbles + flushes * btb.timing.flushPenalty;
+
+            result.stats.counter("instructions", static_cast<uint64_t>(result.instructions));
+            result.stats.counter("btb.hits", static_cast<uint64_t>(result.btbHits));
+            result.stats.counter("btb.misses", static_cast<uint64_t>(result.btbMisses));
+            result.stats.counter("prediction.hits", static_cast<uint64_t>(result.predictionHits));
+            result.stats.counter("prediction.misses", static_cast<uint64_t>(result.instructions - result.predictionHits));
+            result.stats.counter("static.hits", static_cast<uint64_t>(result.staticPredictionHits));
+            result.stats.counter("btb.hit_but_mispredicted", static_cast<uint64_t>(result.btbHitButMispredicted));
+            result.stats.counter("frontend.bubble_cycles", static_cast<uint64_t>(bubbles));
+            result.stats.counter("frontend.redirects", 0);
+            result.stats.counter("frontend.flushes", static_cast<uint64_t>(flushes));
+            result.stats.counter("frontend.lost_cycles", static_cast<uint64_t>(result.lostCycles));
+        }
+    }
+    for (size_t t = 0; t < targets.size(); t++) {
+        targets[t]->collect(results[targetConfigs[t]]);
+    }
+}
+
+void printResultHeader() {
+    std::cout << std::left << std::setw(16) << "predictor" << std::right
+              << std::setw(9) << "entries" << std::setw(6) << "ways" << std::setw(8) << "policy"
+              << std::setw(14) << "instructions" << std::setw(12) << "btb_hits" << std::setw(12) << "btb_misses"
+              << std::setw(14) << "btb_hit_rate" << std::setw(10) << "accuracy" << std::setw(17) << "static_accuracy"
+              << std::setw(22) << "hit_but_mispredicted" << std::setw(8) << "levels" << std::setw(10) << "ipc_loss"
+              << std::setw(8) << "method" << std::endl;
+}
+
+void printResultRow(const SweepResult& result) {
+    const BTBConfig& btb = result.config.btb;
+    std::string ways = (btb.associativity <= 0 || btb.associativity >= btb.entries) ? "full" : std::to_string(btb.associativity);
+    std::ostringstream row;
+    row << std::left << std::setw(16) << predictorConfigName(result.config.predictor) << std::right
+        << std::setw(9) << btb.entries << std::setw(6) << ways << std::setw(8) << replacementPolicyName(btb.policy)
+        << std::setw(14) << result.instructions << std::setw(12) << result.btbHits << std::setw(12) << result.btbMisses
+        << std::fixed << std::setprecision(2)
+        << std::setw(14) << percent(result.btbHits, result.btbHits + result.btbMisses)
+        << std::setw(10) << percent(result.predictionHits, result.instructions)
+        << std::setw(17) << percent(result.staticPredictionHits, result.instructions)
+        << std::setw(22) << result.btbHitButMispredicted
+        << std::setw(8) << btb.fasterLevels.size() + 1
+        << std::setw(10) << ipcLossPercent(btb.timing, result.instructions, result.lostCycles)
+        << std::setw(8) << (result.fromStackDistance ? "stack" : "sim");
+    std::cout << row.str() << std::endl;
+}
+
+void registerConfigStats(const SweepConfig& config, StatsRegistry& stats) {
+    const BTBConfig& btb = config.btb;
+    bool fullyAssociative = btb.associativity <= 0 || btb.associativity >= btb.entries;
+    stats.label("predictor", predictorConfigName(config.predictor));
+    stats.label("btb.entries", static_cast<uint64_t>(btb.entries));
+    stats.label("btb.ways", static_cast<uint64_t>(fullyAssociative ? btb.entries : btb.associativity));
+    stats.label("btb.policy", replacementPolicyName(btb.policy));
+    if (btb.rasDepth > 0) {
+        stats.label("ras.depth", static_cast<uint64_t>(btb.rasDepth));
+    }
+    if (btb.indirectEntries > 0) {
+        stats.label("indirect.entries", static_cast<uint64_t>(btb.indirectEntries));
+    }
+    stats.label("btb.latency", static_cast<uint64_t>(btb.latency));
+    for (size_t i = 0; i < btb.fasterLevels.size(); i++) {
+        const BTBLevelConfig& level = btb.fasterLevels[i];
+        std::string prefix = "btb.l" + std::to_string(i);
+        bool levelFull = level.associativity <= 0 || level.associativity >= level.entries;
+        stats.label(prefix + ".entries", static_cast<uint64_t>(level.entries));
+        stats.label(prefix + ".ways", static_cast<uint64_t>(levelFull ? level.entries : level.associativity));
+        stats.label(prefix + ".policy", replacementPolicyName(level.policy));
+        stats.label(prefix + ".latency", static_cast<uint64_t>(level.latency));
+    }
+    if (!btb.fasterLevels.empty()) {
+        stats.label("btb.fill", fillPolicyName(btb.fill));
+        stats.label("btb.promotion", promotionName(btb.promotion));
+    }
+    stats.label("frontend.redirect_penalty", static_cast<uint64_t>(btb.timing.redirectPenalty));
+    stats.label("frontend.flush_penalty", static_cast<uint64_t>(btb.timing.flushPenalty));
+    stats.label("frontend.instructions_per_branch", static_cast<uint64_t>(btb.timing.instructionsPerBranch));
+    stats.label("frontend.fetch_width", static_cast<uint64_t>(btb.timing.fetchWidth));
+}
+
+StatsRegistry resultStats(const SweepResult& result) {
+    StatsRegistry stats;
+    registerConfigStats(result.config, stats);
+    stats.label("method", result.fromStackDistance ? "stack" : "sim");
+    stats.merge(result.stats);
+    return stats;
+}
+
+void SweepRunner::printTable() const {
+    printResultHeader();
+    for (const SweepResult& result : results) {
+        printResultRow(result);
+    }
+}
+
+int runSweepCommand(int argc, char* argv[], const StatsOutput& statsOutput) {
+    if (argc < 4) {
+        std::cerr << "Usage: " << argv[0] << " --sweep <trace_file> <btb_spec>[,<btb_spec>...] [predictor[,predictor...]]" << std::endl;
+        std::cerr << "       btb_spec = entries[:associativity[:lru|plru|random[:lat<cycles>]]], faster levels first joined by '+'" << std::endl;
+        std::cerr << predictorUsage() << std::endl;
+        return 1;
+    }
+
+    std::string traceFile = argv[2];
+    std::vector<std::string> predictors = splitList(argc > 4 ? argv[4] : "static,twobit");
+
+    std::vector<SweepConfig> configs;
+    for (const std::string& predictorSpec : predictors) {
+        PredictorConfig predictor;
+        if (!parsePredictorConfig(predictorSpec, predictor)) {
+            std::cerr << "Error: Invalid predictor spec " << predictorSpec << std::endl;
+            return 1;
+        }
+        if (!validatePredictorConfig(predictor)) {
+            return 1;
+        }
+        for (const std::string& spec : splitList(argv[3])) {
+            SweepConfig config;
+            config.predictor = predictor;
+            if (!parseBTBConfig(spec, config.btb)) {
+                std::cerr << "Error: Invalid BTB spec " << spec << std::endl;
+                return 1;
+            }
+            configs.push_back(config);
+        }
+    }
+
+    TraceStream stream(traceFile);
+    if (!stream.isOpen()) {
+        return 1;
+    }
+
+    // Every configuration sees each batch before the next one is parsed
+    SweepRunner runner(configs);
+    while (const InstructionBatch* batch = stream.next()) {
+        runner.simulateBatch(*batch);
+    }
+    runner.finish();
+
+    stream.printParseStats();
+    std::cout << "Swept " << configs.size() << " configurations over " << stream.getInstructionsRead()
+              << " instructions" << std::endl;
+    runner.printTable();
+
+    std::vector<StatsRegistry> runs;
+    for (const SweepResult& result : runner.getResults()) {
+        runs.push_back(StatsRegistry());
+        runs.back().label("trace", traceFile);
+        runs.back().merge(resultStats(result));
+    }
+    return writeStatsOutput(statsOutput, runs) ? 0 : 1;
+}
@@ -0,0 +1,130 @@
+/*
+* Tag search across the ways of a BTB set. The tags of a set are contiguous ints, so an x86
+* vector register compares four (SSE2) or eight (AVX2) of them at once and a movemask turns the
+* result into a bitmask of matching ways. The vector paths are compiled with target attributes
+* rather than build-wide -m flags, so one binary runs everywhere and picks the widest path the
+* CPU has when the first BTB is built.
+*
+*/
+#include "../include/TagSearch.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define BRANCHSIM_X86_TAG_SEARCH
+#include <immintrin.h>
+#endif
+
+int findTagScalar(const int* tags, int count, int tag) {
+    for (int way = 0; way < count; way++) {
+        if (tags[way] == tag) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+#ifdef BRANCHSIM_X86_TAG_SEARCH
+
+namespace {
+
+// Tags are unique within a set, so the lowest set bit is the only match
+__attribute__((target("sse2")))
+int findTagSSE2(const int* tags, int count, int tag) {
+    const __m128i key = _mm_set1_epi32(tag);
+    int way = 0;
+    for (; way + 4 <= count; way += 4) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + way));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, key)));
+        if (mask != 0) {
+            return way + __builtin_ctz(mask);
+        }
+    }
+    // A partly filled set or an associativity that is not a multiple of four
+    for (; way < count; way++) {
+        if (tags[way] == tag) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+__attribute__((target("avx2")))
+int findTagAVX2(const int* tags, int count, int tag) {
+    const __m256i key = _mm256_set1_epi32(tag);
+    int way = 0;
+    for (; way + 8 <= count; way += 8) {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(tags + way));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(chunk, key)));
+        if (mask != 0) {
+            return way + __builtin_ctz(mask);
+        }
+    }
+    if (way + 4 <= count) {
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(tags + way));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(chunk, _mm256_castsi256_si128(key))));
+        if (mask != 0) {
+            return way + __builtin_ctz(mask);
+        }
+        way += 4;
+    }
+    for (; way < count; way++) {
+        if (tags[way] == tag) {
+            return way;
+        }
+    }
+    return -1;
+}
+
+}
+
+// __builtin_cpu_init makes the CPU query safe even from a static initialiser
+TagSearchFunction sse2TagSearch() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2") ? findTagSSE2 : nullptr;
+}
+
+TagSearchFunction avx2TagSearch() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? findTagAVX2 : nullptr;
+}
+
+#else
+
+TagSearchFunction sse2TagSearch() {
+    return nullptr;
+}
+
+TagSearchFunction avx2TagSearch() {
+    return nullptr;
+}
+
+#endif
+
+namespace {
+
+struct TagSearchChoice {
+    TagSearchFunction search;
+    const char* name;
+};
+
+const TagSearchChoice& chooseTagSearch() {
+    static const TagSearchChoice choice = [] {
+        if (TagSearchFunction search = avx2TagSearch()) {
+            return TagSearchChoice{search, "avx2"};
+        }
+        if (TagSearchFunction search = sse2TagSearch()) {
+            return TagSearchChoice{search, "sse2"};
+        }
+        return TagSearchChoice{findTagScalar, "scalar"};
+    }();
+    return choice;
+}
+
+}
+
+TagSearchFunction bestTagSearch() {
+    return chooseTagSearch().search;
+}
+
+const char* bestTagSearchName() {
+    return chooseTagSearch().name;
+}
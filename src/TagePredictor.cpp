@@ -0,0 +1,237 @@
+/*
+* TAGE direction predictor. Every lookup hashes the branch address with each table's folded
+* history, so a prediction costs O(tables) however long the histories are. The folded histories
+* are shifted by one bit per branch, with the bit that falls out of each history removed again
+* using the ring buffer of raw outcomes.
+* Update follows the usual TAGE rules: train the provider (and the alternate while the provider
+* is not yet useful), adjust usefulness when provider and alternate disagree, allocate in a longer
+* table on a misprediction, and periodically age every usefulness counter.
+*
+*/
+#include "../include/TagePredictor.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+const int TAGE_BASE_BITS = 13;
+const int TAGE_PATH_BITS = 16;
+const uint64_t TAGE_USEFUL_RESET_PERIOD = 1 << 18;
+
+int8_t saturate(int value, int low, int high) {
+    return static_cast<int8_t>(std::max(low, std::min(high, value)));
+}
+
+}
+
+TagePredictor::TagePredictor(const BTBConfig&, const PredictorConfig& config, Arena& arena)
+    : numTables(config.param(0, 7)), tableBits(config.param(1, 10)),
+      tableMask(static_cast<uint32_t>((1u << tableBits) - 1)), base(TAGE_BASE_BITS, arena),
+      historyHead(0), pathHistory(0), useAltOnNew(0), randomState(0x2545F491u), updates(0),
+      provider(-1), alternate(-1), providerPrediction(false), alternatePrediction(false), prediction(false) {
+    int minHistory = config.param(2, 5);
+    int maxHistory = config.param(3, 200);
+
+    entries = ArenaArray<Entry>(arena, static_cast<size_t>(numTables) << tableBits, Entry{0, 0, 0});
+    history = ArenaArray<uint8_t>(arena, TAGE_MAX_HISTORY, 0);
+
+    for (int i = 0; i < numTables; i++) {
+        // Geometric series from minHistory to maxHistory
+        double ratio = numTables > 1 ? static_cast<double>(i) / (numTables - 1) : 0.0;
+        historyLength[i] = static_cast<int>(minHistory * std::pow(static_cast<double>(maxHistory) / minHistory, ratio) + 0.5);
+        tagBits[i] = 8 + (numTables > 1 ? i * 6 / (numTables - 1) : 0); // Longer histories get wider tags
+        indexFold[i].init(historyLength[i], tableBits);
+        tagFold[i].init(historyLength[i], tagBits[i]);
+        tagFoldShort[i].init(historyLength[i], tagBits[i] - 1);
+        indices[i] = 0;
+        tags[i] = 0;
+    }
+}
+
+void TagePredictor::computeIndices(uint32_t pc) {
+    for (int i = 0; i < numTables; i++) {
+        uint32_t path = pathHistory & ((1u << std::min(TAGE_PATH_BITS, historyLength[i])) - 1);
+        uint32_t index = pc ^ (pc >> (std::abs(tableBits - i) + 1)) ^ indexFold[i].value ^ path ^ (path >> tableBits);
+        indices[i] = (static_cast<uint32_t>(i) << tableBits) | (index & tableMask);
+        tags[i] = static_cast<uint16_t>((pc ^ tagFold[i].value ^ (tagFoldShort[i].value << 1)) & ((1u << tagBits[i]) - 1));
+    }
+}
+
+bool TagePredictor::predict(int sourceAddr, bool) {
+    uint32_t pc = static_cast<uint32_t>(sourceAddr) >> 2;
+    computeIndices(pc);
+
+    provider = -1;
+    alternate = -1;
+    for (int i = numTables - 1; i >= 0; i--) {
+        if (entries[indices[i]].tag == tags[i]) {
+            if (provider < 0) {
+                provider = i;
+            } else {
+                alternate = i;
+                break;
+            }
+        }
+    }
+
+    alternatePrediction = alternate >= 0 ? entries[indices[alternate]].counter >= 0 : base.predict(pc);
+    if (provider < 0) {
+        providerPrediction = alternatePrediction;
+        prediction = alternatePrediction;
+        return prediction;
+    }
+
+    const Entry& entry = entries[indices[provider]];
+    providerPrediction = entry.counter >= 0;
+    // A fresh entry has not proven itself yet, the alternate is often better
+    bool newlyAllocated = weak(entry) && entry.useful == 0;
+    prediction = newlyAllocated && useAltOnNew >= 0 ? alternatePrediction : providerPrediction;
+    return prediction;
+}
+
+void TagePredictor::allocate(bool taken) {
+    int start = provider + 1;
+    if (start >= numTables) {
+        return;
+    }
+
+    // Prefer the shortest free table, sometimes the next one so allocations spread out
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    if ((randomState & 1) && start + 1 < numTables && entries[indices[start]].useful == 0 &&
+        entries[indices[start + 1]].useful == 0) {
+        start++;
+    }
+
+    for (int i = start; i < numTables; i++) {
+        Entry& entry = entries[indices[i]];
+        if (entry.useful == 0) {
+            entry.tag = tags[i];
+            entry.counter = taken ? 0 : -1;
+            return;
+        }
+    }
+
+    // Nothing free: age the candidates so a later misprediction can take one
+    for (int i = start; i < numTables; i++) {
+        entries[indices[i]].useful--;
+    }
+}
+
+void TagePredictor::updateHistories(uint32_t pc, bool taken) {
+    historyHead = (historyHead - 1) & (TAGE_MAX_HISTORY - 1);
+    history[historyHead] = taken;
+    for (int i = 0; i < numTables; i++) {
+        uint32_t oldBit = history[(historyHead + historyLength[i]) & (TAGE_MAX_HISTORY - 1)];
+        indexFold[i].update(taken, oldBit);
+        tagFold[i].update(taken, oldBit);
+        tagFoldShort[i].update(taken, oldBit);
+    }
+    pathHistory = ((pathHistory << 1) | (pc & 1)) & ((1u << TAGE_PATH_BITS) - 1);
+}
+
+void TagePredictor::update(int sourceAddr, bool taken) {
+    uint32_t pc = static_cast<uint32_t>(sourceAddr) >> 2;
+
+    if (prediction != taken) {
+        allocate(taken);
+    }
+
+    if (provider >= 0) {
+        Entry& entry = entries[indices[provider]];
+        if (weak(entry) && entry.useful == 0 && providerPrediction != alternatePrediction) {
+            useAltOnNew = saturate(useAltOnNew + (alternatePrediction == taken ? 1 : -1), -8, 7);
+        }
+
+        // Keep the alternate trained while the provider has not shown it is useful
+        if (entry.useful == 0) {
+            if (alternate >= 0) {
+                Entry& alt = entries[indices[alternate]];
+                alt.counter = saturate(alt.counter + (taken ? 1 : -1), -4, 3);
+            } else {
+                base.update(pc, taken);
+            }
+        }
+
+        entry.counter = saturate(entry.counter + (taken ? 1 : -1), -4, 3);
+        if (providerPrediction != alternatePrediction) {
+            entry.useful = static_cast<uint8_t>(saturate(entry.useful + (providerPrediction == taken ? 1 : -1), 0, 3));
+        }
+    } else {
+        base.update(pc, taken);
+    }
+
+    // Halve every usefulness counter now and then so stale entries can be replaced
+    if (++updates % TAGE_USEFUL_RESET_PERIOD == 0) {
+        for (Entry& entry : entries) {
+            entry.useful >>= 1;
+        }
+    }
+
+    updateHistories(pc, taken);
+}
+
+void TagePredictor::registerStats(StatsRegistry& stats) const {
+    stats.label("tage.tables", static_cast<uint64_t>(numTables));
+    stats.label("tage.table_entries", static_cast<uint64_t>(1) << tableBits);
+    stats.label("tage.min_history", static_cast<uint64_t>(historyLength[0]));
+    stats.label("tage.max_history", static_cast<uint64_t>(historyLength[numTables - 1]));
+}
+
+void TagePredictor::saveState(CheckpointWriter& out) const {
+    out.put<int32_t>(numTables);
+    out.put<int32_t>(tableBits);
+    for (int i = 0; i < numTables; i++) {
+        out.put<int32_t>(historyLength[i]);
+    }
+    base.saveState(out);
+    out.put<uint64_t>(entries.size());
+    for (const Entry& entry : entries) {
+        out.put(entry.tag);
+        out.put(entry.counter);
+        out.put(entry.useful);
+    }
+    out.putVector(history);
+    out.put(historyHead);
+    out.put(pathHistory);
+    for (int i = 0; i < numTables; i++) {
+        out.put(indexFold[i].value);
+        out.put(tagFold[i].value);
+        out.put(tagFoldShort[i].value);
+    }
+    out.put<int32_t>(useAltOnNew);
+    out.put(randomState);
+    out.put(updates);
+}
+
+bool TagePredictor::loadState(CheckpointReader& in) {
+    if (!in.expect<int32_t>(numTables, "tage table count") || !in.expect<int32_t>(tableBits, "tage table bits")) {
+        return false;
+    }
+    for (int i = 0; i < numTables; i++) {
+        if (!in.expect<int32_t>(historyLength[i], "tage history length")) {
+            return false;
+        }
+    }
+    if (!base.loadState(in) || !in.expect<uint64_t>(entries.size(), "tage entry count")) {
+        return false;
+    }
+    for (Entry& entry : entries) {
+        in.get(entry.tag);
+        in.get(entry.counter);
+        in.get(entry.useful);
+    }
+    in.getVector(history);
+    in.get(historyHead);
+    in.get(pathHistory);
+    for (int i = 0; i < numTables; i++) {
+        in.get(indexFold[i].value);
+        in.get(tagFold[i].value);
+        in.get(tagFoldShort[i].value);
+    }
+    in.get(useAltOnNew);
+    in.get(randomState);
+    in.get(updates);
+    return in.ok();
+}
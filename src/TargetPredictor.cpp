@@ -0,0 +1,133 @@
+/*
+* Target prediction for the branches the BTB handles badly. Returns come from a return address
+* stack and indirect branches from a path-history indexed target cache, so neither occupies BTB
+* entries when its predictor is enabled, and every class is scored on its own.
+*
+*/
+#include "../include/TargetPredictor.h"
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+const char* branchClassName(BranchClass branchClass) {
+    switch (branchClass) {
+        case BranchClass::DIRECT: return "direct";
+        case BranchClass::CALL: return "call";
+        case BranchClass::RETURN: return "return";
+        case BranchClass::INDIRECT: return "indirect";
+    }
+    return "unknown";
+}
+
+ReturnAddressStack::ReturnAddressStack(int depth, Arena& arena)
+    : entries(arena, depth > 0 ? depth : 1, 0), top(0), count(0), overflows(0), underflows(0) {}
+
+void ReturnAddressStack::registerStats(StatsRegistry& stats) const {
+    stats.counter("ras.overflows", overflows);
+    stats.counter("ras.underflows", underflows);
+}
+
+void ReturnAddressStack::resetStatistics() {
+    overflows = 0;
+    underflows = 0;
+}
+
+void ReturnAddressStack::saveState(CheckpointWriter& out) const {
+    out.put<int32_t>(getDepth());
+    out.putVector(entries);
+    out.put<int32_t>(top);
+    out.put<int32_t>(count);
+}
+
+bool ReturnAddressStack::loadState(CheckpointReader& in) {
+    if (!in.expect<int32_t>(getDepth(), "return address stack depth")) {
+        return false;
+    }
+    in.getVector(entries);
+    in.get(top);
+    in.get(count);
+    if (in.ok() && (top < 0 || top >= getDepth() || count < 0 || count > getDepth())) {
+        in.fail("Checkpoint return address stack position " + std::to_string(top) + " with " + std::to_string(count) +
+                " entries does not fit its depth of " + std::to_string(getDepth()));
+    }
+    return in.ok();
+}
+
+IndirectTargetCache::IndirectTargetCache(int entries, Arena& arena) : mask(0), path(0) {
+    uint32_t size = 1;
+    while (size < static_cast<uint32_t>(entries > 0 ? entries : 1)) {
+        size <<= 1;
+    }
+    tags = ArenaArray<int>(arena, size, -1);
+    targets = ArenaArray<int>(arena, size, 0);
+    mask = size - 1;
+}
+
+void IndirectTargetCache::saveState(CheckpointWriter& out) const {
+    out.put<int32_t>(getEntries());
+    out.putVector(tags);
+    out.putVector(targets);
+    out.put(path);
+}
+
+bool IndirectTargetCache::loadState(CheckpointReader& in) {
+    if (!in.expect<int32_t>(getEntries(), "indirect target cache size")) {
+        return false;
+    }
+    in.getVector(tags);
+    in.getVector(targets);
+    in.get(path);
+    return in.ok();
+}
+
+void registerTargetStats(const TargetCounters* counters, StatsRegistry& stats) {
+    for (int c = 0; c < BRANCH_CLASS_COUNT; c++) {
+        std::string prefix = std::string("target.") + branchClassName(static_cast<BranchClass>(c));
+        stats.counter(prefix + ".executions", counters[c].executions);
+        stats.counter(prefix + ".taken", counters[c].taken);
+        stats.counter(prefix + ".hits", counters[c].hits);
+    }
+}
+
+void printTargetStats(std::ostream& out, const TargetCounters* counters) {
+    std::ostringstream report;
+    report << "Target prediction by branch class:" << std::endl;
+    report << std::fixed << std::setprecision(2);
+    for (int c = 0; c < BRANCH_CLASS_COUNT; c++) {
+        const TargetCounters& counter = counters[c];
+        if (counter.executions == 0) {
+            continue;
+        }
+        double accuracy = counter.taken > 0 ? (double)counter.hits / counter.taken * 100.0 : 0.0;
+        report << "  " << std::left << std::setw(9) << branchClassName(static_cast<BranchClass>(c)) << std::right
+               << counter.executions << " executed, " << counter.taken << " taken, target accuracy " << accuracy
+               << "%" << std::endl;
+    }
+    out << report.str();
+}
+
+bool extractTargetOptions(int& argc, char* argv[], BTBConfig& config) {
+    int kept = 0;
+    for (int i = 0; i < argc; i++) {
+        bool ras = std::strcmp(argv[i], "--ras") == 0;
+        bool indirect = std::strcmp(argv[i], "--indirect") == 0;
+        if (!ras && !indirect) {
+            argv[kept++] = argv[i];
+            continue;
+        }
+        char* end = nullptr;
+        long value = i + 1 < argc ? std::strtol(argv[i + 1], &end, 10) : 0;
+        if (i + 1 >= argc || *end != '\0' || value <= 0) {
+            std::cerr << "Error: " << argv[i] << " needs a positive number of entries" << std::endl;
+            return false;
+        }
+        (ras ? config.rasDepth : config.indirectEntries) = static_cast<int>(value);
+        i++;
+    }
+    argc = kept;
+    argv[argc] = nullptr;
+    return true;
+}
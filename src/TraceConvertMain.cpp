@@ -0,0 +1,99 @@
+#include "../include/BinaryTrace.h"
+#include "../include/TraceReader.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+/*
+* trace-convert: turns a text trace into the packed binary format once, so later runs skip
+* text parsing entirely. --to-text goes the other way for inspection.
+*
+*/
+
+namespace {
+
+int convertToText(const std::string& input, const std::string& output) {
+    BinaryTraceReader reader(input);
+    if (!reader.isOpen()) {
+        std::cerr << "Error: " << input << " is not a binary trace." << std::endl;
+        return 1;
+    }
+    FILE* out = std::fopen(output.c_str(), "w");
+    if (out == nullptr) {
+        std::cerr << "Error: Unable to open " << output << " for writing." << std::endl;
+        return 1;
+    }
+
+    std::vector<Instruction> block;
+    unsigned long index = 0;
+    while (reader.readBlock(block)) {
+        for (const Instruction& instr : block) {
+            const char* outcome = instr.taken ? "taken" : "not taken";
+            if (instr.type == 'B' || instr.targetAddr != 0) {
+                std::fprintf(out, "%c %08lx from %08x to %08x %c %s\n", instr.type, index,
+                             static_cast<unsigned>(instr.sourceAddr), static_cast<unsigned>(instr.targetAddr),
+                             instr.direction, outcome);
+            } else {
+                std::fprintf(out, "%c %08lx from %08x %s\n", instr.type, index,
+                             static_cast<unsigned>(instr.sourceAddr), outcome);
+            }
+            index++;
+        }
+    }
+    std::fclose(out);
+    std::cout << "Wrote " << index << " records to " << output << std::endl;
+    return 0;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc > 1 && std::string(argv[1]) == "--to-text") {
+        if (argc < 4) {
+            std::cerr << "Usage: " << argv[0] << " --to-text <binary_trace> <text_trace>" << std::endl;
+            return 1;
+        }
+        return convertToText(argv[2], argv[3]);
+    }
+
+    if (argc < 3) {
+        std::cerr << "Usage: " << argv[0] << " <text_trace> <binary_trace> [records_per_block]" << std::endl;
+        std::cerr << "       " << argv[0] << " --to-text <binary_trace> <text_trace>" << std::endl;
+        return 1;
+    }
+
+    std::string input = argv[1];
+    std::string output = argv[2];
+    uint32_t blockRecords = argc > 3 ? static_cast<uint32_t>(std::stoul(argv[3])) : BINARY_TRACE_DEFAULT_BLOCK;
+
+    auto start = std::chrono::steady_clock::now();
+    TraceReader reader(input);
+    if (!reader.open()) {
+        return 1;
+    }
+
+    BinaryTraceWriter writer(output, blockRecords);
+    if (!writer.isOpen()) {
+        std::cerr << "Error: Unable to open " << output << " for writing." << std::endl;
+        return 1;
+    }
+    std::vector<Instruction> batch;
+    while (reader.readBatch(batch, blockRecords) > 0) {
+        for (const Instruction& instr : batch) {
+            writer.write(instr);
+        }
+    }
+    if (!writer.close()) {
+        std::cerr << "Error: Failed writing " << output << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    BinaryTraceReader check(output);
+    std::cout << "Converted " << writer.getRecordCount() << " records in " << seconds << " s" << std::endl;
+    std::cout << "Text size: " << reader.getBytesParsed() << " bytes, binary size: " << check.getFileSize()
+              << " bytes (" << (check.getFileSize() > 0 ? (double)reader.getBytesParsed() / check.getFileSize() : 0.0)
+              << "x smaller)" << std::endl;
+    return 0;
+}
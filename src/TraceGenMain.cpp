@@ -0,0 +1,114 @@
+#include "../include/BinaryTrace.h"
+#include "../include/TraceGenerator.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+
+/*
+* trace-gen: writes reproducible traces for the simulator, either by walking an ARM execution
+* profile such as misc/instr_profile or from a synthetic program spec. Output ending in ".bpt"
+* is the packed binary format, anything else the text format.
+*
+*/
+
+namespace {
+
+const size_t GENERATE_BATCH = 65536;
+
+bool endsWith(const std::string& text, const std::string& suffix) {
+    return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+template <typename Writer>
+bool writeTrace(TraceGenerator& generator, Writer& writer, uint64_t records) {
+    std::vector<Instruction> batch(GENERATE_BATCH);
+    for (uint64_t written = 0; written < records;) {
+        size_t count = static_cast<size_t>(std::min<uint64_t>(GENERATE_BATCH, records - written));
+        generator.generate(batch.data(), count);
+        for (size_t i = 0; i < count; i++) {
+            writer.write(batch[i]);
+        }
+        written += count;
+    }
+    return writer.close();
+}
+
+int usage(const char* program) {
+    std::cerr << "Usage: " << program << " --profile <instr_profile> <output> <records> [seed]" << std::endl;
+    std::cerr << "       " << program << " --synthetic <spec|default> <output> <records> [seed]" << std::endl;
+    std::cerr << "       <output> ending in .bpt is written as a binary trace, anything else as text" << std::endl;
+    std::cerr << "       synthetic spec: key=value,... with keys functions, branches, loops, trip, bias," << std::endl;
+    std::cerr << "       random, calls, depth, indirect, targets" << std::endl;
+    return 1;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 5) {
+        return usage(argv[0]);
+    }
+    std::string mode = argv[1];
+    std::string input = argv[2];
+    std::string output = argv[3];
+    char* end = nullptr;
+    unsigned long long records = std::strtoull(argv[4], &end, 10);
+    if (*end != '\0' || records == 0) {
+        std::cerr << "Error: Invalid record count " << argv[4] << std::endl;
+        return 1;
+    }
+    uint32_t seed = argc > 5 ? static_cast<uint32_t>(std::stoul(argv[5])) : 1;
+
+    std::unique_ptr<TraceGenerator> generator;
+    if (mode == "--profile") {
+        std::unique_ptr<ProfileTraceGenerator> profile(new ProfileTraceGenerator(input, seed));
+        if (!profile->isValid()) {
+            return 1;
+        }
+        std::cout << "Profile: " << profile->getInstructionCount() << " instructions, " << profile->getBranchCount()
+                  << " branches" << std::endl;
+        generator = std::move(profile);
+    } else if (mode == "--synthetic") {
+        SyntheticSpec spec;
+        if (!parseSyntheticSpec(input, spec)) {
+            std::cerr << "Error: Invalid synthetic spec " << input << std::endl;
+            return 1;
+        }
+        generator.reset(new SyntheticTraceGenerator(spec, seed));
+    } else {
+        return usage(argv[0]);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    bool ok;
+    if (endsWith(output, ".bpt")) {
+        BinaryTraceWriter writer(output);
+        if (!writer.isOpen()) {
+            std::cerr << "Error: Unable to open " << output << " for writing." << std::endl;
+            return 1;
+        }
+        ok = writeTrace(*generator, writer, records);
+    } else {
+        TextTraceWriter writer(output);
+        if (!writer.isOpen()) {
+            std::cerr << "Error: Unable to open " << output << " for writing." << std::endl;
+            return 1;
+        }
+        ok = writeTrace(*generator, writer, records);
+    }
+    if (!ok) {
+        std::cerr << "Error: Failed writing " << output << std::endl;
+        return 1;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::ifstream written(output, std::ios::binary | std::ios::ate);
+    double megabytes = static_cast<double>(written.tellg()) / (1024.0 * 1024.0);
+    std::cout << "Wrote " << records << " records (" << megabytes << " MB) to " << output << " in " << seconds
+              << " s, " << (seconds > 0 ? megabytes / seconds : 0.0) << " MB/s" << std::endl;
+    return 0;
+}
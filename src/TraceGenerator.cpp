@@ -0,0 +1,407 @@
+/*
+* Trace generators. ProfileTraceGenerator replays the control flow an ARM execution profile
+* implies, SyntheticTraceGenerator runs a parameterised program of loop nests, biased and random
+* branches, calls and indirect jumps. Both fill caller-owned batches with no per-record
+* allocation, and TextTraceWriter formats records without going through printf.
+*
+*/
+#include "../include/TraceGenerator.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+const uint64_t ALWAYS_TAKEN = 1ull << 32;
+const size_t RETURN_STACK_LIMIT = 1024; // Deeper call chains drop their oldest half
+const uint32_t SYNTHETIC_FUNCTION_BASE = 0x10000;
+const uint32_t SYNTHETIC_FUNCTION_SIZE = 0x4000;
+const uint32_t SYNTHETIC_DRIVER_BASE = 0x1000;
+const size_t TEXT_BUFFER_BYTES = 1 << 20;
+
+struct DecodedBranch {
+    char type; // 0 if the instruction is not a branch
+    bool conditional;
+    uint32_t target; // B and BL only
+};
+
+// Classify an A32 instruction by what it does to the PC
+DecodedBranch decodeArmBranch(uint32_t address, uint32_t encoding) {
+    uint32_t cond = encoding >> 28;
+    DecodedBranch branch{0, cond != 0xE, 0};
+    if (cond == 0xF) {
+        return branch; // Unconditional extension space, no branches in these profiles
+    }
+    uint32_t rd = (encoding >> 12) & 0xF;
+    uint32_t rn = (encoding >> 16) & 0xF;
+    bool load = (encoding >> 20) & 1;
+
+    if (((encoding >> 25) & 7) == 5) {
+        // B/BL: signed 24-bit word offset from the PC, which reads 8 bytes ahead
+        int32_t offset = static_cast<int32_t>(encoding << 8) >> 6;
+        branch.type = (encoding >> 24) & 1 ? 'C' : 'B';
+        branch.target = address + 8 + static_cast<uint32_t>(offset);
+    } else if ((encoding & 0x0FFFFFF0) == 0x012FFF10) {
+        branch.type = (encoding & 0xF) == 14 ? 'R' : 'I'; // BX LR returns, BX Rm jumps
+    } else if (((encoding >> 25) & 7) == 4 && load && ((encoding >> 15) & 1)) {
+        branch.type = 'R'; // LDM with PC in the list: a stack or frame pointer return
+    } else if (((encoding >> 26) & 3) == 1 && load && rd == 15) {
+        branch.type = rn == 13 ? 'R' : 'I'; // LDR PC from the stack returns, otherwise a jump table
+    } else if (((encoding >> 26) & 3) == 0 && rd == 15) {
+        bool multiplyOrExtraLoad = !((encoding >> 25) & 1) && ((encoding >> 7) & 1) && ((encoding >> 4) & 1);
+        uint32_t opcode = (encoding >> 21) & 0xF;
+        bool compare = opcode >= 8 && opcode <= 11; // TST/TEQ/CMP/CMN write no register
+        if (!multiplyOrExtraLoad && !compare) {
+            bool movFromLR = opcode == 13 && !((encoding >> 25) & 1) && (encoding & 0xFFF) == 14;
+            branch.type = movFromLR ? 'R' : 'I';
+        }
+    }
+    return branch;
+}
+
+// "MOV LR, PC" under any condition, the first half of an APCS indirect call
+bool savesReturnAddress(uint32_t encoding) {
+    return (encoding & 0x0FFFFFFF) == 0x01A0E00F;
+}
+
+char directionOf(uint32_t sourceAddr, uint32_t targetAddr) {
+    return targetAddr == 0 ? '?' : (targetAddr <= sourceAddr ? 'B' : 'F');
+}
+
+char* putHex(char* p, uint64_t value, int minDigits) {
+    static const char digits[] = "0123456789abcdef";
+    int length = minDigits;
+    while (length < 16 && (value >> (4 * length)) != 0) {
+        length++;
+    }
+    for (int i = length - 1; i >= 0; i--) {
+        *p++ = digits[(value >> (4 * i)) & 0xF];
+    }
+    return p;
+}
+
+char* putText(char* p, const char* text, size_t length) {
+    std::memcpy(p, text, length);
+    return p + length;
+}
+
+}
+
+ProfileTraceGenerator::ProfileTraceGenerator(const std::string& filename, uint32_t seed)
+    : position(0), randomState(seed != 0 ? seed : 1), valid(false) {
+    std::ifstream in(filename);
+    if (!in) {
+        std::cerr << "Error: Unable to open " << filename << std::endl;
+        return;
+    }
+
+    // "   count   address encoding disassembly", anything else is a header or a blank line
+    std::vector<uint64_t> counts;
+    std::vector<uint32_t> encodings;
+    std::string line;
+    while (std::getline(in, line)) {
+        const char* p = line.c_str();
+        char* end = nullptr;
+        uint64_t count = std::strtoull(p, &end, 10);
+        if (end == p) {
+            continue;
+        }
+        p = end;
+        uint32_t address = static_cast<uint32_t>(std::strtoul(p, &end, 16));
+        if (end == p) {
+            continue;
+        }
+        p = end;
+        uint32_t encoding = static_cast<uint32_t>(std::strtoul(p, &end, 16));
+        if (end == p || (!addresses.empty() && address <= addresses.back())) {
+            continue;
+        }
+        addresses.push_back(address);
+        counts.push_back(count);
+        encodings.push_back(encoding);
+    }
+
+    for (size_t i = 0; i < addresses.size(); i++) {
+        bool follows = i > 0 && addresses[i - 1] + 4 == addresses[i];
+        if (!follows) {
+            blockStarts.push_back(static_cast<uint32_t>(i));
+            blockWeights.push_back((blockWeights.empty() ? 0 : blockWeights.back()) + std::max<uint64_t>(counts[i], 1));
+        }
+
+        DecodedBranch decoded = decodeArmBranch(addresses[i], encodings[i]);
+        if (decoded.type == 0) {
+            continue;
+        }
+        Branch branch;
+        branch.address = addresses[i];
+        branch.position = static_cast<uint32_t>(i);
+        branch.type = decoded.type;
+        branch.links = decoded.type == 'C' || (decoded.type == 'I' && follows && savesReturnAddress(encodings[i - 1]));
+        branch.takenThreshold = ALWAYS_TAKEN;
+        if (decoded.conditional && counts[i] > 0) {
+            // Whatever did not fall through to the next instruction was taken
+            bool hasNext = i + 1 < addresses.size() && addresses[i + 1] == addresses[i] + 4;
+            uint64_t fallThrough = hasNext ? std::min(counts[i + 1], counts[i]) : 0;
+            branch.takenThreshold = static_cast<uint64_t>((double)(counts[i] - fallThrough) / counts[i] * 4294967296.0);
+        }
+        branch.target = decoded.target;
+        branch.targetPosition = static_cast<uint32_t>(decoded.type == 'B' || decoded.type == 'C' ? positionOf(decoded.target) : 0);
+        branches.push_back(branch);
+    }
+
+    nextBranch.assign(addresses.size(), static_cast<uint32_t>(branches.size()));
+    size_t b = branches.size();
+    for (size_t i = addresses.size(); i-- > 0;) {
+        if (b > 0 && branches[b - 1].position == i) {
+            b--;
+        }
+        nextBranch[i] = static_cast<uint32_t>(b);
+    }
+
+    if (branches.empty()) {
+        std::cerr << "Error: No branches found in " << filename << std::endl;
+        return;
+    }
+    valid = true;
+}
+
+size_t ProfileTraceGenerator::positionOf(uint32_t address) const {
+    size_t found = std::lower_bound(addresses.begin(), addresses.end(), address) - addresses.begin();
+    return found < addresses.size() ? found : 0; // Off the end of the profile: start over
+}
+
+void ProfileTraceGenerator::generate(Instruction* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t b = nextBranch[position];
+        if (b == branches.size()) {
+            b = nextBranch[0]; // No branch before the end of the profile, start over
+        }
+        const Branch& branch = branches[b];
+        bool taken = nextRandom() < branch.takenThreshold;
+
+        uint32_t target = branch.target;
+        position = branch.position + 1 < addresses.size() ? branch.position + 1 : 0;
+        if (taken) {
+            if (branch.type == 'R') {
+                target = 0;
+                position = 0; // Returning from the outermost frame restarts the program
+                if (!returnStack.empty()) {
+                    target = returnStack.back();
+                    returnStack.pop_back();
+                    position = positionOf(target);
+                }
+            } else if (branch.type == 'I') {
+                uint64_t pick = ((static_cast<uint64_t>(nextRandom()) << 32) | nextRandom()) % blockWeights.back();
+                size_t block = std::upper_bound(blockWeights.begin(), blockWeights.end(), pick) - blockWeights.begin();
+                position = blockStarts[block];
+                target = addresses[position];
+            } else {
+                position = branch.targetPosition;
+            }
+            if (branch.links) {
+                if (returnStack.size() == RETURN_STACK_LIMIT) {
+                    returnStack.erase(returnStack.begin(), returnStack.begin() + RETURN_STACK_LIMIT / 2);
+                }
+                returnStack.push_back(branch.address + 4);
+            }
+        }
+
+        Instruction& instr = out[i];
+        instr.type = branch.type;
+        instr.sourceAddr = static_cast<int>(branch.address);
+        instr.targetAddr = static_cast<int>(target);
+        instr.direction = directionOf(branch.address, target);
+        instr.taken = taken;
+    }
+}
+
+bool parseSyntheticSpec(const std::string& text, SyntheticSpec& spec) {
+    struct Field {
+        const char* name;
+        int SyntheticSpec::*member;
+        int min;
+        int max;
+    };
+    static const Field fields[] = {
+        {"functions", &SyntheticSpec::functions, 1, 16384}, {"branches", &SyntheticSpec::branches, 0, 256},
+        {"loops", &SyntheticSpec::loops, 0, 8},             {"trip", &SyntheticSpec::trip, 1, 1 << 20},
+        {"bias", &SyntheticSpec::bias, 0, 100},             {"random", &SyntheticSpec::random, 0, 100},
+        {"calls", &SyntheticSpec::calls, 0, 100},           {"depth", &SyntheticSpec::depth, 0, 64},
+        {"indirect", &SyntheticSpec::indirect, 0, 100},     {"targets", &SyntheticSpec::targets, 1, 16},
+    };
+
+    SyntheticSpec parsed;
+    std::stringstream stream(text == "default" ? std::string() : text);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        size_t equals = item.find('=');
+        if (equals == std::string::npos) {
+            return false;
+        }
+        std::string key = item.substr(0, equals);
+        char* end = nullptr;
+        long value = std::strtol(item.c_str() + equals + 1, &end, 10);
+        if (equals + 1 == item.size() || *end != '\0') {
+            return false;
+        }
+        bool known = false;
+        for (const Field& field : fields) {
+            if (key == field.name) {
+                if (value < field.min || value > field.max) {
+                    return false;
+                }
+                parsed.*field.member = static_cast<int>(value);
+                known = true;
+            }
+        }
+        if (!known) {
+            return false;
+        }
+    }
+    spec = parsed;
+    return true;
+}
+
+SyntheticTraceGenerator::SyntheticTraceGenerator(const SyntheticSpec& spec, uint32_t seed)
+    : spec(spec), randomState(seed != 0 ? seed : 1), pendingOffset(0), invocations(0) {
+    callees.assign(spec.functions, -1);
+    indirectJumps.assign(spec.functions, false);
+    behaviours.assign(static_cast<size_t>(spec.functions) * spec.branches, 0);
+    for (int f = 0; f < spec.functions; f++) {
+        if (spec.functions > 1 && static_cast<int>(nextRandom() % 100) < spec.calls) {
+            callees[f] = static_cast<int>((f + 1 + nextRandom() % (spec.functions - 1)) % spec.functions);
+        }
+        indirectJumps[f] = static_cast<int>(nextRandom() % 100) < spec.indirect;
+        for (int k = 0; k < spec.branches; k++) {
+            bool random = static_cast<int>(nextRandom() % 100) < spec.random;
+            behaviours[static_cast<size_t>(f) * spec.branches + k] = random ? 0 : (nextRandom() & 1 ? 1 : 2);
+        }
+    }
+}
+
+void SyntheticTraceGenerator::emit(char type, uint32_t sourceAddr, uint32_t targetAddr, bool taken) {
+    pending.push_back(Instruction{static_cast<int>(sourceAddr), static_cast<int>(targetAddr), type,
+                                  directionOf(sourceAddr, targetAddr), taken});
+}
+
+// Layout of function f from its base: call site at +0x10, loop headers at +0x40, body branches
+// from +0x100, loop back edges from +0x3000 (innermost first), indirect jump at +0x3200 with its
+// targets from +0x3400, return at +0x3F00
+void SyntheticTraceGenerator::emitFunction(int function, int depth, uint32_t returnAddr) {
+    uint32_t base = SYNTHETIC_FUNCTION_BASE + static_cast<uint32_t>(function) * SYNTHETIC_FUNCTION_SIZE;
+    int callee = callees[function];
+    if (callee >= 0 && depth < spec.depth) {
+        emit('C', base + 0x10, SYNTHETIC_FUNCTION_BASE + static_cast<uint32_t>(callee) * SYNTHETIC_FUNCTION_SIZE, true);
+        emitFunction(callee, depth + 1, base + 0x14);
+    }
+    if (spec.loops > 0) {
+        emitLoop(function, 0);
+    } else {
+        emitBody(function);
+    }
+    if (indirectJumps[function]) {
+        emit('I', base + 0x3200, base + 0x3400 + (nextRandom() % spec.targets) * 0x40, true);
+    }
+    emit('R', base + 0x3F00, returnAddr, true);
+}
+
+void SyntheticTraceGenerator::emitLoop(int function, int level) {
+    uint32_t base = SYNTHETIC_FUNCTION_BASE + static_cast<uint32_t>(function) * SYNTHETIC_FUNCTION_SIZE;
+    uint32_t header = base + 0x40 + static_cast<uint32_t>(level) * 0x10;
+    uint32_t backEdge = base + 0x3000 + static_cast<uint32_t>(spec.loops - level) * 0x10;
+    for (int iteration = 0; iteration < spec.trip; iteration++) {
+        if (level + 1 < spec.loops) {
+            emitLoop(function, level + 1);
+        } else {
+            emitBody(function);
+        }
+        emit('B', backEdge, header, iteration + 1 < spec.trip);
+    }
+}
+
+void SyntheticTraceGenerator::emitBody(int function) {
+    uint32_t base = SYNTHETIC_FUNCTION_BASE + static_cast<uint32_t>(function) * SYNTHETIC_FUNCTION_SIZE;
+    const uint8_t* behaviour = &behaviours[static_cast<size_t>(function) * spec.branches];
+    for (int k = 0; k < spec.branches; k++) {
+        uint32_t roll = nextRandom();
+        bool taken;
+        switch (behaviour[k]) {
+            case 0: taken = roll & 1; break;
+            case 1: taken = static_cast<int>(roll % 100) < spec.bias; break;
+            default: taken = static_cast<int>(roll % 100) >= spec.bias; break;
+        }
+        uint32_t source = base + 0x100 + static_cast<uint32_t>(k) * 0x20;
+        emit('B', source, source + 0x10, taken);
+    }
+}
+
+void SyntheticTraceGenerator::generate(Instruction* out, size_t count) {
+    size_t produced = 0;
+    while (produced < count) {
+        if (pendingOffset == pending.size()) {
+            // One call from the driver loop, three quarters of them to the hottest eighth
+            pending.clear();
+            pendingOffset = 0;
+            uint32_t pick = nextRandom();
+            int hot = std::max(1, spec.functions / 8);
+            int function = static_cast<int>((pick & 3) != 0 ? (pick >> 2) % hot : (pick >> 2) % spec.functions);
+            uint32_t site = SYNTHETIC_DRIVER_BASE + static_cast<uint32_t>(invocations % 16) * 8;
+            emit('C', site, SYNTHETIC_FUNCTION_BASE + static_cast<uint32_t>(function) * SYNTHETIC_FUNCTION_SIZE, true);
+            emitFunction(function, 0, site + 4);
+            invocations++;
+        }
+        size_t take = std::min(count - produced, pending.size() - pendingOffset);
+        std::copy(pending.begin() + pendingOffset, pending.begin() + pendingOffset + take, out + produced);
+        pendingOffset += take;
+        produced += take;
+    }
+}
+
+TextTraceWriter::TextTraceWriter(const std::string& filename)
+    : out(std::fopen(filename.c_str(), "w")), buffer(TEXT_BUFFER_BYTES), used(0), recordCount(0), failed(false) {}
+
+TextTraceWriter::~TextTraceWriter() {
+    close();
+}
+
+void TextTraceWriter::flush() {
+    if (used > 0 && std::fwrite(buffer.data(), 1, used, out) != used) {
+        failed = true;
+    }
+    used = 0;
+}
+
+void TextTraceWriter::write(const Instruction& instr) {
+    if (buffer.size() - used < 96) {
+        flush();
+    }
+    // "B 0000002a from 004021bb to 004026c4 F not taken", as trace-convert --to-text writes it
+    char* p = buffer.data() + used;
+    *p++ = instr.type;
+    *p++ = ' ';
+    p = putHex(p, recordCount, 8);
+    p = putText(p, " from ", 6);
+    p = putHex(p, static_cast<uint32_t>(instr.sourceAddr), 8);
+    if (instr.type == 'B' || instr.targetAddr != 0) {
+        p = putText(p, " to ", 4);
+        p = putHex(p, static_cast<uint32_t>(instr.targetAddr), 8);
+        *p++ = ' ';
+        *p++ = instr.direction;
+    }
+    p = instr.taken ? putText(p, " taken\n", 7) : putText(p, " not taken\n", 11);
+    used = static_cast<size_t>(p - buffer.data());
+    recordCount++;
+}
+
+bool TextTraceWriter::close() {
+    if (out == nullptr) {
+        return !failed;
+    }
+    flush();
+    failed = std::fclose(out) != 0 || failed;
+    out = nullptr;
+    return !failed;
+}
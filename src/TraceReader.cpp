@@ -2,116 +2,349 @@
 * We use this util file to read in the paticular trace
 * The lines of branch instructions come in two different forms return statements and any other branch type
 * Handled both cases when there is a return instruction and anything else
-* Return and instruction array filled with details of each line (struct entry)l
+* The file is memory mapped and parsed in place: a SIMD scan finds the line ends 64 bytes at a time,
+* the fields are read at their usual fixed offsets (with a search as a fallback) and the hex addresses
+* are decoded with a lookup table, so no strings are built and nothing is allocated per line.
+* Return and instruction array filled with details of each line (struct entry)
+* Compressed text traces are decompressed a block at a time into a window that always ends on a line
+* end, the unfinished last line is carried over to the front of the next window.
 *
 */
 
 #include "../include/TraceReader.h"
-#include <fstream>
+#include "../include/BinaryTrace.h"
+#include "../include/CompressedTrace.h"
+#include "../include/InstructionBatch.h"
+#include "../include/MappedFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
-TraceReader::TraceReader(const std::string &filename) : filename(filename) {}
-Instruction TraceReader::parseLine(const std::string &line) {
-    Instruction instr;
+#include <sstream>
 
-    // Set instruction type (B, R, or M)
-    instr.type = line[0];
+namespace {
 
-    // Find the source address (common for all types)
-    size_t fromPos = line.find("from ");
-    if (fromPos != std::string::npos) {
-        instr.sourceAddr = std::stoul(line.substr(fromPos + 5, 8), nullptr, 16);
+// Value of each hex digit, 0x80 for anything that is not one
+struct HexTable {
+    uint8_t value[256];
+
+    HexTable() {
+        for (int c = 0; c < 256; c++) {
+            value[c] = 0x80;
+        }
+        for (int c = '0'; c <= '9'; c++) {
+            value[c] = static_cast<uint8_t>(c - '0');
+        }
+        for (int c = 'a'; c <= 'f'; c++) {
+            value[c] = static_cast<uint8_t>(c - 'a' + 10);
+            value[c - 'a' + 'A'] = static_cast<uint8_t>(c - 'a' + 10);
+        }
     }
+};
+
+const HexTable HEX;
 
-    // Handle different instruction types
-    if (instr.type == 'B') {
-        // Find target address for branch instructions
-        size_t toPos = line.find("to ");
-        if (toPos != std::string::npos) {
-            instr.targetAddr = std::stoul(line.substr(toPos + 3, 8), nullptr, 16);
+// Decode up to 8 hex digits, stopping at the first non-hex character like stoul does
+inline uint32_t decodeHex8(const char* p, const char* end) {
+    if (end - p >= 8) {
+        // Common case, no branches: accumulate all 8 digits and check the error bit once
+        uint32_t value = 0;
+        uint8_t bad = 0;
+        for (int i = 0; i < 8; i++) {
+            uint8_t digit = HEX.value[static_cast<uint8_t>(p[i])];
+            bad |= digit;
+            value = (value << 4) | (digit & 0x0F);
         }
+        if ((bad & 0x80) == 0) {
+            return value;
+        }
+    }
+    uint32_t value = 0;
+    for (int i = 0; i < 8 && p + i < end; i++) {
+        uint8_t digit = HEX.value[static_cast<uint8_t>(p[i])];
+        if (digit & 0x80) {
+            break;
+        }
+        value = (value << 4) | digit;
+    }
+    return value;
+}
 
-        // Get direction (B or F)
-        size_t dirPos = toPos + 12; // Position after the target address
-        if (dirPos < line.length()) {
-            instr.direction = line[dirPos];
+// First occurrence of token in [p, end), or nullptr
+inline const char* findToken(const char* p, const char* end, const char* token, size_t length) {
+    while (static_cast<size_t>(end - p) >= length) {
+        const void* hit = std::memchr(p, token[0], static_cast<size_t>(end - p) - length + 1);
+        if (hit == nullptr) {
+            return nullptr;
         }
-    } else {
-        // For R (return) and M (?) instructions, no target address
-        instr.targetAddr = 0;
-        instr.direction = '?';
+        const char* candidate = static_cast<const char*>(hit);
+        if (std::memcmp(candidate, token, length) == 0) {
+            return candidate;
+        }
+        p = candidate + 1;
     }
+    return nullptr;
+}
 
-    // Check if the branch was taken
-    // Look for "* taken" or "? taken" vs "not taken"
-    if (line.find("not taken") != std::string::npos) {
-        instr.taken = false;
-    } else if (line.find("taken") != std::string::npos) {
-        instr.taken = true;
-    } else {
-        // Default if neither found (shouldn't happen with your data)
-        instr.taken = false;
+// Decoded binary records onto either kind of batch
+void appendRecords(InstructionBatch& out, const Instruction* records, size_t count) {
+    out.append(records, count);
+}
+
+void appendRecords(std::vector<Instruction>& out, const Instruction* records, size_t count) {
+    out.insert(out.end(), records, records + count);
+}
+
+// Parsed text records, handed on a few hundred at a time so a column batch fills each flag
+// word at once
+template <typename Batch>
+class RecordStage {
+private:
+    static const size_t STAGE_SIZE = 256;
+    Batch& out;
+    Instruction records[STAGE_SIZE];
+    size_t count;
+
+public:
+    explicit RecordStage(Batch& out) : out(out), count(0) {}
+    ~RecordStage() { flush(); }
+
+    Instruction& next() { return records[count]; }
+
+    // Keep the record next() handed out
+    void commit() {
+        if (++count == STAGE_SIZE) {
+            flush();
+        }
+    }
+
+    void flush() {
+        appendRecords(out, records, count);
+        count = 0;
     }
+};
 
-    return instr;
 }
 
-/*
-Instruction TraceReader::parseLine(const std::string &line) {
-    Instruction instr;
-    instr.type = line[0];
+TraceReader::TraceReader(const std::string &filename)
+    : filename(filename), windowOffset(0), textEnd(nullptr), pendingOffset(0), cursor(nullptr), bytesParsed(0),
+      parseSeconds(0.0) {}
 
-    // Find the source address (common for both B and R types)
-    size_t fromPos = line.find("from ");
-    if (fromPos != std::string::npos) {
-        instr.sourceAddr = std::stoul(line.substr(fromPos + 5, 8), nullptr, 16);
+TraceReader::~TraceReader() = default;
+
+bool TraceReader::parseLine(const char* begin, const char* end, Instruction& instr) {
+    // Ignore trailing carriage returns and spaces
+    while (end > begin && (end[-1] == '\r' || end[-1] == ' ')) {
+        end--;
+    }
+    if (end == begin) {
+        return false; // Blank line
     }
 
-    if (instr.type == 'B') {
-        // Find target address for branch instructions
-        size_t toPos = line.find("to ");
-        if (toPos != std::string::npos) {
-            instr.targetAddr = std::stoul(line.substr(toPos + 3, 8), nullptr, 16);
-        }
+    // Set instruction type (B, C, R, I or M)
+    instr.type = begin[0];
+    instr.targetAddr = 0;
+    instr.direction = '?';
 
-        // Get direction (usually at position 28, but using a more robust search)
-        size_t dirPos = line.find(" to ") + 12;
-        if (dirPos < line.length()) {
-            instr.direction = line[dirPos];
+    // Find the source address (common for all types), usually at a fixed column:
+    // "B 0040124c from 004011a0 to 00401260 F not taken"
+    const char* from = begin + 11;
+    if (end - begin < 16 || std::memcmp(from, "from ", 5) != 0) {
+        from = findToken(begin, end, "from ", 5);
+        if (from == nullptr) {
+            return false; // Not a branch record (a header or comment line)
         }
-    } else if (instr.type == 'R') {
-        instr.targetAddr = 0; // No target address for returns
-        instr.direction = '?';
+    }
+    instr.sourceAddr = static_cast<int>(decodeHex8(from + 5, end));
 
+    // Branch records always carry a target; calls, returns and indirect records may. A line with
+    // nothing but the outcome ("not taken" at most) after the source address has none.
+    const char* to = from + 14;
+    if (end - to < 3 || std::memcmp(to, "to ", 3) != 0) {
+        to = instr.type == 'B' || end - to > 9 ? findToken(begin, end, "to ", 3) : nullptr;
     }
+    if (to != nullptr) {
+        instr.targetAddr = static_cast<int>(decodeHex8(to + 3, end));
 
-    // Check if the branch was taken
-    instr.taken = (line.find("* taken") != std::string::npos);
+        // Get direction (B or F), just after the target address
+        if (to + 12 < end) {
+            instr.direction = to[12];
+        }
+    }
 
-    return instr;
+    // Check if the branch was taken, the outcome normally ends the line
+    if (end - begin >= 9 && std::memcmp(end - 9, "not taken", 9) == 0) {
+        instr.taken = false;
+    } else if (end - begin >= 5 && std::memcmp(end - 5, "taken", 5) == 0) {
+        instr.taken = true;
+    } else if (findToken(begin, end, "not taken", 9) != nullptr) {
+        instr.taken = false;
+    } else {
+        instr.taken = findToken(begin, end, "taken", 5) != nullptr;
+    }
+
+    return true;
 }
-*/
-std::vector<Instruction> TraceReader::readTrace() {
-    std::vector<Instruction> instructions;
-    std::ifstream file(filename);
-    std::string line;
 
-    if (file.is_open()){ // Populate the vector with instructions
-        while (std::getline(file, line)) {
-            instructions.push_back(parseLine(line));
-        }
-        file.close(); // Close the file
-    } else {
+bool TraceReader::open() {
+    if (file || binary || decompressor) {
+        return true;
+    }
+
+    file.reset(new MappedFile(filename));
+    if (!file->isOpen()) {
         std::cerr << "Error: Unable to open trace file."  << std::endl;
+        file.reset();
+        return false;
+    }
 
+    if (isBinaryTrace(file->data(), file->size())) {
+        // Converted trace, decode it block by block instead of parsing text
+        binary.reset(new BinaryTraceReader(std::move(file)));
+        if (!binary->isOpen()) {
+            binary.reset();
+            return false;
+        }
+        return true;
     }
 
-    return instructions;
+    TraceCompression compression = detectCompression(file->data(), file->size());
+    if (compression != TraceCompression::NONE) {
+        // Decompressed lazily, refillText fills the first window on the first batch
+        decompressor = openDecompressor(std::move(file), compression);
+        return decompressor != nullptr;
+    }
+
+    cursor = file->data();
+    newlines = NewlineScanner(cursor, cursor + file->size());
+    return true;
+}
+
+template <typename Batch>
+size_t TraceReader::appendBatch(Batch& out, size_t maxInstructions) {
+    auto start = std::chrono::steady_clock::now();
+    size_t count = 0;
+
+    if (binary) {
+        while (count < maxInstructions) {
+            if (pendingOffset == pending.size()) {
+                pendingOffset = 0;
+                if (!binary->readBlock(pending)) {
+                    break; // End of trace, readBlock left pending empty
+                }
+            }
+            size_t take = std::min(maxInstructions - count, pending.size() - pendingOffset);
+            appendRecords(out, pending.data() + pendingOffset, take);
+            pendingOffset += take;
+            count += take;
+        }
+        bytesParsed = binary->getBytesRead();
+    } else if (file) {
+        // Populate the batch with instructions, a line at a time
+        const char* end = file->data() + file->size();
+        RecordStage<Batch> stage(out);
+        while (count < maxInstructions && cursor < end) {
+            const char* lineEnd = newlines.next();
+            if (parseLine(cursor, lineEnd, stage.next())) {
+                stage.commit();
+                count++;
+            }
+            cursor = lineEnd < end ? lineEnd + 1 : end;
+        }
+        bytesParsed = static_cast<size_t>(cursor - file->data());
+        file->release(bytesParsed); // Parsed pages are not needed again
+    } else if (decompressor) {
+        RecordStage<Batch> stage(out);
+        while (count < maxInstructions && (cursor < textEnd || refillText())) {
+            const char* lineEnd = newlines.next();
+            if (parseLine(cursor, lineEnd, stage.next())) {
+                stage.commit();
+                count++;
+            }
+            cursor = lineEnd < textEnd ? lineEnd + 1 : textEnd;
+        }
+        bytesParsed = windowOffset + (cursor != nullptr ? static_cast<size_t>(cursor - window.data()) : 0);
+    }
+
+    parseSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return count;
 }
 
+bool TraceReader::refillText() {
+    size_t parsed = cursor != nullptr ? static_cast<size_t>(cursor - window.data()) : 0;
+    window.erase(window.begin(), window.begin() + parsed);
+    windowOffset += parsed;
+    cursor = textEnd = nullptr;
 
+    // Decompress until a line end arrives; the last line of the trace may not have one
+    size_t complete = 0;
+    bool more = true;
+    while (complete == 0 && more) {
+        size_t searched = window.size();
+        more = decompressor->readBlock(window);
+        for (size_t i = window.size(); i > searched; i--) {
+            if (window[i - 1] == '\n') {
+                complete = i;
+                break;
+            }
+        }
+    }
+    if (decompressor->hasError()) {
+        return false;
+    }
+    if (complete == 0) {
+        complete = window.size();
+    }
+    if (complete == 0) {
+        return false;
+    }
+    if (windowOffset == 0 && isBinaryTrace(window.data(), window.size())) {
+        std::cerr << "Error: Compressed binary traces are not supported, decompress the .bpt file first."
+                  << std::endl;
+        return false;
+    }
 
+    cursor = window.data();
+    textEnd = cursor + complete;
+    newlines = NewlineScanner(cursor, textEnd);
+    return true;
+}
 
+size_t TraceReader::readBatch(InstructionBatch& out, size_t maxInstructions) {
+    out.clear();
+    return appendBatch(out, maxInstructions);
+}
 
+size_t TraceReader::readBatch(std::vector<Instruction>& out, size_t maxInstructions) {
+    out.clear();
+    return appendBatch(out, maxInstructions);
+}
 
+InstructionBatch TraceReader::readTrace() {
+    InstructionBatch instructions;
+    if (!open()) {
+        return instructions;
+    }
+    if (binary) {
+        instructions.reserve(binary->getRecordCount());
+    } else if (file) {
+        instructions.reserve(file->size() / 48 + 1); // Roughly one record per 48 bytes
+    }
+    appendBatch(instructions, static_cast<size_t>(-1));
+    return instructions;
+}
 
+double TraceReader::getThroughputMBps() const {
+    return parseSeconds > 0.0 ? bytesParsed / 1e6 / parseSeconds : 0.0;
+}
 
+void TraceReader::printParseStats() const {
+    // Format separately so the caller's stream settings are left alone
+    std::ostringstream line;
+    line << "Parsed " << std::fixed << std::setprecision(2) << bytesParsed / 1e6 << " MB in "
+         << std::setprecision(3) << parseSeconds << " s ("
+         << std::setprecision(1) << getThroughputMBps() << " MB/s)";
+    std::cout << line.str() << std::endl;
+}
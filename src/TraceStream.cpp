@@ -0,0 +1,86 @@
+/*
+* Double-buffered trace streaming. The parser thread and the caller hand the two buffers back
+* and forth in strict alternation: the parser fills buffer 0, then 1, then 0 again once the
+* caller has asked for the batch after it, and so on until the trace runs out.
+*
+*/
+#include "../include/TraceStream.h"
+
+TraceStream::TraceStream(const std::string& filename, size_t batchSize, bool background)
+    : reader(filename), batchSize(batchSize > 0 ? batchSize : 1), opened(false), background(background),
+      full{false, false}, current(-1), finished(false), stopping(false), instructionsRead(0) {
+    opened = reader.open();
+    if (opened && background) {
+        parser = std::thread(&TraceStream::parseLoop, this);
+    }
+}
+
+TraceStream::~TraceStream() {
+    if (parser.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        changed.notify_all();
+        parser.join();
+    }
+}
+
+void TraceStream::parseLoop() {
+    int index = 0;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            changed.wait(lock, [&] { return !full[index] || stopping; });
+            if (stopping) {
+                return;
+            }
+        }
+
+        // Parse without holding the lock, the caller never touches a buffer that is not full
+        size_t count = reader.readBatch(buffers[index], batchSize);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (count == 0) {
+                finished = true;
+            } else {
+                full[index] = true;
+            }
+        }
+        changed.notify_all();
+        if (count == 0) {
+            return;
+        }
+        index ^= 1;
+    }
+}
+
+const InstructionBatch* TraceStream::next() {
+    if (!opened) {
+        return nullptr;
+    }
+
+    if (!background) {
+        size_t count = reader.readBatch(buffers[0], batchSize);
+        instructionsRead += count;
+        return count > 0 ? &buffers[0] : nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    int index = 0;
+    if (current != -1) {
+        // Give the previous batch back to the parser
+        full[current] = false;
+        index = current ^ 1;
+        changed.notify_all();
+    }
+    changed.wait(lock, [&] { return full[index] || finished; });
+    if (!full[index]) {
+        current = -1;
+        return nullptr;
+    }
+    current = index;
+    instructionsRead += buffers[index].size();
+    return &buffers[index];
+}
@@ -1,26 +1,45 @@
-#include "../include/TwoBitBranchPredictor.h"
+#include "../include/CommandLine.h"
+#include "../include/PredictorRegistry.h"
 #include <iostream>
 #include <string>
 
 int main(int argc, char* argv[]) {
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <trace_file> <btb_size>" << std::endl;
+    SingleRun run;
+    int status;
+    if (!dispatchCommandLine(argc, argv, true, run, status)) {
+        return status;
+    }
+    const BTBConfig& btbConfig = run.btb;
+    // Direction predictor, the two-bit counters unless another spec is given
+    PredictorConfig predictorConfig;
+    if (argc > 5 && !parsePredictorConfig(argv[5], predictorConfig)) {
+        std::cerr << "Error: Invalid predictor spec " << argv[5] << std::endl;
+        return 1;
+    }
+    if (!validatePredictorConfig(predictorConfig)) {
         return 1;
     }
-
-    std::string traceFile = argv[1];
-    int btbSize = std::stoi(argv[2]);
 
     std::cout << "Two-Level Branch Prediction Simulation" << std::endl;
     std::cout << "-------------------------------------" << std::endl;
-    std::cout << "Trace file: " << traceFile << std::endl;
-    std::cout << "BTB size: " << btbSize << " entries" << std::endl;
+    std::cout << "Trace file: " << run.traceFile << std::endl;
+    std::cout << "BTB size: " << btbConfig.entries << " entries" << std::endl;
+    std::cout << "BTB associativity: " << (btbConfig.associativity > 0 ? std::to_string(btbConfig.associativity) : "full")
+              << ", replacement: " << replacementPolicyName(btbConfig.policy) << std::endl;
+    if (btbConfig.rasDepth > 0 || btbConfig.indirectEntries > 0) {
+        std::cout << "Return address stack: " << btbConfig.rasDepth << " entries, indirect target cache: "
+                  << btbConfig.indirectEntries << " entries" << std::endl;
+    }
+    std::cout << "Direction predictor: " << predictorConfigName(predictorConfig) << std::endl;
     std::cout << std::endl;
 
-    // Create and run the two-level branch predictor
-    TwoBitBranchPredictor predictor(btbSize);
-    predictor.simulateTrace(traceFile);
-    predictor.printStats();
+    // Create and run the selected branch predictor
+    std::vector<StatsRegistry> runs(1);
+    runs[0].label("trace", run.traceFile);
+    registerConfigStats(SweepConfig{predictorConfig, btbConfig}, runs[0]);
+    if (!runPredictorSimulation(predictorConfig, btbConfig, run.traceFile, runs[0], run.options)) {
+        return 1;
+    }
 
-    return 0;
+    return writeStatsOutput(run.statsOutput, runs) ? 0 : 1;
 }
\ No newline at end of file
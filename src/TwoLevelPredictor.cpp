@@ -0,0 +1,20 @@
+/*
+* Two-level adaptive predictor set-up (GAg and PAp). Prediction and update are inline in the
+* header so they fold into the simulation loop.
+*
+*/
+#include "../include/TwoLevelPredictor.h"
+
+GAgPredictor::GAgPredictor(const BTBConfig&, const PredictorConfig& config, Arena& arena)
+    : table(config.param(0, 12), arena), history(0) {}
+
+PApPredictor::PApPredictor(const BTBConfig&, const PredictorConfig& config, Arena& arena)
+    : historyBits(config.param(1, 10)) {
+    int historyTableBits = config.param(0, 10);
+    int addressBits = config.param(2, 4);
+    histories = ArenaArray<uint32_t>(arena, size_t(1) << historyTableBits, 0);
+    historyTableMask = static_cast<uint32_t>((size_t(1) << historyTableBits) - 1);
+    historyMask = static_cast<uint32_t>((uint64_t(1) << historyBits) - 1);
+    addressMask = static_cast<uint32_t>((uint64_t(1) << addressBits) - 1);
+    table = PackedCounterTable(addressBits + historyBits, arena);
+}
@@ -0,0 +1,118 @@
+/*
+* Work-stealing thread pool. Every worker owns a deque: it pushes and pops at the back, thieves
+* take from the front. The deques have their own locks, held only to move one task, and a shared
+* count of queued tasks lets idle workers sleep instead of spinning.
+*
+*/
+#include "../include/WorkStealingPool.h"
+
+namespace {
+
+// Which pool and worker the current thread belongs to, so nested submits stay local
+thread_local const WorkStealingPool* currentPool = nullptr;
+thread_local int currentWorker = -1;
+
+}
+
+WorkStealingPool::WorkStealingPool(int threads) : queued(0), unfinished(0), nextQueue(0), stopping(false) {
+    if (threads <= 0) {
+        threads = static_cast<int>(std::thread::hardware_concurrency());
+        if (threads <= 0) {
+            threads = 1;
+        }
+    }
+    for (int i = 0; i < threads; i++) {
+        queues.emplace_back(new WorkerQueue());
+    }
+    for (int i = 0; i < threads; i++) {
+        workers.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        stopping = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+void WorkStealingPool::submit(std::function<void()> task) {
+    size_t target;
+    {
+        std::lock_guard<std::mutex> lock(stateMutex);
+        target = currentPool == this ? static_cast<size_t>(currentWorker) : nextQueue++ % queues.size();
+        unfinished++;
+        // Counted before it is pushed: a worker that wakes early just retries until the task lands
+        queued++;
+    }
+    {
+        std::lock_guard<std::mutex> lock(queues[target]->mutex);
+        queues[target]->tasks.push_back(std::move(task));
+    }
+    workAvailable.notify_one();
+}
+
+bool WorkStealingPool::takeTask(int worker, std::function<void()>& task) {
+    // Own deque first, newest task
+    {
+        WorkerQueue& own = *queues[worker];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tasks.empty()) {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+            return true;
+        }
+    }
+    // Then the oldest task of the other workers, starting with the next one along
+    for (size_t offset = 1; offset < queues.size(); offset++) {
+        WorkerQueue& victim = *queues[(worker + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tasks.empty()) {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int worker) {
+    currentPool = this;
+    currentWorker = worker;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(stateMutex);
+            workAvailable.wait(lock, [this] { return queued > 0 || stopping; });
+            if (queued == 0 && stopping) {
+                return;
+            }
+        }
+
+        std::function<void()> task;
+        if (!takeTask(worker, task)) {
+            // Another worker got there first, or the task is counted but not pushed yet
+            std::this_thread::yield();
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> lock(stateMutex);
+            queued--;
+        }
+
+        task();
+
+        std::lock_guard<std::mutex> lock(stateMutex);
+        if (--unfinished == 0) {
+            allDone.notify_all();
+        }
+    }
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(stateMutex);
+    allDone.wait(lock, [this] { return unfinished == 0; });
+}
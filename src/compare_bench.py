@@ -0,0 +1,44 @@
+#!/usr/bin/env python3
+import json
+import sys
+
+# Flag a benchmark as a regression when it gets this much slower
+DEFAULT_THRESHOLD = 0.10
+
+def load(path):
+    """Map benchmark name -> result from a branchsim_bench --json file."""
+    with open(path) as f:
+        return {bench["name"]: bench for bench in json.load(f)["benchmarks"]}
+
+def main():
+    if len(sys.argv) < 3:
+        print(f"Usage: {sys.argv[0]} <baseline.json> <contender.json> [threshold]")
+        return 2
+    baseline = load(sys.argv[1])
+    contender = load(sys.argv[2])
+    threshold = float(sys.argv[3]) if len(sys.argv) > 3 else DEFAULT_THRESHOLD
+
+    regressions = 0
+    print(f"{'benchmark':44}{'base ns/op':>14}{'new ns/op':>14}{'change':>9}{'allocs/op':>16}")
+    for name, old in baseline.items():
+        new = contender.get(name)
+        if new is None:
+            continue
+        change = new["real_time"] / old["real_time"] - 1.0 if old["real_time"] > 0 else 0.0
+        allocs = f"{old['allocs_per_iter']:.1f}->{new['allocs_per_iter']:.1f}"
+        flag = ""
+        # Allocation counts are averaged over the iterations, allow for set-up being amortised differently
+        more_allocs = new["allocs_per_iter"] > old["allocs_per_iter"] * (1 + threshold) + 0.5
+        if change > threshold or more_allocs:
+            flag = "  REGRESSION"
+            regressions += 1
+        print(f"{name:44}{old['real_time']:14.2f}{new['real_time']:14.2f}{change * 100:8.1f}%{allocs:>16}{flag}")
+
+    missing = sorted(set(baseline) ^ set(contender))
+    if missing:
+        print(f"Only in one run: {', '.join(missing)}")
+    print(f"{regressions} regression(s) beyond {threshold * 100:.0f}%")
+    return 1 if regressions else 0
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -1,36 +1,61 @@
 // main.cpp
 #include "../include/BranchPredictor.h"
+#include "../include/CommandLine.h"
+#include "../include/SweepRunner.h"
 #include <iostream>
 #include <string>
 
 int main(int argc, char* argv[]) {
-    // Check for correct number of command line arguments
-    if (argc < 3) {
-        std::cerr << "Usage: " << argv[0] << " <trace_file> <btb_size>" << std::endl;
-        return 1;
+    SingleRun run;
+    int status;
+    if (!dispatchCommandLine(argc, argv, false, run, status)) {
+        return status;
     }
-
-    // Parse command line arguments
-    std::string traceFile = argv[1];
-    int btbSize = std::stoi(argv[2]);
+    const BTBConfig& btbConfig = run.btb;
+    size_t profileTop = run.options.profileTop;
 
     // Print simulation parameters
     std::cout << "Static Branch Predictor Simulation" << std::endl;
     std::cout << "===================================" << std::endl;
-    std::cout << "Trace file: " << traceFile << std::endl;
-    std::cout << "BTB size: " << btbSize << std::endl;
+    std::cout << "Trace file: " << run.traceFile << std::endl;
+    std::cout << "BTB size: " << btbConfig.entries << std::endl;
+    std::cout << "BTB associativity: " << (btbConfig.associativity > 0 ? std::to_string(btbConfig.associativity) : "full")
+              << ", replacement: " << replacementPolicyName(btbConfig.policy) << std::endl;
+    if (btbConfig.rasDepth > 0 || btbConfig.indirectEntries > 0) {
+        std::cout << "Return address stack: " << btbConfig.rasDepth << " entries, indirect target cache: "
+                  << btbConfig.indirectEntries << " entries" << std::endl;
+    }
     std::cout << "Prediction policy: Backward branches (direction='b') predicted taken," << std::endl;
     std::cout << "                   All other branches predicted not taken" << std::endl;
     std::cout << std::endl;
 
-    // Create branch predictor with specified BTB size
-    BranchPredictor predictor(btbSize);
+    // Create branch predictor with specified BTB geometry
+    BranchPredictor predictor(btbConfig);
+    if (profileTop > 0) {
+        predictor.enableProfile();
+    }
+    if (run.options.intervalLength > 0 && !predictor.enableIntervals(run.options.intervalLength, run.options.intervalFile)) {
+        return 1;
+    }
 
     // Run the simulation
-    predictor.simulateTrace(traceFile);
+    if (!predictor.simulateTrace(run.traceFile, run.options.checkpoint)) {
+        return 1;
+    }
+    if (!predictor.finishIntervals()) {
+        return 1;
+    }
 
     // Print the results
     predictor.printStats();
+    if (profileTop > 0) {
+        std::cout << std::endl;
+        predictor.getProfile()->printReport(std::cout, profileTop);
+    }
 
-    return 0;
+    std::vector<StatsRegistry> runs(1);
+    runs[0].label("trace", run.traceFile);
+    registerConfigStats(SweepConfig{PredictorConfig{StaticPredictor::name(), {}}, btbConfig}, runs[0]);
+    predictor.registerStats(runs[0]);
+    return writeStatsOutput(run.statsOutput, runs) ? 0 : 1;
 }
\ No newline at end of file
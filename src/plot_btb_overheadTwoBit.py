@@ -1,44 +1,53 @@
 #!/usr/bin/env python3
+import json
 import subprocess
+import tempfile
 import numpy as np
 import matplotlib.pyplot as plt
-import re
 import os
 
 # Path to your compiled C++ binary and the trace file
-SIMULATOR_PATH = "./branch_sim_TwoBit"  # Change this to your binary
+SIMULATOR_PATH = os.environ.get("BRANCH_SIM", "../build/branch_sim_TwoBit")  # Built by CMake
 TRACE_FILE_PATH = "../misc/block_profile"  # Adjust if needed
 
 # Range of BTB sizes to test (same as before)
 BTB_SIZES = [1, 2, 4, 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 5000, 8000, 10000]
 
-def run_simulation(btb_size):
-    """Run the branch predictor with a specific BTB size and return the results."""
-    try:
-        # Run the simulation with the given BTB size and trace file
-        result = subprocess.run(
-            [SIMULATOR_PATH, TRACE_FILE_PATH, str(btb_size)],
-            capture_output=True,
-            text=True,
-            check=True
-        )
-        return result.stdout
-    except subprocess.CalledProcessError as e:
-        print(f"Error running simulation with BTB size {btb_size}: {e}")
-        print(f"Error output: {e.stderr}")
-        return None
-
-def parse_results(output):
-    """Parse the simulation output to extract relevant statistics."""
-    if not output:
+def run_sweep():
+    """Run every BTB size through the simulator in a single sweep and return its JSON statistics."""
+    specs = ",".join(str(size) for size in BTB_SIZES)
+    with tempfile.TemporaryDirectory() as directory:
+        stats_file = os.path.join(directory, "stats.json")
+        try:
+            subprocess.run(
+                [SIMULATOR_PATH, "--sweep", TRACE_FILE_PATH, specs, "twobit", "--stats-json", stats_file],
+                capture_output=True,
+                text=True,
+                check=True
+            )
+            with open(stats_file) as f:
+                return json.load(f)
+        except subprocess.CalledProcessError as e:
+            print(f"Error running sweep: {e}")
+            print(f"Error output: {e.stderr}")
+            return None
+
+def parse_sweep(stats):
+    """Index the runs of the sweep by BTB size."""
+    if not stats:
+        return {}
+    return {run["btb.entries"]: run for run in stats["runs"]}
+
+def parse_results(row):
+    """Extract the relevant statistics from one run of the sweep."""
+    if not row:
         return None
 
-    # Extract the statistics using regex
     try:
-        total_instructions = int(re.search(r"Total instructions processed: (\d+)", output).group(1))
-        btb_hits = int(re.search(r"BTB hits: (\d+)", output).group(1))
-        btb_misses = int(re.search(r"BTB misses: (\d+)", output).group(1))
-        mispredicted_btb_hits = int(re.search(r"BTB hits but direction mispredicted: (\d+)", output).group(1))
+        total_instructions = row["instructions"]
+        btb_hits = row["btb.hits"]
+        btb_misses = row["btb.misses"]
+        mispredicted_btb_hits = row["btb.hit_but_mispredicted"]
 
         # assuming each non cache hit with successful prediction is a branch overhead of two additional cycles (as mentioned in question 4)
         instructions_executed = 3424177
@@ -55,19 +64,19 @@ def parse_results(output):
             "overhead": overhead,
             "btb_hit_rate": btb_hits / (btb_hits + btb_misses) if (btb_hits + btb_misses) > 0 else 0
         }
-    except (AttributeError, ValueError) as e:
+    except (KeyError, ValueError) as e:
         print(f"Error parsing results: {e}")
-        print(f"Output was: {output}")
+        print(f"Row was: {row}")
         return None
 
 def main():
     results = []
 
     print("Running simulations with different BTB sizes...")
+    rows = parse_sweep(run_sweep())
     for btb_size in BTB_SIZES:
         print(f"Testing BTB size: {btb_size}")
-        output = run_simulation(btb_size)
-        stats = parse_results(output)
+        stats = parse_results(rows.get(btb_size))
         if stats:
             stats["btb_size"] = btb_size
             results.append(stats)
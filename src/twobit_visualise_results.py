@@ -1,63 +1,64 @@
 #!/usr/bin/env python3
+import json
 import subprocess
+import tempfile
 import matplotlib.pyplot as plt
-import re
 import sys
+import os
 
 # Constants
-SIMULATOR_PATH = "./branch_sim_TwoBit"
+SIMULATOR_PATH = os.environ.get("BRANCH_SIM", "../build/branch_sim_TwoBit")  # Built by CMake
 TRACE_FILE_PATH = "../misc/block_profile"
 BTB_SIZES = [2,4,8,16,32,64,128,256,512,1024,2048, 5096, 10192]
 
-def run_simulation(btb_size):
-    """Run the branch predictor with a specific BTB size and return the results."""
-    try:
-        result = subprocess.run(
-            [SIMULATOR_PATH, TRACE_FILE_PATH, str(btb_size)],
-            capture_output=True,
-            text=True,
-            check=True
-        )
-        return result.stdout
-    except subprocess.CalledProcessError as e:
-        print(f"Error running simulation with BTB size {btb_size}: {e}")
-        print(f"Error output: {e.stderr}")
-        return None
+def run_sweep():
+    """Run every BTB size through the simulator in a single sweep and return its JSON statistics."""
+    specs = ",".join(str(size) for size in BTB_SIZES)
+    with tempfile.TemporaryDirectory() as directory:
+        stats_file = os.path.join(directory, "stats.json")
+        try:
+            subprocess.run(
+                [SIMULATOR_PATH, "--sweep", TRACE_FILE_PATH, specs, "twobit", "--stats-json", stats_file],
+                capture_output=True,
+                text=True,
+                check=True
+            )
+            with open(stats_file) as f:
+                return json.load(f)
+        except subprocess.CalledProcessError as e:
+            print(f"Error running sweep: {e}")
+            print(f"Error output: {e.stderr}")
+            return None
 
-def parse_results(output):
-    """Parse the simulation output to extract relevant statistics."""
-    if not output:
+def parse_sweep(stats):
+    """Index the runs of the sweep by BTB size."""
+    if not stats:
+        return {}
+    return {run["btb.entries"]: run for run in stats["runs"]}
+
+def parse_results(row):
+    """Extract the static and dynamic accuracy from one run of the sweep."""
+    if not row:
         return None
 
     try:
-        static_match = re.search(r"Static Accuracy: (\d+\.\d+)%", output)
-        dynamic_match = re.search(r"Dynamic Accuracy: (\d+\.\d+)%", output)
-
-        if static_match and dynamic_match:
-            static_acc = float(static_match.group(1))
-            dynamic_acc = float(dynamic_match.group(1))
-
-            return {
-                "static_accuracy": static_acc,
-                "dynamic_accuracy": dynamic_acc,
-            }
-        else:
-            print("Error: Could not find Static or Dynamic accuracy in output.")
-            return None
-
-    except (AttributeError, ValueError) as e:
+        return {
+            "static_accuracy": 100.0 * row["static.hits"] / row["instructions"],
+            "dynamic_accuracy": 100.0 * row["prediction.hits"] / row["instructions"],
+        }
+    except (KeyError, ValueError) as e:
         print(f"Error parsing results: {e}")
-        print(f"Output was: {output}")
+        print(f"Row was: {row}")
         return None
 
 def main():
     results = []
 
     print("Running simulations with different BTB sizes...")
+    rows = parse_sweep(run_sweep())
     for btb_size in BTB_SIZES:
         print(f"Testing BTB size: {btb_size}")
-        output = run_simulation(btb_size)
-        stats = parse_results(output)
+        stats = parse_results(rows.get(btb_size))
         if stats:
             stats["btb_size"] = btb_size
             results.append(stats)
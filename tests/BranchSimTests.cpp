@@ -0,0 +1,478 @@
+#include "../include/Arena.h"
+#include "../include/BatchRunner.h"
+#include "../include/BinaryTrace.h"
+#include "../include/BranchTargetBuffer.h"
+#include "../include/GsharePredictor.h"
+#include "../include/InstructionBatch.h"
+#include "../include/ParallelRunner.h"
+#include "../include/SimulationDriver.h"
+#include "../include/StatsRegistry.h"
+#include "../include/TagePredictor.h"
+#include "../include/TraceGenerator.h"
+#include "../include/TraceReader.h"
+#include "../include/TwoBitBranchPredictor.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+
+/*
+* branchsim_tests: checks of the properties the simulator's results rest on, one group per ctest
+* test. Traces are synthetic and written to the working directory. Run one group by name, or all
+* of them without arguments.
+*
+*/
+
+namespace {
+
+int failures = 0;
+
+void check(bool condition, const std::string& what) {
+    if (!condition) {
+        std::cerr << "FAILED: " << what << std::endl;
+        failures++;
+    }
+}
+
+// Reproducible records with every branch class, direction and outcome
+std::vector<Instruction> syntheticTrace(size_t count, uint32_t seed) {
+    SyntheticSpec spec;
+    spec.functions = 48;
+    spec.indirect = 30;
+    spec.calls = 60;
+    std::vector<Instruction> records(count);
+    SyntheticTraceGenerator generator(spec, seed);
+    generator.generate(records.data(), count);
+    return records;
+}
+
+bool writeTextTrace(const std::string& filename, const std::vector<Instruction>& records) {
+    TextTraceWriter writer(filename);
+    for (const Instruction& instr : records) {
+        writer.write(instr);
+    }
+    return writer.isOpen() && writer.close();
+}
+
+std::vector<Instruction> readRecords(const std::string& filename) {
+    std::vector<Instruction> records;
+    TraceReader reader(filename);
+    if (!reader.open()) {
+        return records;
+    }
+    std::vector<Instruction> batch;
+    while (reader.readBatch(batch, 1000) > 0) {
+        records.insert(records.end(), batch.begin(), batch.end());
+    }
+    return records;
+}
+
+bool sameRecord(const Instruction& a, const Instruction& b) {
+    return a.sourceAddr == b.sourceAddr && a.targetAddr == b.targetAddr && a.type == b.type &&
+           a.direction == b.direction && a.taken == b.taken;
+}
+
+// Every counter of a, against the same counter of b
+void checkCounters(const StatsRegistry& a, const StatsRegistry& b, const std::string& what) {
+    size_t counters = 0;
+    for (const StatsRegistry::Entry& entry : a.getEntries()) {
+        if (entry.kind != StatsRegistry::Kind::COUNTER) {
+            continue;
+        }
+        counters++;
+        bool found = false;
+        for (const StatsRegistry::Entry& other : b.getEntries()) {
+            if (other.name == entry.name) {
+                found = true;
+                check(other.value == entry.value, what + ": " + entry.name + " is " + std::to_string(other.value) +
+                                                      ", expected " + std::to_string(entry.value));
+            }
+        }
+        check(found, what + ": " + entry.name + " is missing");
+    }
+    check(counters > 0, what + ": no counters registered");
+}
+
+// Count addresses sharing one set of a BTB with numSets sets. A direct-mapped BTB with as many
+// sets maps addresses the same way, and an insert into it evicts exactly the other set members.
+std::vector<int> sameSetAddresses(int numSets, size_t count) {
+    Arena arena;
+    BranchTargetBuffer probe(makeBTBConfig(numSets, 1, ReplacementPolicy::LRU), arena);
+    std::vector<int> addresses;
+    int first = 0x1000;
+    probe.insert(first, 1);
+    addresses.push_back(first);
+    for (int address = first + 4; addresses.size() < count; address += 4) {
+        if (probe.insert(address, 1) == addresses.back()) {
+            addresses.push_back(address);
+        } else {
+            probe.insert(addresses.back(), 1);
+        }
+    }
+    return addresses;
+}
+
+// Fill four ways with a, b, c, d in order, touch a again, then insert e and f
+std::vector<int> evictionsAfterTouch(const BTBConfig& config, const std::vector<int>& addresses) {
+    Arena arena;
+    BranchTargetBuffer btb(config, arena);
+    for (size_t i = 0; i < 4; i++) {
+        btb.insert(addresses[i], static_cast<int>(i));
+    }
+    btb.getTargetAddress(addresses[0]);
+    std::vector<int> evicted;
+    evicted.push_back(btb.insert(addresses[4], 4));
+    evicted.push_back(btb.insert(addresses[5], 5));
+    return evicted;
+}
+
+void testBTBReplacement() {
+    // A fully associative BTB and one set of a 4-way BTB must replace in the same order
+    std::vector<std::pair<int, std::vector<int>>> geometries = {{4, sameSetAddresses(1, 6)}, {8, sameSetAddresses(2, 6)}};
+    for (const auto& geometry : geometries) {
+        const std::vector<int>& a = geometry.second;
+        std::string name = std::to_string(geometry.first) + " entries, 4 ways, ";
+
+        // LRU: b is least recent once a was touched, then c
+        std::vector<int> lru = evictionsAfterTouch(makeBTBConfig(geometry.first, 4, ReplacementPolicy::LRU), a);
+        check(lru[0] == a[1] && lru[1] == a[2], name + "LRU evicts b then c");
+
+        // PLRU: touching a again points the root at the c, d half and its leaf still at c; e
+        // replacing c turns the root back to the a, b half, whose leaf has pointed at b since a was touched
+        std::vector<int> plru = evictionsAfterTouch(makeBTBConfig(geometry.first, 4, ReplacementPolicy::PLRU), a);
+        check(plru[0] == a[2] && plru[1] == a[1], name + "PLRU evicts c then b");
+
+        // Random: a resident branch each time, never the one just inserted
+        std::vector<int> random = evictionsAfterTouch(makeBTBConfig(geometry.first, 4, ReplacementPolicy::RANDOM), a);
+        check(std::find(a.begin(), a.begin() + 4, random[0]) != a.begin() + 4 &&
+              std::find(a.begin(), a.begin() + 5, random[1]) != a.begin() + 5 && random[1] != random[0],
+              name + "random evicts a resident branch");
+        check(random == evictionsAfterTouch(makeBTBConfig(geometry.first, 4, ReplacementPolicy::RANDOM), a),
+              name + "random replacement is reproducible");
+
+        // Hits change nothing but the order: no eviction before the set is full
+        Arena arena;
+        BranchTargetBuffer btb(makeBTBConfig(geometry.first, 4, ReplacementPolicy::LRU), arena);
+        bool quiet = true;
+        for (size_t i = 0; i < 4; i++) {
+            quiet = quiet && btb.insert(a[i], static_cast<int>(i)) == -1;
+        }
+        check(quiet, name + "no eviction while filling the set");
+        check(btb.getTargetAddress(a[3]) == 3 && btb.getTargetAddress(a[5]) == -1, name + "lookup returns the stored target");
+    }
+}
+
+void testTraceRoundTrip() {
+    std::vector<Instruction> records = syntheticTrace(5000, 7);
+    const std::string text = "branchsim_test_roundtrip.txt";
+    const std::string binary = "branchsim_test_roundtrip.bpt";
+    const std::string textAgain = "branchsim_test_roundtrip_again.txt";
+
+    check(writeTextTrace(text, records), "text trace written");
+    std::vector<Instruction> fromText = readRecords(text);
+
+    // Small blocks, so records and deltas cross block boundaries
+    BinaryTraceWriter writer(binary, 1000);
+    for (const Instruction& instr : fromText) {
+        writer.write(instr);
+    }
+    check(writer.close(), "binary trace written");
+    BinaryTraceReader header(binary);
+    check(header.isOpen() && header.getRecordCount() == records.size(), "binary trace header counts every record");
+    std::vector<Instruction> fromBinary = readRecords(binary);
+
+    check(writeTextTrace(textAgain, fromBinary), "text trace written again");
+    std::vector<Instruction> fromTextAgain = readRecords(textAgain);
+
+    check(fromText.size() == records.size() && fromBinary.size() == records.size() && fromTextAgain.size() == records.size(),
+          "every format holds all " + std::to_string(records.size()) + " records");
+    size_t mismatches = 0;
+    for (size_t i = 0; i < records.size() && i < fromText.size() && i < fromBinary.size() && i < fromTextAgain.size(); i++) {
+        mismatches += !sameRecord(records[i], fromText[i]) || !sameRecord(records[i], fromBinary[i]) ||
+                      !sameRecord(records[i], fromTextAgain[i]);
+    }
+    check(mismatches == 0, std::to_string(mismatches) + " records changed on the way text, binary, text");
+
+    std::remove(text.c_str());
+    std::remove(binary.c_str());
+    std::remove(textAgain.c_str());
+}
+
+void checkBlock(const InstructionBatch& batch, const std::vector<Instruction>& records, size_t begin, size_t count) {
+    InstructionBlock block = batch.block(begin, count);
+    std::string what = "block of " + std::to_string(count) + " at " + std::to_string(begin);
+    check(block.count == count && block.lookahead == records.size() - begin - count, what + ": size");
+    uint64_t valid = count == 64 ? ~uint64_t(0) : (uint64_t(1) << count) - 1;
+    check(((block.taken | block.backward | block.classLow | block.classHigh) & ~valid) == 0, what + ": bits past the end are clear");
+    bool same = true;
+    for (size_t i = 0; i < count; i++) {
+        const Instruction& instr = records[begin + i];
+        same = same && block.sourceAddrs[i] == instr.sourceAddr && block.targetAddrs[i] == instr.targetAddr &&
+               block.isTaken(i) == instr.taken && ((block.backward >> i) & 1) == (instr.direction == 'B') &&
+               block.branchClass(i) == classifyBranch(instr.type);
+    }
+    check(same, what + ": every instruction");
+}
+
+void testInstructionBatch() {
+    std::vector<Instruction> records = syntheticTrace(1000, 11);
+    // Types outside B, C, R and I are kept as direct branches
+    records[5].type = 'X';
+    records[70].type = 'J';
+
+    // Appended in pieces that start and end anywhere within a flag word
+    InstructionBatch batch;
+    size_t pieces[] = {1, 63, 2, 64, 65, 127, 3, 128, 200};
+    size_t appended = 0;
+    for (size_t piece : pieces) {
+        batch.append(records.data() + appended, piece);
+        appended += piece;
+    }
+    while (appended < records.size()) {
+        batch.push_back(records[appended++]);
+    }
+    InstructionBatch whole(records);
+    check(batch.size() == records.size() && whole.size() == records.size(), "batch holds every record");
+
+    bool same = true;
+    for (size_t i = 0; i < records.size(); i++) {
+        same = same && batch.sourceAddr(i) == records[i].sourceAddr && batch.targetAddr(i) == records[i].targetAddr &&
+               batch.taken(i) == records[i].taken && batch.backward(i) == (records[i].direction == 'B') &&
+               batch.branchClass(i) == classifyBranch(records[i].type) && whole.branchClass(i) == batch.branchClass(i) &&
+               whole.taken(i) == batch.taken(i) && whole.backward(i) == batch.backward(i);
+    }
+    check(same, "accessors match the records");
+
+    for (size_t begin = 0; begin < records.size(); begin++) {
+        size_t remaining = records.size() - begin;
+        for (size_t count : {size_t(1), size_t(7), size_t(63), size_t(64)}) {
+            if (count <= remaining) {
+                checkBlock(batch, records, begin, count);
+            }
+        }
+        if (remaining < 64) {
+            checkBlock(batch, records, begin, remaining);
+        }
+    }
+
+    // Cleared and reused, no flag of the old contents survives
+    batch.clear();
+    batch.append(records.data() + 500, 100);
+    std::vector<Instruction> tail(records.begin() + 500, records.begin() + 600);
+    for (size_t begin = 0; begin < tail.size(); begin += 37) {
+        checkBlock(batch, tail, begin, std::min<size_t>(64, tail.size() - begin));
+    }
+}
+
+template <typename Predictor>
+StatsRegistry driverStats(const std::string& trace, const BTBConfig& btb, const PredictorConfig& predictor) {
+    SimulationDriver<Predictor> driver(btb, predictor);
+    driver.simulateTrace(trace);
+    StatsRegistry stats;
+    driver.registerStats(stats);
+    return stats;
+}
+
+void testBatchRunner() {
+    const std::string trace = "branchsim_test_batch.txt";
+    const std::string manifest = "branchsim_test_batch_manifest.txt";
+    check(writeTextTrace(trace, syntheticTrace(50000, 5)), "trace written");
+    {
+        std::ofstream out(manifest);
+        out << "# trace btb predictor\n";
+        out << trace << " 256:4:plru twobit\n";
+        out << trace << " 512:0:lru:ras16:ind64 gshare:12:10\n";
+        out << "\n";
+        out << trace << " 64:2:random+1024:4:lru tage\n";
+    }
+
+    // Jobs sharing one parsed trace on two threads, each against its own serial run
+    std::vector<BatchJob> jobs;
+    check(readBatchManifest(manifest, jobs) && jobs.size() == 3, "manifest read");
+    if (jobs.size() == 3) {
+        BatchRunner runner(jobs, 2);
+        check(runner.run(), "batch ran");
+        const std::vector<BatchResult>& results = runner.getResults();
+        check(results.size() == 3 && results[0].ok && results[1].ok && results[2].ok, "every batch job succeeded");
+        if (results.size() == 3) {
+            checkCounters(driverStats<TwoBitPredictor>(trace, jobs[0].btb, jobs[0].predictor), results[0].result.stats, "batch twobit");
+            checkCounters(driverStats<GsharePredictor>(trace, jobs[1].btb, jobs[1].predictor), results[1].result.stats, "batch gshare");
+            checkCounters(driverStats<TagePredictor>(trace, jobs[2].btb, jobs[2].predictor), results[2].result.stats, "batch tage");
+        }
+    }
+
+    std::remove(trace.c_str());
+    std::remove(manifest.c_str());
+}
+
+SweepConfig sweepConfig(const std::string& btbSpec, const std::string& predictorSpec) {
+    SweepConfig config;
+    check(parseBTBConfig(btbSpec, config.btb) && parsePredictorConfig(predictorSpec, config.predictor),
+          "specs " + btbSpec + " " + predictorSpec);
+    return config;
+}
+
+void testParallelChunks() {
+    const std::string trace = "branchsim_test_parallel.txt";
+    std::vector<Instruction> records = syntheticTrace(50000, 5);
+    check(writeTextTrace(trace, records), "trace written");
+
+    InstructionBatch instructions(records);
+    SweepConfig config = sweepConfig("256:4:plru:ras16", "gshare");
+    StatsRegistry single = driverStats<GsharePredictor>(trace, config.btb, config.predictor);
+    checkCounters(single, ParallelRunner(config, 1, 0, 2).simulateExact(instructions).stats, "parallel exact run");
+    checkCounters(single, ParallelRunner(config, 1, 0, 2).simulate(instructions).stats, "parallel run in one chunk");
+
+    // A warm-up reaching back to the start replays everything before each chunk, so the chunks
+    // add up to the serial run
+    checkCounters(single, ParallelRunner(config, 5, records.size(), 2).simulate(instructions).stats, "parallel run, full warm-up");
+
+    // Short warm-ups only approximate it, but every instruction is still counted once
+    SweepResult approximate = ParallelRunner(config, 7, 1000, 2).simulate(instructions);
+    check(approximate.instructions == static_cast<long long>(records.size()), "parallel chunks cover the trace");
+
+    std::remove(trace.c_str());
+}
+
+template <typename Predictor>
+void checkCheckpointRun(const std::string& trace, const std::string& btbSpec, uint64_t prefix) {
+    BTBConfig btb;
+    check(parseBTBConfig(btbSpec, btb), "BTB spec " + btbSpec);
+    const std::string snapshot = "branchsim_test_checkpoint.ckpt";
+    std::string what = std::string(Predictor::name()) + " " + btbSpec + " split at " + std::to_string(prefix);
+
+    SimulationDriver<Predictor> full(btb);
+    full.simulateTrace(trace);
+    StatsRegistry fullStats;
+    full.registerStats(fullStats);
+
+    SimulationDriver<Predictor> first(btb);
+    check(first.simulateTrace(trace, 0, prefix) == prefix, what + ": prefix simulated");
+    check(first.saveCheckpoint(snapshot, prefix), what + ": checkpoint written");
+    StatsRegistry combined;
+    first.registerStats(combined);
+
+    SimulationDriver<Predictor> second(btb);
+    uint64_t offset = 0;
+    check(second.restoreCheckpoint(snapshot, offset) && offset == prefix, what + ": checkpoint restored");
+    second.simulateTrace(trace, offset);
+    StatsRegistry rest;
+    second.registerStats(rest);
+    combined.merge(rest);
+
+    checkCounters(fullStats, combined, what);
+    std::remove(snapshot.c_str());
+}
+
+void testCheckpointRestore() {
+    const std::string trace = "branchsim_test_checkpoint.txt";
+    check(writeTextTrace(trace, syntheticTrace(60000, 3)), "trace written");
+    // Offsets inside a 64-instruction block and past a trace stream batch
+    checkCheckpointRun<TwoBitPredictor>(trace, "64:4:lru", 12345);
+    checkCheckpointRun<GsharePredictor>(trace, "128:0:lru:ras8:ind32", 40000);
+    checkCheckpointRun<TagePredictor>(trace, "256:4:plru:ras16:ind64", 33333);
+    checkCheckpointRun<TwoBitPredictor>(trace, "32:2:random+512:4:plru", 20001);
+    std::remove(trace.c_str());
+}
+
+// Read a trace file's bytes back through a FIFO, fed by a writer thread as a pipeline would be
+std::vector<Instruction> readThroughPipe(const std::string& filename) {
+    const std::string fifo = "branchsim_test_pipe.fifo";
+    std::remove(fifo.c_str());
+    if (mkfifo(fifo.c_str(), 0600) != 0) {
+        check(false, "FIFO created");
+        return std::vector<Instruction>();
+    }
+    std::thread writer([&]() {
+        std::ifstream in(filename, std::ios::binary);
+        std::ofstream out(fifo, std::ios::binary);
+        out << in.rdbuf();
+    });
+    std::vector<Instruction> records = readRecords(fifo);
+    writer.join();
+    std::remove(fifo.c_str());
+    return records;
+}
+
+void testPipeTrace() {
+    std::vector<Instruction> records = syntheticTrace(20000, 9);
+    const std::string text = "branchsim_test_pipe.txt";
+    const std::string binary = "branchsim_test_pipe.bpt";
+    check(writeTextTrace(text, records), "text trace written");
+    BinaryTraceWriter writer(binary);
+    for (const Instruction& instr : records) {
+        writer.write(instr);
+    }
+    check(writer.close(), "binary trace written");
+
+    // A pipe has no size to map, the reader must fall back to reading it to the end
+    for (const std::string& filename : {text, binary}) {
+        std::vector<Instruction> piped = readThroughPipe(filename);
+        size_t mismatches = piped.size() == records.size() ? 0 : records.size();
+        for (size_t i = 0; i < records.size() && i < piped.size(); i++) {
+            mismatches += !sameRecord(records[i], piped[i]);
+        }
+        check(mismatches == 0, filename + " through a pipe: " + std::to_string(piped.size()) + " of " +
+                                   std::to_string(records.size()) + " records, " + std::to_string(mismatches) + " wrong");
+    }
+
+    std::remove(text.c_str());
+    std::remove(binary.c_str());
+}
+
+void testTwoBitHighAddresses() {
+    // A 48-counter table, so the index is a real modulo; addresses from 0x80000000 up are
+    // negative as an int and must still share the counter of their unsigned remainder
+    Arena arena;
+    TwoBitPredictor predictor(makeBTBConfig(48, 1, ReplacementPolicy::LRU), PredictorConfig(), arena);
+    for (uint32_t address : {0x80000000u, 0xFFFFFFF0u, 0xDEADBEE8u}) {
+        int sourceAddr = static_cast<int>(address);
+        int alias = static_cast<int>(address % 48);
+        bool initial = predictor.predict(alias, false);
+        predictor.update(sourceAddr, !initial);
+        predictor.update(sourceAddr, !initial);
+        check(predictor.predict(sourceAddr, false) == !initial && predictor.predict(alias, false) == !initial,
+              "two-bit counter of " + std::to_string(address) + " is the one of " + std::to_string(alias));
+    }
+}
+
+struct TestCase {
+    const char* name;
+    void (*run)();
+};
+
+const TestCase TESTS[] = {
+    {"btb_replacement", testBTBReplacement},
+    {"trace_round_trip", testTraceRoundTrip},
+    {"instruction_batch", testInstructionBatch},
+    {"batch_runner", testBatchRunner},
+    {"parallel_chunks", testParallelChunks},
+    {"checkpoint_restore", testCheckpointRestore},
+    {"pipe_trace", testPipeTrace},
+    {"twobit_high_addresses", testTwoBitHighAddresses},
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    bool ran = false;
+    for (const TestCase& test : TESTS) {
+        if (argc > 1 && std::strcmp(argv[1], test.name) != 0) {
+            continue;
+        }
+        int before = failures;
+        test.run();
+        std::cout << (failures == before ? "PASSED: " : "FAILED: ") << test.name << std::endl;
+        ran = true;
+    }
+    if (!ran) {
+        std::cerr << "Error: Unknown test " << argv[1] << std::endl;
+        return 1;
+    }
+    return failures == 0 ? 0 : 1;
+}